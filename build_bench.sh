@@ -0,0 +1,21 @@
+#!/bin/bash
+
+set -e
+
+# Create a separate build directory specifically for the benchmarks
+mkdir -p build_bench
+cd build_bench
+
+# Remove any existing CMake cache
+rm -rf CMakeCache.txt CMakeFiles/
+
+# Configure with CMake (Release unless CMAKE_BUILD_TYPE is given)
+cmake ../src/bench
+
+# Build
+make -j$(nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 2) bench
+
+echo ""
+echo "Build completed successfully!"
+echo "To run the benchmarks, execute: ./bench --json=results.json"
+echo "To check for regressions: ../src/bench/compare.py baseline.json results.json"
@@ -0,0 +1,113 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// Per-run state handed to a benchmark body, used like Google Benchmark's:
+//
+//   registry.add("name", [](bench::State& state) {
+//       ... setup ...
+//       for (auto _ : state) {
+//           ... timed work ...
+//       }
+//       state.setFlops(2.0 * m * n * k);
+//       state.setBytes(sizeof(double) * (m * k + k * n + m * n));
+//   });
+//
+// Only the loop is timed. The flop and byte counts are per iteration and
+// turn into GFLOP/s and bytes/s in the report.
+class State {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    size_t iterations;
+    double flops = 0.0;
+    double bytes = 0.0;
+    Clock::time_point start;
+    Clock::time_point stop;
+
+public:
+    explicit State(size_t iterations) : iterations(iterations) {}
+
+    // Loop variable of `for (auto _ : state)`, marked unused as in Google
+    // Benchmark so that -Wunused-variable stays quiet about `_`
+    struct [[maybe_unused]] Value {};
+
+    // Counts the loop down and stamps its start and end
+    struct Iterator {
+        State* state;
+        size_t remaining;
+
+        bool operator!=(const Iterator&) const {
+            if (remaining == 0) {
+                state->stop = Clock::now();
+                return false;
+            }
+            return true;
+        }
+        void operator++() { --remaining; }
+        Value operator*() const { return {}; }
+    };
+
+    Iterator begin() {
+        start = Clock::now();
+        return {this, iterations};
+    }
+    Iterator end() { return {this, 0}; }
+
+    size_t getIterations() const { return iterations; }
+
+    // Seconds spent in the loop
+    double elapsed() const { return std::chrono::duration<double>(stop - start).count(); }
+
+    // Work done by one iteration
+    void setFlops(double per_iteration) { flops = per_iteration; }
+    void setBytes(double per_iteration) { bytes = per_iteration; }
+    double getFlops() const { return flops; }
+    double getBytes() const { return bytes; }
+};
+
+// Keep the compiler from eliding a computation whose result is unused
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+using Function = std::function<void(State&)>;
+
+struct Benchmark {
+    std::string name;
+    Function function;
+};
+
+// Benchmarks in registration order
+class Registry {
+private:
+    std::vector<Benchmark> benchmarks;
+
+public:
+    void add(std::string name, Function function) {
+        benchmarks.push_back({std::move(name), std::move(function)});
+    }
+
+    const std::vector<Benchmark>& all() const { return benchmarks; }
+};
+
+// Defined in matrix_bench.cpp and neural_bench.cpp
+void registerMatrixBenchmarks(Registry& registry);
+void registerNeuralBenchmarks(Registry& registry);
+
+} // namespace bench
+
+#endif // BENCH_H
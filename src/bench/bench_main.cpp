@@ -0,0 +1,200 @@
+#include "bench.h"
+#include "../matrix/simd.h"
+#include "../matrix/thread_pool.h"
+#include "../profiler/profiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Performance suite for the matrix and neural hot paths.
+//
+// Usage: bench [--filter=REGEX] [--min-time=SECONDS] [--repetitions=N] [--json=PATH]
+//              [--trace=PATH]
+//
+// Each benchmark's iteration count grows until one run of the timed loop
+// takes --min-time; the run is then repeated and the median time per
+// iteration reported, with GFLOP/s and bytes/s derived from the counts the
+// benchmark declares. --json writes the results for compare.py. --trace
+// turns the profiler on (which costs a little time per scope), prints its
+// per-operation summary and writes a Chrome trace to PATH.
+
+namespace {
+
+struct Options {
+    std::string filter = ".*";
+    double min_time = 0.2;
+    size_t repetitions = 3;
+    std::string json_path;
+    std::string trace_path;
+};
+
+struct Result {
+    std::string name;
+    size_t iterations = 0;
+    double seconds = 0.0;  // Median per iteration
+    double flops = 0.0;    // Per iteration
+    double bytes = 0.0;    // Per iteration
+};
+
+// Find an iteration count whose loop takes min_time, then time repetitions
+// runs of it
+Result run(const bench::Benchmark& benchmark, const Options& options) {
+    size_t iterations = 1;
+    for (;;) {
+        bench::State state(iterations);
+        benchmark.function(state);
+        double elapsed = state.elapsed();
+        if (elapsed >= options.min_time || iterations >= 1000000000) {
+            break;
+        }
+        // Aim a little past min_time, growing at most 10x per step
+        double scale = elapsed > 0.0 ? 1.4 * options.min_time / elapsed : 10.0;
+        iterations = std::max(iterations + 1, static_cast<size_t>(double(iterations) * std::min(scale, 10.0)));
+    }
+
+    Result result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    std::vector<double> times;
+    for (size_t r = 0; r < std::max<size_t>(options.repetitions, 1); ++r) {
+        bench::State state(iterations);
+        benchmark.function(state);
+        times.push_back(state.elapsed() / double(iterations));
+        result.flops = state.getFlops();
+        result.bytes = state.getBytes();
+    }
+    std::sort(times.begin(), times.end());
+    result.seconds = times[times.size() / 2];
+    return result;
+}
+
+std::string formatTime(double seconds) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    if (seconds < 1e-6) {
+        out << seconds * 1e9 << " ns";
+    } else if (seconds < 1e-3) {
+        out << seconds * 1e6 << " us";
+    } else {
+        out << seconds * 1e3 << " ms";
+    }
+    return out.str();
+}
+
+std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+void writeJson(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Cannot open " + path + " for writing");
+    }
+    std::time_t now = std::time(nullptr);
+    char date[32];
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": " << jsonString(date) << ",\n"
+        << "    \"isa\": " << jsonString(matrix::simd::isaName(matrix::simd::activeIsa())) << ",\n"
+        << "    \"num_threads\": " << matrix::getNumThreads() << "\n"
+        << "  },\n  \"benchmarks\": [\n";
+    out << std::setprecision(10);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "    {\"name\": " << jsonString(r.name)
+            << ", \"iterations\": " << r.iterations
+            << ", \"real_time\": " << r.seconds * 1e9
+            << ", \"time_unit\": \"ns\""
+            << ", \"gflops\": " << (r.flops > 0.0 ? r.flops / r.seconds * 1e-9 : 0.0)
+            << ", \"bytes_per_second\": " << (r.bytes > 0.0 ? r.bytes / r.seconds : 0.0) << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const std::string& flag) -> const char* {
+            return arg.rfind(flag + "=", 0) == 0 ? argv[i] + flag.size() + 1 : nullptr;
+        };
+        if (const char* v = value("--filter")) {
+            options.filter = v;
+        } else if (const char* v = value("--min-time")) {
+            options.min_time = std::strtod(v, nullptr);
+        } else if (const char* v = value("--repetitions")) {
+            options.repetitions = std::strtoul(v, nullptr, 10);
+        } else if (const char* v = value("--json")) {
+            options.json_path = v;
+        } else if (const char* v = value("--trace")) {
+            options.trace_path = v;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--filter=REGEX] [--min-time=SECONDS] [--repetitions=N] [--json=PATH]"
+                      << " [--trace=PATH]\n";
+            return 2;
+        }
+    }
+
+    bench::Registry registry;
+    bench::registerMatrixBenchmarks(registry);
+    bench::registerNeuralBenchmarks(registry);
+
+    std::cout << "ISA " << matrix::simd::isaName(matrix::simd::activeIsa()) << ", " << matrix::getNumThreads()
+              << " threads\n";
+    std::cout << std::left << std::setw(40) << "benchmark" << std::right << std::setw(14) << "time"
+              << std::setw(12) << "iterations" << std::setw(12) << "GFLOP/s" << std::setw(12) << "GB/s" << "\n";
+
+    profiler::setEnabled(!options.trace_path.empty());
+    std::regex filter(options.filter);
+    std::vector<Result> results;
+    for (const bench::Benchmark& benchmark : registry.all()) {
+        if (!std::regex_search(benchmark.name, filter)) {
+            continue;
+        }
+        Result r = run(benchmark, options);
+        std::cout << std::left << std::setw(40) << r.name << std::right << std::setw(14) << formatTime(r.seconds)
+                  << std::setw(12) << r.iterations << std::fixed << std::setprecision(2);
+        if (r.flops > 0.0) {
+            std::cout << std::setw(12) << r.flops / r.seconds * 1e-9;
+        } else {
+            std::cout << std::setw(12) << "-";
+        }
+        std::cout << std::setw(12) << r.bytes / r.seconds * 1e-9 << "\n";
+        results.push_back(r);
+    }
+
+    if (!options.json_path.empty()) {
+        writeJson(options.json_path, results);
+        std::cout << "Wrote " << results.size() << " results to " << options.json_path << "\n";
+    }
+    if (!options.trace_path.empty()) {
+        profiler::setEnabled(false);
+        std::cout << "\n";
+        profiler::printSummary(std::cout);
+        profiler::writeChromeTrace(options.trace_path);
+        std::cout << "Wrote trace to " << options.trace_path;
+        if (size_t dropped = profiler::droppedEvents()) {
+            std::cout << " (" << dropped << " events dropped)";
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Compare two bench --json result files and flag regressions.
+
+Usage: compare.py BASELINE CURRENT [--threshold FRACTION]
+
+A benchmark regresses when its time per iteration grew by more than the
+threshold (default 0.10, i.e. 10%) over the baseline. Exits with status 1
+if any benchmark regressed, so it can gate a CI job.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    return {b["name"]: b for b in data["benchmarks"]}, data.get("context", {})
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flag benchmark regressions against a baseline.")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="allowed relative slowdown before flagging (default 0.10)")
+    args = parser.parse_args()
+
+    baseline, baseline_context = load(args.baseline)
+    current, current_context = load(args.current)
+    for key in ("isa", "num_threads"):
+        if baseline_context.get(key) != current_context.get(key):
+            print(f"warning: {key} differs: baseline {baseline_context.get(key)}, "
+                  f"current {current_context.get(key)}")
+
+    regressions = 0
+    print(f"{'benchmark':40} {'baseline':>12} {'current':>12} {'change':>9}")
+    for name, result in current.items():
+        if name not in baseline:
+            print(f"{name:40} {'-':>12} {result['real_time']:>10.0f}ns {'new':>9}")
+            continue
+        before = baseline[name]["real_time"]
+        after = result["real_time"]
+        change = after / before - 1.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            flag = "  improved"
+        print(f"{name:40} {before:>10.0f}ns {after:>10.0f}ns {change:>+8.1%}{flag}")
+    for name in baseline:
+        if name not in current:
+            print(f"{name:40} {'':>12} {'-':>12} {'missing':>9}")
+
+    if regressions:
+        print(f"\n{regressions} benchmark(s) regressed by more than {args.threshold:.0%}")
+        return 1
+    print("\nNo regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,80 @@
+#include "bench.h"
+#include "../matrix/matrix.h"
+#include <random>
+#include <string>
+
+namespace bench {
+
+namespace {
+
+matrix::Matrix randomMatrix(size_t rows, size_t cols, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    matrix::Matrix m(rows, cols);
+    for (size_t i = 0; i < rows; ++i) {
+        for (double& x : m.row(i)) {
+            x = dist(gen);
+        }
+    }
+    return m;
+}
+
+} // namespace
+
+void registerMatrixBenchmarks(Registry& registry) {
+    // Matrix::multiply over m x k times k x n: square sizes, then the
+    // skinny shapes of inference (few rows) and of training on tall inputs
+    const size_t shapes[][3] = {
+        {64, 64, 64}, {128, 128, 128}, {256, 256, 256}, {512, 512, 512},
+        {1, 1024, 1024}, {8, 1024, 1024}, {32, 1024, 256}, {4096, 64, 64}, {64, 4096, 64},
+    };
+    for (const auto& shape : shapes) {
+        size_t m = shape[0];
+        size_t k = shape[1];
+        size_t n = shape[2];
+        registry.add("Matrix::multiply/" + std::to_string(m) + "x" + std::to_string(k) + "x" + std::to_string(n),
+                     [m, k, n](State& state) {
+            matrix::Matrix a = randomMatrix(m, k, 1);
+            matrix::Matrix b = randomMatrix(k, n, 2);
+            matrix::Matrix c;
+            for (auto _ : state) {
+                matrix::Matrix::multiplyInto(a, b, c);
+                doNotOptimize(c.data());
+            }
+            state.setFlops(2.0 * double(m) * double(n) * double(k));
+            state.setBytes(sizeof(double) * double(m * k + k * n + m * n));
+        });
+    }
+
+    // Construction and copying, which allocate (aligned) and touch every byte
+    for (size_t size : {64, 512, 2048}) {
+        std::string suffix = std::to_string(size) + "x" + std::to_string(size);
+        double bytes = sizeof(double) * double(size * size);
+        registry.add("Matrix::construct/" + suffix, [size, bytes](State& state) {
+            for (auto _ : state) {
+                matrix::Matrix m(size, size);
+                doNotOptimize(m.data());
+            }
+            state.setBytes(bytes);
+        });
+        registry.add("Matrix::copy/" + suffix, [size, bytes](State& state) {
+            matrix::Matrix source = randomMatrix(size, size, 3);
+            for (auto _ : state) {
+                matrix::Matrix copy(source);
+                doNotOptimize(copy.data());
+            }
+            state.setBytes(2.0 * bytes);
+        });
+        registry.add("Matrix::copyAssign/" + suffix, [size, bytes](State& state) {
+            matrix::Matrix source = randomMatrix(size, size, 4);
+            matrix::Matrix target(size, size);
+            for (auto _ : state) {
+                target = source;
+                doNotOptimize(target.data());
+            }
+            state.setBytes(2.0 * bytes);
+        });
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,72 @@
+#include "bench.h"
+#include "../neural/dense.h"
+#include <memory>
+#include <random>
+#include <string>
+
+namespace bench {
+
+namespace {
+
+matrix::Matrix randomMatrix(size_t rows, size_t cols, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(-2.0, 2.0);
+    matrix::Matrix m(rows, cols);
+    for (size_t i = 0; i < rows; ++i) {
+        for (double& x : m.row(i)) {
+            x = dist(gen);
+        }
+    }
+    return m;
+}
+
+// Activation::applyInto over a 256 x 1024 matrix
+template <typename A>
+void addActivation(Registry& registry, const std::string& name, A activation) {
+    registry.add("Activation::" + name, [activation](State& state) {
+        matrix::Matrix input = randomMatrix(256, 1024, 5);
+        matrix::Matrix output(256, 1024);
+        for (auto _ : state) {
+            activation.applyInto(input, output);
+            doNotOptimize(output.data());
+        }
+        state.setBytes(2.0 * sizeof(double) * double(input.getRows() * input.getCols()));
+    });
+}
+
+} // namespace
+
+void registerNeuralBenchmarks(Registry& registry) {
+    addActivation(registry, "ReLU", neural::ReLU());
+    addActivation(registry, "Sigmoid", neural::Sigmoid());
+    addActivation(registry, "Tanh", neural::Tanh());
+    addActivation(registry, "GELU", neural::GELU());
+    addActivation(registry, "LeakyReLU", neural::LeakyReLU());
+    addActivation(registry, "Identity", neural::Identity());
+    addActivation(registry, "Softmax", neural::Softmax());
+    addActivation(registry, "LogSoftmax", neural::LogSoftmax());
+
+    // DenseLayer::forward of a 512 -> 512 ReLU layer from single rows to
+    // training-size batches, storing state for backward() or not
+    const size_t in = 512;
+    const size_t out = 512;
+    for (bool training : {false, true}) {
+        for (size_t batch : {1, 8, 32, 128, 512}) {
+            registry.add(std::string("DenseLayer::forward/") + (training ? "train" : "infer") + "/batch"
+                         + std::to_string(batch), [=](State& state) {
+                neural::DenseLayer layer(in, out, std::make_unique<neural::ReLU>());
+                layer.setTraining(training);
+                matrix::Matrix input = randomMatrix(batch, in, 6);
+                matrix::Matrix output;
+                for (auto _ : state) {
+                    layer.forward(input, output);
+                    doNotOptimize(output.data());
+                }
+                state.setFlops(2.0 * double(batch) * double(in) * double(out));
+                state.setBytes(sizeof(double) * double(in * out + batch * (in + out)));
+            });
+        }
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,67 @@
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <type_traits>
+#include "memory_resource.h"
+
+namespace matrix {
+
+// Standard allocator handing out over-aligned storage from a MemoryResource
+// so that std::vector-backed matrix buffers start on a cache-line boundary.
+//
+// A default-constructed allocator binds to the calling thread's current
+// resource. Like std::pmr::polymorphic_allocator it is not propagated on
+// copy or move assignment: a container keeps the resource it was built
+// with, and a copy-constructed container binds to the current resource.
+template <typename T, size_t Alignment = kMatrixAlignment>
+class AlignedAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::false_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept : memory(currentResource()) {}
+
+    explicit AlignedAllocator(MemoryResource* r) noexcept : memory(r) {}
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>& other) noexcept : memory(other.resource()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(memory->allocate(n * sizeof(T), Alignment));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        memory->deallocate(p, n * sizeof(T), Alignment);
+    }
+
+    AlignedAllocator select_on_container_copy_construction() const noexcept {
+        return AlignedAllocator();
+    }
+
+    MemoryResource* resource() const noexcept { return memory; }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>& other) const noexcept {
+        return memory == other.resource();
+    }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>& other) const noexcept {
+        return memory != other.resource();
+    }
+
+private:
+    MemoryResource* memory;
+};
+
+} // namespace matrix
+
+#endif // ALIGNED_ALLOCATOR_H
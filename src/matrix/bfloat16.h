@@ -0,0 +1,36 @@
+#ifndef BFLOAT16_H
+#define BFLOAT16_H
+
+#include <bit>
+#include <cstdint>
+
+namespace matrix {
+
+// 16-bit brain floating point storage type: the upper half of an IEEE
+// float32 (same exponent range, 8 significant bits). Values are stored as
+// bfloat16 and converted to float for arithmetic; conversion from float
+// rounds to nearest even and keeps NaNs quiet.
+struct bfloat16 {
+    uint16_t bits = 0;
+
+    bfloat16() = default;
+
+    bfloat16(float value) : bits(fromFloat(value)) {}
+
+    operator float() const {
+        return std::bit_cast<float>(static_cast<uint32_t>(bits) << 16);
+    }
+
+    static uint16_t fromFloat(float value) {
+        uint32_t u = std::bit_cast<uint32_t>(value);
+        if ((u & 0x7fffffffu) > 0x7f800000u) {
+            return static_cast<uint16_t>((u >> 16) | 0x0040u);
+        }
+        uint32_t rounding = 0x7fffu + ((u >> 16) & 1u);
+        return static_cast<uint16_t>((u + rounding) >> 16);
+    }
+};
+
+} // namespace matrix
+
+#endif // BFLOAT16_H
@@ -0,0 +1,50 @@
+#ifndef EPILOGUE_H
+#define EPILOGUE_H
+
+#include <cstddef>
+
+namespace matrix {
+
+// Element-wise activation a GEMM epilogue can apply
+enum class EpilogueActivation {
+    None,
+    ReLU,
+    Sigmoid,
+    Tanh,
+    GELU
+};
+
+// Work folded into a GEMM while each output tile is still in cache:
+//
+//   pre = A * B + bias     (stored to pre_activation if non-null)
+//   C   = activation(pre)
+//
+// bias points at n elements added to every row. Pointers address the same
+// (row, column) origin as C.
+template <typename T>
+struct Epilogue {
+    const T* bias = nullptr;
+    EpilogueActivation activation = EpilogueActivation::None;
+    T* pre_activation = nullptr;
+    size_t ld_pre = 0;
+
+    bool empty() const {
+        return !bias && activation == EpilogueActivation::None && !pre_activation;
+    }
+
+    // The same epilogue for the sub-block of C starting at (i, j)
+    Epilogue at(size_t i, size_t j) const {
+        Epilogue e = *this;
+        if (e.bias) {
+            e.bias += j;
+        }
+        if (e.pre_activation) {
+            e.pre_activation += i * ld_pre + j;
+        }
+        return e;
+    }
+};
+
+} // namespace matrix
+
+#endif // EPILOGUE_H
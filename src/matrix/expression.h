@@ -0,0 +1,267 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "matrix.h"
+
+namespace matrix {
+
+// Lazy element-wise matrix expressions.
+//
+// Operators on matrices (+, -, element-wise *, scalar ops) and map() build
+// an expression tree instead of computing anything. The tree is evaluated
+// in a single pass over the output when it is assigned to (or used to
+// construct) a BasicMatrix, so
+//
+//     Matrix y = relu(matmul(x, W) + b);
+//
+// runs one GEMM and then one loop that adds the bias and applies ReLU,
+// without materializing x*W + b. An operand with a single row is broadcast
+// across the rows of the other operand (bias vectors).
+//
+// Expressions hold references to their matrix operands: evaluate them in
+// the statement that creates them rather than storing them in auto
+// variables. Sub-expressions passed as temporaries are moved into the
+// enclosing node, so the product above is computed once and never copied.
+template <typename E>
+class MatrixExpr {
+public:
+    const E& derived() const { return static_cast<const E&>(*this); }
+};
+
+namespace expr {
+
+// Leaf node referencing an existing matrix
+template <typename T>
+class Leaf : public MatrixExpr<Leaf<T>> {
+public:
+    using value_type = T;
+
+    struct Row {
+        const T* p;
+        T operator[](size_t j) const { return p[j]; }
+    };
+
+    explicit Leaf(const BasicMatrix<T>& m) : m(m) {}
+
+    size_t rows() const { return m.getRows(); }
+    size_t cols() const { return m.getCols(); }
+    Row row(size_t i) const { return Row{m.row(m.getRows() == 1 ? 0 : i).data()}; }
+
+private:
+    const BasicMatrix<T>& m;
+};
+
+// Matrix product node. The GEMM output is the one unavoidable temporary; it
+// is computed when the node is built and read like a leaf afterwards.
+template <typename T>
+class Product : public MatrixExpr<Product<T>> {
+public:
+    using value_type = T;
+    using Row = typename Leaf<T>::Row;
+
+    Product(const BasicMatrix<T>& a, const BasicMatrix<T>& b) : result(BasicMatrix<T>::multiply(a, b)) {}
+
+    size_t rows() const { return result.getRows(); }
+    size_t cols() const { return result.getCols(); }
+    Row row(size_t i) const { return Row{result.row(result.getRows() == 1 ? 0 : i).data()}; }
+
+private:
+    BasicMatrix<T> result;
+};
+
+// Element-wise binary node with single-row broadcasting
+template <typename Op, typename L, typename R>
+class Binary : public MatrixExpr<Binary<Op, L, R>> {
+public:
+    using value_type = typename L::value_type;
+    static_assert(std::is_same_v<value_type, typename R::value_type>,
+                  "Matrix expression operands must have the same element type");
+
+    struct Row {
+        typename L::Row l;
+        typename R::Row r;
+        value_type operator[](size_t j) const { return Op::apply(l[j], r[j]); }
+    };
+
+    Binary(L l, R r) : l(std::move(l)), r(std::move(r)) {
+        size_t out_rows = std::max(this->l.rows(), this->r.rows());
+        bool rows_ok = (this->l.rows() == out_rows || this->l.rows() == 1)
+                    && (this->r.rows() == out_rows || this->r.rows() == 1);
+        if (!rows_ok || this->l.cols() != this->r.cols()) {
+            throw std::invalid_argument("Matrix dimensions mismatch for element-wise operation: "
+                                       + std::to_string(this->l.rows()) + "x" + std::to_string(this->l.cols())
+                                       + " and " + std::to_string(this->r.rows()) + "x" + std::to_string(this->r.cols()));
+        }
+    }
+
+    size_t rows() const { return std::max(l.rows(), r.rows()); }
+    size_t cols() const { return l.cols(); }
+    Row row(size_t i) const { return Row{l.row(i), r.row(i)}; }
+
+private:
+    L l;
+    R r;
+};
+
+// Element-wise unary node applying a functor
+template <typename E, typename F>
+class Map : public MatrixExpr<Map<E, F>> {
+public:
+    using value_type = typename E::value_type;
+
+    struct Row {
+        typename E::Row e;
+        F f;
+        value_type operator[](size_t j) const { return f(e[j]); }
+    };
+
+    Map(E e, F f) : e(std::move(e)), f(std::move(f)) {}
+
+    size_t rows() const { return e.rows(); }
+    size_t cols() const { return e.cols(); }
+    Row row(size_t i) const { return Row{e.row(i), f}; }
+
+private:
+    E e;
+    F f;
+};
+
+struct Add {
+    template <typename T>
+    static T apply(T a, T b) { return a + b; }
+};
+
+struct Sub {
+    template <typename T>
+    static T apply(T a, T b) { return a - b; }
+};
+
+struct Mul {
+    template <typename T>
+    static T apply(T a, T b) { return a * b; }
+};
+
+// Operand traits: matrices become leaves, expressions are used as-is
+// (moved from when they are temporaries)
+template <typename X>
+struct Operand {
+    static constexpr bool value = std::is_base_of_v<MatrixExpr<X>, X>;
+    using type = X;
+    static const X& wrap(const X& x) { return x; }
+    static X&& wrap(X&& x) { return std::move(x); }
+};
+
+template <typename T>
+struct Operand<BasicMatrix<T>> {
+    static constexpr bool value = true;
+    using type = Leaf<T>;
+    static Leaf<T> wrap(const BasicMatrix<T>& m) { return Leaf<T>(m); }
+};
+
+template <typename X>
+concept MatrixOperand = Operand<std::remove_cvref_t<X>>::value;
+
+template <typename X>
+using ExprOf = typename Operand<std::remove_cvref_t<X>>::type;
+
+template <typename X>
+using ValueOf = typename ExprOf<X>::value_type;
+
+template <typename Op, typename L, typename R>
+auto makeBinary(L&& l, R&& r) {
+    return Binary<Op, ExprOf<L>, ExprOf<R>>(Operand<std::remove_cvref_t<L>>::wrap(std::forward<L>(l)),
+                                            Operand<std::remove_cvref_t<R>>::wrap(std::forward<R>(r)));
+}
+
+template <typename X, typename F>
+auto makeMap(X&& x, F f) {
+    return Map<ExprOf<X>, F>(Operand<std::remove_cvref_t<X>>::wrap(std::forward<X>(x)), std::move(f));
+}
+
+} // namespace expr
+
+// Element-wise sum, difference and product (with single-row broadcasting)
+template <expr::MatrixOperand L, expr::MatrixOperand R>
+auto operator+(L&& l, R&& r) { return expr::makeBinary<expr::Add>(std::forward<L>(l), std::forward<R>(r)); }
+
+template <expr::MatrixOperand L, expr::MatrixOperand R>
+auto operator-(L&& l, R&& r) { return expr::makeBinary<expr::Sub>(std::forward<L>(l), std::forward<R>(r)); }
+
+template <expr::MatrixOperand L, expr::MatrixOperand R>
+auto operator*(L&& l, R&& r) { return expr::makeBinary<expr::Mul>(std::forward<L>(l), std::forward<R>(r)); }
+
+// Apply f to every element
+template <expr::MatrixOperand X, typename F>
+auto map(X&& x, F f) { return expr::makeMap(std::forward<X>(x), std::move(f)); }
+
+// Scalar operations
+template <expr::MatrixOperand X>
+auto operator+(X&& x, expr::ValueOf<X> s) {
+    return map(std::forward<X>(x), [s](expr::ValueOf<X> v) { return v + s; });
+}
+
+template <expr::MatrixOperand X>
+auto operator+(expr::ValueOf<X> s, X&& x) { return std::forward<X>(x) + s; }
+
+template <expr::MatrixOperand X>
+auto operator-(X&& x, expr::ValueOf<X> s) {
+    return map(std::forward<X>(x), [s](expr::ValueOf<X> v) { return v - s; });
+}
+
+template <expr::MatrixOperand X>
+auto operator-(expr::ValueOf<X> s, X&& x) {
+    return map(std::forward<X>(x), [s](expr::ValueOf<X> v) { return s - v; });
+}
+
+template <expr::MatrixOperand X>
+auto operator*(X&& x, expr::ValueOf<X> s) {
+    return map(std::forward<X>(x), [s](expr::ValueOf<X> v) { return v * s; });
+}
+
+template <expr::MatrixOperand X>
+auto operator*(expr::ValueOf<X> s, X&& x) { return std::forward<X>(x) * s; }
+
+template <expr::MatrixOperand X>
+auto operator/(X&& x, expr::ValueOf<X> s) {
+    return map(std::forward<X>(x), [s](expr::ValueOf<X> v) { return v / s; });
+}
+
+template <expr::MatrixOperand X>
+auto operator-(X&& x) {
+    return map(std::forward<X>(x), [](expr::ValueOf<X> v) { return -v; });
+}
+
+// Matrix product as an expression operand (evaluated eagerly, see Product)
+template <typename T>
+expr::Product<T> matmul(const BasicMatrix<T>& a, const BasicMatrix<T>& b) {
+    return expr::Product<T>(a, b);
+}
+
+// Activation functions as fusable element-wise expressions
+template <expr::MatrixOperand X>
+auto relu(X&& x) {
+    using T = expr::ValueOf<X>;
+    return map(std::forward<X>(x), [](T v) { return v > T(0) ? v : T(0); });
+}
+
+template <expr::MatrixOperand X>
+auto sigmoid(X&& x) {
+    using T = expr::ValueOf<X>;
+    return map(std::forward<X>(x), [](T v) { return T(1) / (T(1) + std::exp(-v)); });
+}
+
+template <expr::MatrixOperand X>
+auto tanh(X&& x) {
+    using T = expr::ValueOf<X>;
+    return map(std::forward<X>(x), [](T v) { return std::tanh(v); });
+}
+
+} // namespace matrix
+
+#endif // EXPRESSION_H
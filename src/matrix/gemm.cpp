@@ -0,0 +1,441 @@
+#include "gemm.h"
+#include "aligned_allocator.h"
+#include "thread_pool.h"
+#include "simd_kernels.h"
+#include "matrix.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace matrix {
+namespace detail {
+
+// Cache blocking: a KC x NR sliver of packed B stays in L1, an MC x KC
+// block of packed A (192 KiB) stays in L2, and KC x NC of packed B is
+// streamed from L3. MC and NC are multiples of every ISA's MR and NR.
+static constexpr size_t KC = 256;
+static constexpr size_t MC = 96;
+static constexpr size_t NC = 2048;
+
+// Below this many multiply-adds packing costs more than it saves
+static constexpr size_t kSmallGemmFlops = 32 * 32 * 32;
+
+// Below this many multiply-adds waking the thread pool costs more than it
+// saves, so the product runs serially on the calling thread
+static constexpr size_t kParallelGemmFlops = 128 * 128 * 128;
+
+// Aim for this many output tiles per thread so stealing can even out load
+static constexpr size_t kTilesPerThread = 4;
+
+template <typename T>
+using PackBuffer = std::vector<T, AlignedAllocator<T>>;
+
+// Pack an mc x kc block of A into MR-row slivers, column-major inside each
+// sliver, zero-padding the last sliver to a full MR rows. Elements are
+// widened from the storage type S to the compute type A on the way.
+template <typename S, typename A>
+static void packA(size_t MR, size_t mc, size_t kc, const S* a, size_t rsa, size_t csa, A* out) {
+    for (size_t i = 0; i < mc; i += MR) {
+        size_t mr = std::min(MR, mc - i);
+        for (size_t p = 0; p < kc; ++p) {
+            for (size_t r = 0; r < mr; ++r) {
+                out[r] = static_cast<A>(a[(i + r) * rsa + p * csa]);
+            }
+            for (size_t r = mr; r < MR; ++r) {
+                out[r] = A(0);
+            }
+            out += MR;
+        }
+    }
+}
+
+// Pack a kc x nc block of B into NR-column slivers, row-major inside each
+// sliver, zero-padding the last sliver to a full NR columns.
+template <typename S, typename A>
+static void packB(size_t NR, size_t kc, size_t nc, const S* b, size_t rsb, size_t csb, A* out) {
+    for (size_t j = 0; j < nc; j += NR) {
+        size_t nr = std::min(NR, nc - j);
+        for (size_t p = 0; p < kc; ++p) {
+            const S* src = b + p * rsb + j * csb;
+            for (size_t c = 0; c < nr; ++c) {
+                out[c] = static_cast<A>(src[c * csb]);
+            }
+            for (size_t c = nr; c < NR; ++c) {
+                out[c] = A(0);
+            }
+            out += NR;
+        }
+    }
+}
+
+// Apply an epilogue to a rows x cols block of C (ep addresses the same
+// origin as c)
+template <typename A>
+static void applyEpilogue(const Epilogue<A>& ep, size_t rows, size_t cols, A* c, size_t ldc) {
+    for (size_t i = 0; i < rows; ++i) {
+        A* row = c + i * ldc;
+        if (ep.bias) {
+            simd::add(row, ep.bias, row, cols);
+        }
+        if (ep.pre_activation) {
+            std::copy_n(row, cols, ep.pre_activation + i * ep.ld_pre);
+        }
+        switch (ep.activation) {
+        case EpilogueActivation::None:
+            break;
+        case EpilogueActivation::ReLU:
+            simd::relu(row, row, cols);
+            break;
+        case EpilogueActivation::Sigmoid:
+            simd::sigmoid(row, row, cols);
+            break;
+        case EpilogueActivation::Tanh:
+            simd::tanh(row, row, cols);
+            break;
+        case EpilogueActivation::GELU:
+            simd::gelu(row, row, cols);
+            break;
+        }
+    }
+}
+
+// Unblocked i-k-j loop for tiny problems
+template <typename S, typename A>
+static void gemmSmall(size_t m, size_t n, size_t k,
+                      const S* a, size_t rsa, size_t csa,
+                      const S* b, size_t rsb, size_t csb,
+                      A* c, size_t ldc, const Epilogue<A>* ep) {
+    for (size_t i = 0; i < m; ++i) {
+        A* c_row = c + i * ldc;
+        std::fill_n(c_row, n, A(0));
+        for (size_t p = 0; p < k; ++p) {
+            A a_ip = static_cast<A>(a[i * rsa + p * csa]);
+            const S* b_row = b + p * rsb;
+            for (size_t j = 0; j < n; ++j) {
+                c_row[j] += a_ip * static_cast<A>(b_row[j * csb]);
+            }
+        }
+        if (ep) {
+            applyEpilogue(ep->at(i, 0), 1, n, c_row, ldc);
+        }
+    }
+}
+
+// Single-threaded packed GEMM over one output tile
+template <typename S, typename A>
+static void gemmBlocked(size_t m, size_t n, size_t k,
+                        const S* a, size_t rsa, size_t csa,
+                        const S* b, size_t rsb, size_t csb,
+                        A* c, size_t ldc, const Epilogue<A>* ep) {
+    // The microkernel and its register tile come from the active ISA
+    const simd::detail::KernelSet<A>& kernels = simd::detail::kernelsFor<A>();
+    const size_t MR = kernels.mr;
+    const size_t NR = kernels.nr;
+
+    // Packing buffers are reused across calls on the same thread, so they
+    // always come from the heap rather than whatever resource is current
+    thread_local PackBuffer<A> packed_a{AlignedAllocator<A>(heapResource())};
+    thread_local PackBuffer<A> packed_b{AlignedAllocator<A>(heapResource())};
+    packed_a.resize(MC * KC);
+    packed_b.resize(KC * ((std::min(NC, n) + NR - 1) / NR * NR));
+
+    for (size_t jc = 0; jc < n; jc += NC) {
+        size_t nc = std::min(NC, n - jc);
+        for (size_t pc = 0; pc < k; pc += KC) {
+            size_t kc = std::min(KC, k - pc);
+            bool accumulate = pc != 0;
+            bool last = pc + kc == k;
+            packB(NR, kc, nc, b + pc * rsb + jc * csb, rsb, csb, packed_b.data());
+
+            for (size_t ic = 0; ic < m; ic += MC) {
+                size_t mc = std::min(MC, m - ic);
+                packA(MR, mc, kc, a + ic * rsa + pc * csa, rsa, csa, packed_a.data());
+
+                for (size_t jr = 0; jr < nc; jr += NR) {
+                    size_t nr = std::min(NR, nc - jr);
+                    const A* b_sliver = packed_b.data() + jr * kc;
+                    for (size_t ir = 0; ir < mc; ir += MR) {
+                        size_t mr = std::min(MR, mc - ir);
+                        A* c_tile = c + (ic + ir) * ldc + jc + jr;
+                        kernels.gemm_micro(kc, packed_a.data() + ir * kc, b_sliver, c_tile, ldc, mr, nr, accumulate);
+                        if (last && ep) {
+                            // The tile was just written and is still in L1
+                            applyEpilogue(ep->at(ic + ir, jc + jr), mr, nr, c_tile, ldc);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static size_t ceilDiv(size_t x, size_t y) {
+    return (x + y - 1) / y;
+}
+
+// Output tiles of a parallel product
+struct TileGrid {
+    size_t tile_m;
+    size_t tile_n;
+    size_t m_tiles;
+    size_t n_tiles;
+
+    size_t count() const { return m_tiles * n_tiles; }
+
+    // Split C into a grid of tiles: whole MC row blocks first, then columns
+    // (in NR multiples) when there are too few row blocks to go round
+    static TileGrid plan(size_t m, size_t n, size_t NR, size_t threads) {
+        size_t wanted = threads * kTilesPerThread;
+        TileGrid grid;
+        grid.tile_m = MC;
+        grid.m_tiles = ceilDiv(m, grid.tile_m);
+        grid.n_tiles = 1;
+        if (grid.m_tiles < wanted) {
+            grid.n_tiles = std::min(ceilDiv(wanted, grid.m_tiles), ceilDiv(n, 8 * NR));
+        }
+        grid.tile_n = ceilDiv(ceilDiv(n, grid.n_tiles), NR) * NR;
+        grid.n_tiles = ceilDiv(n, grid.tile_n);
+        return grid;
+    }
+};
+
+// Serial/parallel driver: C (in the compute type A) = A * B
+template <typename S, typename A>
+static void gemmDriver(size_t m, size_t n, size_t k,
+                       const S* a, size_t rsa, size_t csa,
+                       const S* b, size_t rsb, size_t csb,
+                       A* c, size_t ldc, const Epilogue<A>* ep) {
+    if (k == 0) {
+        for (size_t i = 0; i < m; ++i) {
+            std::fill_n(c + i * ldc, n, A(0));
+        }
+        if (ep) {
+            applyEpilogue(*ep, m, n, c, ldc);
+        }
+        return;
+    }
+    if (m * n * k <= kSmallGemmFlops) {
+        gemmSmall<S, A>(m, n, k, a, rsa, csa, b, rsb, csb, c, ldc, ep);
+        return;
+    }
+
+    const size_t NR = simd::detail::kernelsFor<A>().nr;
+    size_t threads = ThreadPool::inWorker() ? 1 : getNumThreads();
+    if (threads == 1 || m * n * k < kParallelGemmFlops) {
+        gemmBlocked<S, A>(m, n, k, a, rsa, csa, b, rsb, csb, c, ldc, ep);
+        return;
+    }
+
+    TileGrid grid = TileGrid::plan(m, n, NR, threads);
+    globalThreadPool().parallelFor(grid.count(), [&](size_t tile) {
+        size_t i0 = (tile / grid.n_tiles) * grid.tile_m;
+        size_t j0 = (tile % grid.n_tiles) * grid.tile_n;
+        Epilogue<A> tile_ep;
+        if (ep) {
+            tile_ep = ep->at(i0, j0);
+        }
+        gemmBlocked<S, A>(std::min(grid.tile_m, m - i0), std::min(grid.tile_n, n - j0), k,
+                          a + i0 * rsa, rsa, csa,
+                          b + j0 * csb, rsb, csb,
+                          c + i0 * ldc + j0, ldc, ep ? &tile_ep : nullptr);
+    });
+}
+
+// Pre-packed B panels. Block (jc, pc) of the NC x KC blocking starts at
+// jc * k + pc * ncp, where ncp is the block width rounded up to NR (every
+// block but the last is NC wide, a multiple of NR), and holds exactly what
+// packB() produces for that block.
+
+size_t packedPanelSize(size_t k, size_t n, size_t nr) {
+    size_t size = 0;
+    for (size_t jc = 0; jc < n; jc += NC) {
+        size += k * ceilDiv(std::min(NC, n - jc), nr) * nr;
+    }
+    return size;
+}
+
+void packPanels(size_t k, size_t n, const double* b, size_t rsb, size_t csb, size_t nr, double* out) {
+    for (size_t jc = 0; jc < n; jc += NC) {
+        size_t nc = std::min(NC, n - jc);
+        size_t ncp = ceilDiv(nc, nr) * nr;
+        for (size_t pc = 0; pc < k; pc += KC) {
+            size_t kc = std::min(KC, k - pc);
+            packB(nr, kc, nc, b + pc * rsb + jc * csb, rsb, csb, out + jc * k + pc * ncp);
+        }
+    }
+}
+
+void unpackPanels(size_t k, size_t n, const double* packed, size_t nr, double* b, size_t ldb) {
+    for (size_t jc = 0; jc < n; jc += NC) {
+        size_t nc = std::min(NC, n - jc);
+        size_t ncp = ceilDiv(nc, nr) * nr;
+        for (size_t pc = 0; pc < k; pc += KC) {
+            size_t kc = std::min(KC, k - pc);
+            const double* block = packed + jc * k + pc * ncp;
+            for (size_t jr = 0; jr < nc; jr += nr) {
+                size_t width = std::min(nr, nc - jr);
+                for (size_t p = 0; p < kc; ++p) {
+                    std::copy_n(block + jr * kc + p * nr, width, b + (pc + p) * ldb + jc + jr);
+                }
+            }
+        }
+    }
+}
+
+// Packed GEMM over the columns [j0, j0 + nt) of C, which is addressed
+// (like ep) from its origin; j0 is a multiple of NR
+static void gemmPackedTile(size_t m, size_t n, size_t k, size_t j0, size_t nt,
+                           const double* a, size_t rsa, size_t csa, const double* packed_b,
+                           double* c, size_t ldc, const Epilogue<double>* ep) {
+    const simd::detail::KernelSet<double>& kernels = simd::detail::kernelsFor<double>();
+    const size_t MR = kernels.mr;
+    const size_t NR = kernels.nr;
+
+    thread_local PackBuffer<double> packed_a{AlignedAllocator<double>(heapResource())};
+    packed_a.resize(MC * KC);
+
+    for (size_t jc = j0 / NC * NC; jc < j0 + nt; jc += NC) {
+        size_t nc = std::min(NC, n - jc);
+        size_t ncp = ceilDiv(nc, NR) * NR;
+        size_t j_begin = std::max(j0, jc) - jc;
+        size_t j_end = std::min(j0 + nt, jc + nc) - jc;
+        for (size_t pc = 0; pc < k; pc += KC) {
+            size_t kc = std::min(KC, k - pc);
+            bool accumulate = pc != 0;
+            bool last = pc + kc == k;
+            const double* block = packed_b + jc * k + pc * ncp;
+
+            for (size_t ic = 0; ic < m; ic += MC) {
+                size_t mc = std::min(MC, m - ic);
+                packA(MR, mc, kc, a + ic * rsa + pc * csa, rsa, csa, packed_a.data());
+
+                for (size_t jr = j_begin; jr < j_end; jr += NR) {
+                    size_t nr = std::min(NR, j_end - jr);
+                    const double* b_sliver = block + jr * kc;
+                    for (size_t ir = 0; ir < mc; ir += MR) {
+                        size_t mr = std::min(MR, mc - ir);
+                        double* c_tile = c + (ic + ir) * ldc + jc + jr;
+                        kernels.gemm_micro(kc, packed_a.data() + ir * kc, b_sliver, c_tile, ldc, mr, nr, accumulate);
+                        if (last && ep) {
+                            applyEpilogue(ep->at(ic + ir, jc + jr), mr, nr, c_tile, ldc);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void gemmPacked(size_t m, size_t n, size_t k,
+                const double* a, size_t rsa, size_t csa,
+                const double* packed_b, size_t nr,
+                double* c, size_t ldc,
+                const Epilogue<double>& epilogue) {
+    const size_t NR = simd::detail::kernelsFor<double>().nr;
+    if (nr != NR) {
+        throw std::logic_error("B was packed for " + std::to_string(nr) + "-column slivers, the active kernel uses "
+                               + std::to_string(NR));
+    }
+    if (m == 0 || n == 0) {
+        return;
+    }
+    const Epilogue<double>* ep = epilogue.empty() ? nullptr : &epilogue;
+    if (k == 0) {
+        for (size_t i = 0; i < m; ++i) {
+            std::fill_n(c + i * ldc, n, 0.0);
+        }
+        if (ep) {
+            applyEpilogue(*ep, m, n, c, ldc);
+        }
+        return;
+    }
+
+    size_t threads = ThreadPool::inWorker() ? 1 : getNumThreads();
+    if (threads == 1 || m * n * k < kParallelGemmFlops) {
+        gemmPackedTile(m, n, k, 0, n, a, rsa, csa, packed_b, c, ldc, ep);
+        return;
+    }
+    TileGrid grid = TileGrid::plan(m, n, NR, threads);
+    globalThreadPool().parallelFor(grid.count(), [&](size_t tile) {
+        size_t i0 = (tile / grid.n_tiles) * grid.tile_m;
+        size_t j0 = (tile % grid.n_tiles) * grid.tile_n;
+        Epilogue<double> tile_ep;
+        if (ep) {
+            tile_ep = ep->at(i0, 0);
+        }
+        gemmPackedTile(std::min(grid.tile_m, m - i0), n, k, j0, std::min(grid.tile_n, n - j0),
+                       a + i0 * rsa, rsa, csa, packed_b, c + i0 * ldc, ldc, ep ? &tile_ep : nullptr);
+    });
+}
+
+template <typename T>
+void gemm(size_t m, size_t n, size_t k,
+          const T* a, size_t rsa, size_t csa,
+          const T* b, size_t rsb, size_t csb,
+          T* c, size_t ldc,
+          const Epilogue<T>& epilogue) {
+    using A = ComputeType<T>;
+    if (m == 0 || n == 0) {
+        return;
+    }
+    if constexpr (std::is_same_v<T, A>) {
+        gemmDriver<T, A>(m, n, k, a, rsa, csa, b, rsb, csb, c, ldc, epilogue.empty() ? nullptr : &epilogue);
+    } else {
+        // Reduced-precision storage: accumulate the full product in the
+        // compute type and round to T once
+        thread_local PackBuffer<A> wide_c{AlignedAllocator<A>(heapResource())};
+        wide_c.resize(m * n);
+        gemmDriver<T, A>(m, n, k, a, rsa, csa, b, rsb, csb, wide_c.data(), n, nullptr);
+        if (epilogue.empty()) {
+            for (size_t i = 0; i < m; ++i) {
+                for (size_t j = 0; j < n; ++j) {
+                    c[i * ldc + j] = static_cast<T>(wide_c[i * n + j]);
+                }
+            }
+            return;
+        }
+        // The epilogue runs on the wide values during the rounding pass
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                A z = wide_c[i * n + j];
+                if (epilogue.bias) {
+                    z += static_cast<A>(epilogue.bias[j]);
+                }
+                if (epilogue.pre_activation) {
+                    epilogue.pre_activation[i * epilogue.ld_pre + j] = static_cast<T>(z);
+                }
+                switch (epilogue.activation) {
+                case EpilogueActivation::None:
+                    break;
+                case EpilogueActivation::ReLU:
+                    z = std::max(z, A(0));
+                    break;
+                case EpilogueActivation::Sigmoid:
+                    z = A(1) / (A(1) + std::exp(-z));
+                    break;
+                case EpilogueActivation::Tanh:
+                    z = std::tanh(z);
+                    break;
+                case EpilogueActivation::GELU:
+                    z = A(0.5) * z * (A(1) + std::tanh(A(0.7978845608028654) * (z + A(0.044715) * z * z * z)));
+                    break;
+                }
+                c[i * ldc + j] = static_cast<T>(z);
+            }
+        }
+    }
+}
+
+template void gemm<double>(size_t, size_t, size_t, const double*, size_t, size_t,
+                           const double*, size_t, size_t, double*, size_t, const Epilogue<double>&);
+template void gemm<float>(size_t, size_t, size_t, const float*, size_t, size_t,
+                          const float*, size_t, size_t, float*, size_t, const Epilogue<float>&);
+template void gemm<bfloat16>(size_t, size_t, size_t, const bfloat16*, size_t, size_t,
+                             const bfloat16*, size_t, size_t, bfloat16*, size_t, const Epilogue<bfloat16>&);
+
+} // namespace detail
+} // namespace matrix
@@ -0,0 +1,60 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include <cstddef>
+#include "epilogue.h"
+
+namespace matrix {
+namespace detail {
+
+// Cache-blocked GEMM: C = A * B.
+//
+// A is m x k, B is k x n and C is m x n. A and B are addressed through a row
+// stride and a column stride so that transposed or sliced operands need no
+// copy; C is row-major with leading dimension ldc and is overwritten.
+//
+// T is double, float or bfloat16. Operands are widened to ComputeType<T>
+// while packing and the whole k reduction runs at that precision; for
+// bfloat16 the float result is rounded to bfloat16 only once at the end.
+//
+// The result differs from the textbook i-j-k loop only in the order in which
+// the k partial products are summed. Each element therefore agrees with the
+// naive result to within k * eps * sum_p |a_ip * b_pj| (standard
+// floating-point summation bound, eps of the compute type); for well-scaled
+// double inputs this is ~1e-13 relative at k = 1024.
+//
+// Large products are split into output tiles that run on the shared
+// ThreadPool; small ones (and calls from inside a pool task) stay serial.
+// Tiling does not change the per-element summation order, so the threaded
+// result is bitwise identical to the single-threaded one.
+//
+// A non-empty epilogue (see epilogue.h) is applied to each register tile of
+// C right after its last k block, instead of in a separate pass over C.
+template <typename T>
+void gemm(size_t m, size_t n, size_t k,
+          const T* a, size_t rsa, size_t csa,
+          const T* b, size_t rsb, size_t csb,
+          T* c, size_t ldc,
+          const Epilogue<T>& epilogue = {});
+
+// Pre-packed B for repeated products against the same right-hand side
+// (e.g. layer weights). packPanels() stores a k x n B in the blocked
+// NR-column sliver layout gemm() would otherwise build on every call
+// (packedPanelSize() elements); unpackPanels() reverses it into a row-major
+// k x n buffer. gemmPacked() is gemm() for double with B already packed,
+// skipping that work, and sums in the same order for products large enough
+// to take gemm()'s packed path. nr must be the active kernel's register
+// tile width, or gemmPacked() throws std::logic_error.
+size_t packedPanelSize(size_t k, size_t n, size_t nr);
+void packPanels(size_t k, size_t n, const double* b, size_t rsb, size_t csb, size_t nr, double* out);
+void unpackPanels(size_t k, size_t n, const double* packed, size_t nr, double* b, size_t ldb);
+void gemmPacked(size_t m, size_t n, size_t k,
+                const double* a, size_t rsa, size_t csa,
+                const double* packed_b, size_t nr,
+                double* c, size_t ldc,
+                const Epilogue<double>& epilogue = {});
+
+} // namespace detail
+} // namespace matrix
+
+#endif // GEMM_H
@@ -1,108 +1,239 @@
 #include "matrix.h"
+#include "gemm.h"
+#include "../profiler/profiler.h"
+#include <algorithm>
+#include <utility>
 
 namespace matrix {
 
+// Rows of at least this many bytes are padded to a whole number of cache
+// lines; narrower rows are stored tightly so small matrices stay small.
+static constexpr size_t kPadThresholdBytes = 512;
+
+template <typename T>
+size_t BasicMatrix<T>::strideFor(size_t cols) {
+    constexpr size_t line_elems = kMatrixAlignment / sizeof(T);
+    if (cols * sizeof(T) < kPadThresholdBytes) {
+        return cols;
+    }
+    return (cols + line_elems - 1) / line_elems * line_elems;
+}
+
 // Default constructor
-Matrix::Matrix() : rows(0), cols(0) {}
+template <typename T>
+BasicMatrix<T>::BasicMatrix() : rows(0), cols(0), stride(0) {}
 
 // Constructor with dimensions
-Matrix::Matrix(size_t rows, size_t cols) : rows(rows), cols(cols) {
-    data.resize(rows, std::vector<double>(cols, 0.0));
-}
+template <typename T>
+BasicMatrix<T>::BasicMatrix(size_t rows, size_t cols)
+    : storage(rows * strideFor(cols), T{}), rows(rows), cols(cols), stride(strideFor(cols)) {}
 
 // Constructor with dimensions and initial value
-Matrix::Matrix(size_t rows, size_t cols, double initial_value) : rows(rows), cols(cols) {
-    data.resize(rows, std::vector<double>(cols, initial_value));
+template <typename T>
+BasicMatrix<T>::BasicMatrix(size_t rows, size_t cols, T initial_value) : BasicMatrix(rows, cols) {
+    for (size_t i = 0; i < rows; ++i) {
+        std::fill_n(storage.data() + i * stride, cols, initial_value);
+    }
 }
 
 // Constructor with data
-Matrix::Matrix(const std::vector<std::vector<double>>& data) {
+template <typename T>
+BasicMatrix<T>::BasicMatrix(const std::vector<std::vector<T>>& data) : BasicMatrix() {
     if (data.empty()) {
-        rows = 0;
-        cols = 0;
-    } else {
-        rows = data.size();
-        cols = data[0].size();
-        
-        // Check if all rows have the same number of columns
-        for (const auto& row : data) {
-            if (row.size() != cols) {
-                throw std::invalid_argument("All rows must have the same number of columns");
-            }
+        return;
+    }
+
+    size_t num_cols = data[0].size();
+
+    // Check if all rows have the same number of columns
+    for (const auto& row : data) {
+        if (row.size() != num_cols) {
+            throw std::invalid_argument("All rows must have the same number of columns");
         }
-        
-        this->data = data;
+    }
+
+    rows = data.size();
+    cols = num_cols;
+    stride = strideFor(cols);
+    storage.assign(rows * stride, T{});
+    for (size_t i = 0; i < rows; ++i) {
+        std::copy(data[i].begin(), data[i].end(), storage.data() + i * stride);
     }
 }
 
 // Copy constructor
-Matrix::Matrix(const Matrix& other) : data(other.data), rows(other.rows), cols(other.cols) {}
+template <typename T>
+BasicMatrix<T>::BasicMatrix(const BasicMatrix& other)
+    : storage(other.storage), rows(other.rows), cols(other.cols), stride(other.stride) {}
+
+// Move constructor
+template <typename T>
+BasicMatrix<T>::BasicMatrix(BasicMatrix&& other) noexcept
+    : storage(std::move(other.storage)),
+      rows(std::exchange(other.rows, 0)),
+      cols(std::exchange(other.cols, 0)),
+      stride(std::exchange(other.stride, 0)) {}
+
+// Copy assignment
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator=(const BasicMatrix& other) {
+    if (this != &other) {
+        storage = other.storage;
+        rows = other.rows;
+        cols = other.cols;
+        stride = other.stride;
+    }
+    return *this;
+}
+
+// Move assignment
+template <typename T>
+BasicMatrix<T>& BasicMatrix<T>::operator=(BasicMatrix&& other) {
+    if (this != &other) {
+        storage = std::move(other.storage);
+        other.storage.clear();
+        other.storage.shrink_to_fit();
+        rows = std::exchange(other.rows, 0);
+        cols = std::exchange(other.cols, 0);
+        stride = std::exchange(other.stride, 0);
+    }
+    return *this;
+}
+
+// Reshape, reusing the buffer where possible
+template <typename T>
+void BasicMatrix<T>::resize(size_t new_rows, size_t new_cols) {
+    if (new_rows == rows && new_cols == cols) {
+        return;
+    }
+    rows = new_rows;
+    cols = new_cols;
+    stride = strideFor(new_cols);
+    storage.assign(rows * stride, T{});
+}
 
 // Get number of rows
-size_t Matrix::getRows() const {
+template <typename T>
+size_t BasicMatrix<T>::getRows() const {
     return rows;
 }
 
 // Get number of columns
-size_t Matrix::getCols() const {
+template <typename T>
+size_t BasicMatrix<T>::getCols() const {
     return cols;
 }
 
 // Access element (for reading)
-double Matrix::get(size_t row, size_t col) const {
+template <typename T>
+T BasicMatrix<T>::get(size_t row, size_t col) const {
     if (row >= rows || col >= cols) {
         throw std::out_of_range("Matrix indices out of range");
     }
-    return data[row][col];
+    return storage[row * stride + col];
 }
 
 // Set element value
-void Matrix::set(size_t row, size_t col, double value) {
+template <typename T>
+void BasicMatrix<T>::set(size_t row, size_t col, T value) {
     if (row >= rows || col >= cols) {
         throw std::out_of_range("Matrix indices out of range");
     }
-    data[row][col] = value;
+    storage[row * stride + col] = value;
 }
 
 // Matrix multiplication
-Matrix Matrix::multiply(const Matrix& other) const {
-    return Matrix::multiply(*this, other);
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::multiply(const BasicMatrix& other) const {
+    return BasicMatrix::multiply(*this, other);
 }
 
 // Static matrix multiplication function
-Matrix Matrix::multiply(const Matrix& a, const Matrix& b) {
+template <typename T>
+BasicMatrix<T> BasicMatrix<T>::multiply(const BasicMatrix& a, const BasicMatrix& b) {
+    BasicMatrix result;
+    multiplyInto(a, b, result);
+    return result;
+}
+
+// Matrix multiplication into a caller-owned result
+template <typename T>
+void BasicMatrix<T>::multiplyInto(const BasicMatrix& a, const BasicMatrix& b, BasicMatrix& out) {
     // Check if matrices can be multiplied
     if (a.getCols() != b.getRows()) {
         throw std::invalid_argument("Matrix dimensions mismatch for multiplication: "
                                    + std::to_string(a.getRows()) + "x" + std::to_string(a.getCols())
                                    + " and " + std::to_string(b.getRows()) + "x" + std::to_string(b.getCols()));
     }
-    
-    // Create result matrix initialized with zeros
-    Matrix result(a.getRows(), b.getCols());
-    
-    // Perform matrix multiplication
-    for (size_t i = 0; i < a.getRows(); ++i) {
-        for (size_t j = 0; j < b.getCols(); ++j) {
-            double sum = 0.0;
-            for (size_t k = 0; k < a.getCols(); ++k) {
-                sum += a.get(i, k) * b.get(k, j);
-            }
-            result.set(i, j, sum);
+    if (&out == &a || &out == &b) {
+        throw std::invalid_argument("Matrix multiplication output must not alias an operand");
+    }
+
+    PROFILE_SCOPE_FLOPS("Matrix::multiply", "gemm",
+                        2.0 * double(a.getRows()) * double(b.getCols()) * double(a.getCols()));
+    out.resize(a.getRows(), b.getCols());
+
+    // Packed, cache-blocked kernel; see gemm.h for the accuracy contract
+    detail::gemm<T>(a.getRows(), b.getCols(), a.getCols(),
+                    a.data(), a.getStride(), 1,
+                    b.data(), b.getStride(), 1,
+                    out.data(), out.getStride());
+}
+
+// Fused multiply + bias + activation into a caller-owned result
+template <typename T>
+void BasicMatrix<T>::multiplyInto(const BasicMatrix& a, const BasicMatrix& b, const BasicMatrix& bias,
+                                  EpilogueActivation activation, BasicMatrix& out,
+                                  BasicMatrix* pre_activation) {
+    if (a.getCols() != b.getRows()) {
+        throw std::invalid_argument("Matrix dimensions mismatch for multiplication: "
+                                   + std::to_string(a.getRows()) + "x" + std::to_string(a.getCols())
+                                   + " and " + std::to_string(b.getRows()) + "x" + std::to_string(b.getCols()));
+    }
+    bool has_bias = bias.getRows() != 0 || bias.getCols() != 0;
+    if (has_bias && (bias.getRows() != 1 || bias.getCols() != b.getCols())) {
+        throw std::invalid_argument("Bias must be a 1x" + std::to_string(b.getCols()) + " row");
+    }
+    for (const BasicMatrix* target : {&out, pre_activation}) {
+        if (target && (target == &a || target == &b || target == &bias)) {
+            throw std::invalid_argument("Matrix multiplication output must not alias an operand");
         }
     }
-    
-    return result;
+    if (pre_activation == &out) {
+        throw std::invalid_argument("Pre-activation output must differ from the result");
+    }
+
+    PROFILE_SCOPE_FLOPS("Matrix::multiply", "gemm",
+                        2.0 * double(a.getRows()) * double(b.getCols()) * double(a.getCols()));
+    out.resize(a.getRows(), b.getCols());
+    Epilogue<T> epilogue;
+    epilogue.bias = has_bias ? bias.data() : nullptr;
+    epilogue.activation = activation;
+    if (pre_activation) {
+        pre_activation->resize(a.getRows(), b.getCols());
+        epilogue.pre_activation = pre_activation->data();
+        epilogue.ld_pre = pre_activation->getStride();
+    }
+
+    detail::gemm<T>(a.getRows(), b.getCols(), a.getCols(),
+                    a.data(), a.getStride(), 1,
+                    b.data(), b.getStride(), 1,
+                    out.data(), out.getStride(), epilogue);
 }
 
 // Print matrix
-void Matrix::print() const {
+template <typename T>
+void BasicMatrix<T>::print() const {
     for (size_t i = 0; i < rows; ++i) {
         for (size_t j = 0; j < cols; ++j) {
-            std::cout << data[i][j] << " ";
+            std::cout << static_cast<ComputeType<T>>((*this)(i, j)) << " ";
         }
         std::cout << std::endl;
     }
 }
 
+template class BasicMatrix<double>;
+template class BasicMatrix<float>;
+template class BasicMatrix<bfloat16>;
+
 } // namespace matrix
@@ -2,55 +2,201 @@
 #define MATRIX_H
 
 #include <vector>
+#include <span>
 #include <stdexcept>
 #include <iostream>
+#include <utility>
+#include "aligned_allocator.h"
+#include "bfloat16.h"
+#include "epilogue.h"
 
 namespace matrix {
 
-class Matrix {
+// Lazy element-wise expression (see expression.h)
+template <typename E>
+class MatrixExpr;
+
+// Dense row-major matrix backed by a single aligned buffer.
+//
+// Element (i, j) lives at data()[i * getStride() + j]. Wide rows are padded
+// so that every row starts on a cache-line boundary; the padding is kept at
+// zero and is never visible through the public element accessors.
+//
+// The element type T is one of double, float or bfloat16. Products are
+// computed in ComputeType<T> (float for bfloat16) and rounded to T once, at
+// the end.
+template <typename T>
+class BasicMatrix {
 private:
-    std::vector<std::vector<double>> data;
+    std::vector<T, AlignedAllocator<T>> storage;
     size_t rows;
     size_t cols;
+    size_t stride;
+
+    // Row stride (in elements) used for a matrix with the given column count
+    static size_t strideFor(size_t cols);
+
+    // Evaluate an expression into this matrix in one pass. Evaluates in
+    // place when the shape is unchanged (element-wise expressions only read
+    // the element they write); otherwise into a fresh buffer.
+    template <typename E>
+    void assignExpr(const E& e) {
+        if (e.rows() != rows || e.cols() != cols) {
+            BasicMatrix result(e.rows(), e.cols());
+            result.assignExpr(e);
+            *this = std::move(result);
+            return;
+        }
+        for (size_t i = 0; i < rows; ++i) {
+            auto src = e.row(i);
+            T* dst = storage.data() + i * stride;
+            for (size_t j = 0; j < cols; ++j) {
+                dst[j] = src[j];
+            }
+        }
+    }
 
 public:
+    using value_type = T;
+
     // Default constructor
-    Matrix();
+    BasicMatrix();
     
     // Constructor with dimensions
-    Matrix(size_t rows, size_t cols);
+    BasicMatrix(size_t rows, size_t cols);
     
     // Constructor with dimensions and initial value
-    Matrix(size_t rows, size_t cols, double initial_value);
+    BasicMatrix(size_t rows, size_t cols, T initial_value);
     
     // Constructor with data
-    Matrix(const std::vector<std::vector<double>>& data);
+    BasicMatrix(const std::vector<std::vector<T>>& data);
     
     // Copy constructor
-    Matrix(const Matrix& other);
+    BasicMatrix(const BasicMatrix& other);
+
+    // Converting constructor from a matrix of another element type
+    template <typename U>
+    explicit BasicMatrix(const BasicMatrix<U>& other) : BasicMatrix(other.getRows(), other.getCols()) {
+        for (size_t i = 0; i < rows; ++i) {
+            const U* src = other.row(i).data();
+            T* dst = row(i).data();
+            for (size_t j = 0; j < cols; ++j) {
+                dst[j] = static_cast<T>(src[j]);
+            }
+        }
+    }
+
+    // Evaluate a lazy element-wise expression (see expression.h)
+    template <typename E>
+    BasicMatrix(const MatrixExpr<E>& expr) : BasicMatrix() {
+        assignExpr(expr.derived());
+    }
+
+    // Move constructor; leaves other empty (0x0)
+    BasicMatrix(BasicMatrix&& other) noexcept;
+
+    // Copy assignment (reuses this matrix's buffer when it is large enough)
+    BasicMatrix& operator=(const BasicMatrix& other);
+
+    // Move assignment; leaves other empty (0x0). Takes over other's buffer
+    // when both use the same memory resource; otherwise copies into this
+    // matrix's resource (see memory_resource.h).
+    BasicMatrix& operator=(BasicMatrix&& other);
+
+    // Evaluate a lazy element-wise expression into this matrix
+    template <typename E>
+    BasicMatrix& operator=(const MatrixExpr<E>& expr) {
+        assignExpr(expr.derived());
+        return *this;
+    }
     
     // Get number of rows
     size_t getRows() const;
     
     // Get number of columns
     size_t getCols() const;
+
+    // Get distance (in elements) between the starts of consecutive rows
+    size_t getStride() const { return stride; }
+
+    // Memory resource this matrix's buffer comes from
+    MemoryResource* getResource() const { return storage.get_allocator().resource(); }
+
+    // Reshape to rows x cols. A no-op when the shape is unchanged; otherwise
+    // the contents are reset to zero, reusing the existing buffer if it has
+    // enough capacity.
+    void resize(size_t rows, size_t cols);
     
     // Access element (for reading)
-    double get(size_t row, size_t col) const;
+    T get(size_t row, size_t col) const;
     
     // Set element value
-    void set(size_t row, size_t col, double value);
+    void set(size_t row, size_t col, T value);
+
+    // Unchecked element access for hot loops
+    T& operator()(size_t row, size_t col) { return storage[row * stride + col]; }
+    T operator()(size_t row, size_t col) const { return storage[row * stride + col]; }
+
+    // Raw pointer to the first element of the underlying buffer
+    T* data() { return storage.data(); }
+    const T* data() const { return storage.data(); }
+
+    // Span over the cols elements of a single row (unchecked)
+    std::span<T> row(size_t i) { return {storage.data() + i * stride, cols}; }
+    std::span<const T> row(size_t i) const { return {storage.data() + i * stride, cols}; }
     
     // Matrix multiplication
-    Matrix multiply(const Matrix& other) const;
+    BasicMatrix multiply(const BasicMatrix& other) const;
     
     // Static matrix multiplication function
-    static Matrix multiply(const Matrix& a, const Matrix& b);
+    static BasicMatrix multiply(const BasicMatrix& a, const BasicMatrix& b);
+
+    // Matrix multiplication into a caller-owned result, which is resized to
+    // a.getRows() x b.getCols(). Does not allocate once out has reached that
+    // size. out must not be a or b.
+    static void multiplyInto(const BasicMatrix& a, const BasicMatrix& b, BasicMatrix& out);
+
+    // Fused product out = activation(a * b + bias): the bias add and the
+    // activation run on each output tile inside the product rather than as
+    // extra passes over out. bias is 1 x b.getCols(), or empty (0x0) for
+    // none. If pre_activation is non-null it is resized like out and
+    // receives a * b + bias. Neither out nor pre_activation may alias an
+    // input.
+    static void multiplyInto(const BasicMatrix& a, const BasicMatrix& b, const BasicMatrix& bias,
+                             EpilogueActivation activation, BasicMatrix& out,
+                             BasicMatrix* pre_activation = nullptr);
     
     // Print matrix
     void print() const;
 };
 
+// Type GEMM accumulates in for a given element type
+template <typename T>
+struct ComputeTypeOf {
+    using type = T;
+};
+
+template <>
+struct ComputeTypeOf<bfloat16> {
+    using type = float;
+};
+
+template <typename T>
+using ComputeType = typename ComputeTypeOf<T>::type;
+
+extern template class BasicMatrix<double>;
+extern template class BasicMatrix<float>;
+extern template class BasicMatrix<bfloat16>;
+
+// Double precision matrix used throughout the neural library
+using Matrix = BasicMatrix<double>;
+
+// Single precision matrix for inference (twice the SIMD width of Matrix)
+using MatrixF = BasicMatrix<float>;
+
+// Reduced-precision storage; products accumulate in float
+using MatrixBF16 = BasicMatrix<bfloat16>;
+
 } // namespace matrix
 
 #endif // MATRIX_H
@@ -0,0 +1,287 @@
+#include "matrix_io.h"
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace matrix {
+
+static_assert(std::endian::native == std::endian::little,
+              "The matrix file format is little-endian; big-endian hosts need byte swapping");
+
+static constexpr uint64_t kRecordAlignment = 64;
+
+size_t dtypeSize(DType dtype) {
+    switch (dtype) {
+    case DType::Float64:
+        return 8;
+    case DType::Float32:
+        return 4;
+    case DType::BFloat16:
+        return 2;
+    }
+    return 0;
+}
+
+const char* dtypeName(DType dtype) {
+    switch (dtype) {
+    case DType::Float64:
+        return "float64";
+    case DType::Float32:
+        return "float32";
+    case DType::BFloat16:
+        return "bfloat16";
+    }
+    return "unknown";
+}
+
+// XXH64 (Yann Collet), the reference algorithm
+namespace {
+
+constexpr uint64_t kPrime1 = 11400714785074694791ULL;
+constexpr uint64_t kPrime2 = 14029467366897019727ULL;
+constexpr uint64_t kPrime3 = 1609587929392839161ULL;
+constexpr uint64_t kPrime4 = 9650029242287828579ULL;
+constexpr uint64_t kPrime5 = 2870177450012600261ULL;
+
+uint64_t read64(const unsigned char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint64_t round64(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    acc = std::rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+uint64_t mergeRound(uint64_t acc, uint64_t value) {
+    acc ^= round64(0, value);
+    return acc * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+uint64_t checksum64(const void* data, size_t size, uint64_t seed) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    uint64_t h;
+    if (size >= 32) {
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+        for (; end - p >= 32; p += 32) {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+        }
+        h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = seed + kPrime5;
+    }
+    h += static_cast<uint64_t>(size);
+    for (; end - p >= 8; p += 8) {
+        h ^= round64(0, read64(p));
+        h = std::rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if (end - p >= 4) {
+        h ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+        h = std::rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= static_cast<uint64_t>(*p) * kPrime5;
+        h = std::rotl(h, 11) * kPrime1;
+    }
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+template <typename T>
+uint64_t writeMatrix(std::ostream& out, const BasicMatrix<T>& m) {
+    static const char zeros[kRecordAlignment] = {};
+    uint64_t position = static_cast<uint64_t>(out.tellp());
+    uint64_t padding = (kRecordAlignment - position % kRecordAlignment) % kRecordAlignment;
+    out.write(zeros, static_cast<std::streamsize>(padding));
+
+    MatrixFileHeader header{};
+    std::memcpy(header.magic, kMatrixFileMagic, sizeof(header.magic));
+    header.version = kMatrixFileVersion;
+    header.dtype = static_cast<uint32_t>(DTypeOf<T>::value);
+    header.rows = m.getRows();
+    header.cols = m.getCols();
+    header.row_stride = m.getStride();
+    header.col_stride = 1;
+    header.data_offset = sizeof(MatrixFileHeader);
+    header.data_bytes = m.getRows() * m.getStride() * sizeof(T);
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(m.data()), static_cast<std::streamsize>(header.data_bytes));
+    if (!out) {
+        throw MatrixFileError("Failed to write matrix record");
+    }
+    return position + padding;
+}
+
+template <typename T>
+void saveMatrix(const std::string& path, const BasicMatrix<T>& m) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw MatrixFileError("Cannot open matrix file for writing: " + path);
+    }
+    writeMatrix(out, m);
+    out.close();
+    if (!out) {
+        throw MatrixFileError("Failed to write matrix file: " + path);
+    }
+}
+
+template uint64_t writeMatrix<double>(std::ostream&, const BasicMatrix<double>&);
+template uint64_t writeMatrix<float>(std::ostream&, const BasicMatrix<float>&);
+template uint64_t writeMatrix<bfloat16>(std::ostream&, const BasicMatrix<bfloat16>&);
+template void saveMatrix<double>(const std::string&, const BasicMatrix<double>&);
+template void saveMatrix<float>(const std::string&, const BasicMatrix<float>&);
+template void saveMatrix<bfloat16>(const std::string&, const BasicMatrix<bfloat16>&);
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string& path) : base(nullptr), length(0), file_path(path) {
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        throw MatrixFileError("Cannot open matrix file: " + path);
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        throw MatrixFileError("Cannot stat matrix file: " + path);
+    }
+    length = static_cast<size_t>(size.QuadPart);
+    if (length > 0) {
+        HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            base = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+        if (!base) {
+            CloseHandle(handle);
+            throw MatrixFileError("Cannot map matrix file: " + path);
+        }
+    }
+    CloseHandle(handle);
+}
+
+MappedFile::~MappedFile() {
+    if (base) {
+        UnmapViewOfFile(base);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) : base(nullptr), length(0), file_path(path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw MatrixFileError("Cannot open matrix file: " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw MatrixFileError("Cannot stat matrix file: " + path);
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length > 0) {
+        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw MatrixFileError("Cannot map matrix file: " + path);
+        }
+        base = static_cast<const std::byte*>(mapped);
+    }
+    // The mapping keeps the file referenced; the descriptor is not needed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (base) {
+        ::munmap(const_cast<std::byte*>(base), length);
+    }
+}
+
+#endif
+
+MappedMatrix::MappedMatrix(const std::string& path)
+    : MappedMatrix(std::make_shared<const MappedFile>(path), 0) {}
+
+MappedMatrix::MappedMatrix(std::shared_ptr<const MappedFile> mapped, uint64_t offset)
+    : file(std::move(mapped)), hdr(nullptr), elements(nullptr) {
+    const std::string& path = file->path();
+    if (offset % kRecordAlignment != 0 || offset + sizeof(MatrixFileHeader) > file->size()) {
+        throw MatrixFileError("Matrix record offset out of range in " + path);
+    }
+    hdr = reinterpret_cast<const MatrixFileHeader*>(file->data() + offset);
+
+    if (std::memcmp(hdr->magic, kMatrixFileMagic, sizeof(hdr->magic)) != 0) {
+        throw MatrixFileError("Not a matrix file (bad magic): " + path);
+    }
+    if (hdr->version != kMatrixFileVersion) {
+        throw MatrixFileError("Unsupported matrix file version " + std::to_string(hdr->version) + ": " + path);
+    }
+    size_t element_size = dtypeSize(static_cast<DType>(hdr->dtype));
+    if (element_size == 0) {
+        throw MatrixFileError("Unknown matrix element type " + std::to_string(hdr->dtype) + ": " + path);
+    }
+    if (hdr->data_offset % kRecordAlignment != 0
+        || hdr->data_offset > file->size() - offset
+        || hdr->data_bytes > file->size() - offset - hdr->data_offset) {
+        throw MatrixFileError("Matrix file is truncated: " + path);
+    }
+
+    // The furthest element addressed through the strides must lie inside
+    // the recorded buffer. The header is untrusted (checksums are optional),
+    // so every product is bounded by division first rather than allowed to
+    // wrap around back into range.
+    if (hdr->rows > 0 && hdr->cols > 0) {
+        uint64_t capacity = hdr->data_bytes / element_size;
+        // steps * stride < capacity, i.e. steps < ceil(capacity / stride)
+        auto spanFits = [capacity](uint64_t steps, uint64_t stride) {
+            return stride == 0 || steps < capacity / stride + (capacity % stride != 0);
+        };
+        if (!spanFits(hdr->rows - 1, hdr->row_stride) || !spanFits(hdr->cols - 1, hdr->col_stride)) {
+            throw MatrixFileError("Matrix file strides exceed its data: " + path);
+        }
+        uint64_t row_span = (hdr->rows - 1) * hdr->row_stride;
+        uint64_t col_span = (hdr->cols - 1) * hdr->col_stride;
+        if (col_span >= capacity - row_span) {
+            throw MatrixFileError("Matrix file strides exceed its data: " + path);
+        }
+    }
+    elements = file->data() + offset + hdr->data_offset;
+}
+
+} // namespace matrix
@@ -0,0 +1,154 @@
+#ifndef MATRIX_IO_H
+#define MATRIX_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include "matrix.h"
+#include "matrix_view.h"
+
+namespace matrix {
+
+// On-disk matrix format (version 1, little-endian).
+//
+// A matrix record is a 64-byte MatrixFileHeader followed, at data_offset
+// bytes from the start of the header, by the raw element buffer laid out
+// with the recorded strides. Records start on a 64-byte boundary and
+// data_offset is a multiple of 64, so a memory-mapped file can be used as
+// a view in place: loading costs O(1) regardless of matrix size, and pages
+// are faulted in on first touch. A file written by saveMatrix() holds a
+// single record at offset 0; larger containers may hold several.
+
+constexpr char kMatrixFileMagic[8] = {'D', 'I', 'O', 'N', 'E', 'M', 'A', 'T'};
+constexpr uint32_t kMatrixFileVersion = 1;
+
+// Element type tag stored in the header
+enum class DType : uint32_t {
+    Float64 = 1,
+    Float32 = 2,
+    BFloat16 = 3
+};
+
+template <typename T>
+struct DTypeOf;
+
+template <>
+struct DTypeOf<double> {
+    static constexpr DType value = DType::Float64;
+};
+
+template <>
+struct DTypeOf<float> {
+    static constexpr DType value = DType::Float32;
+};
+
+template <>
+struct DTypeOf<bfloat16> {
+    static constexpr DType value = DType::BFloat16;
+};
+
+// Size in bytes of one element of the given type (0 if unknown)
+size_t dtypeSize(DType dtype);
+
+// Lower-case name of an element type ("float64", ...)
+const char* dtypeName(DType dtype);
+
+struct MatrixFileHeader {
+    char magic[8];         // kMatrixFileMagic
+    uint32_t version;      // kMatrixFileVersion
+    uint32_t dtype;        // DType
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t row_stride;   // elements between the starts of consecutive rows
+    uint64_t col_stride;   // elements between consecutive columns
+    uint64_t data_offset;  // bytes from the header to element (0, 0)
+    uint64_t data_bytes;   // size of the element buffer
+};
+
+static_assert(sizeof(MatrixFileHeader) == 64, "MatrixFileHeader must be one cache line");
+
+// Error raised for unreadable, truncated or malformed matrix files
+class MatrixFileError : public std::runtime_error {
+public:
+    explicit MatrixFileError(const std::string& message)
+        : std::runtime_error(message) {}
+};
+
+// 64-bit XXH64 hash of a byte range, used to checksum files. Reads 32
+// bytes per round, so verifying a mapped file runs at memory speed.
+uint64_t checksum64(const void* data, size_t size, uint64_t seed = 0);
+
+// Append one matrix record to out, first padding the stream to a 64-byte
+// boundary. Returns the offset of the record's header in the stream.
+template <typename T>
+uint64_t writeMatrix(std::ostream& out, const BasicMatrix<T>& m);
+
+// Write a single-record matrix file
+template <typename T>
+void saveMatrix(const std::string& path, const BasicMatrix<T>& m);
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    // Non-copyable
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const std::byte* data() const { return base; }
+    size_t size() const { return length; }
+    const std::string& path() const { return file_path; }
+
+private:
+    const std::byte* base;
+    size_t length;
+    std::string file_path;
+};
+
+// A matrix record inside a memory-mapped file, exposed as a read-only view
+// without copying. The mapping stays alive as long as any MappedMatrix
+// referring to it does; views must not outlive their MappedMatrix.
+class MappedMatrix {
+public:
+    // Map a single-record file written by saveMatrix()
+    explicit MappedMatrix(const std::string& path);
+
+    // The record whose header starts at offset in an already mapped file
+    MappedMatrix(std::shared_ptr<const MappedFile> file, uint64_t offset);
+
+    const MatrixFileHeader& header() const { return *hdr; }
+    DType getDType() const { return static_cast<DType>(hdr->dtype); }
+    size_t getRows() const { return hdr->rows; }
+    size_t getCols() const { return hdr->cols; }
+
+    // Zero-copy view of the elements; throws if T does not match the file
+    template <typename T>
+    BasicMatrixView<const T> view() const {
+        if (getDType() != DTypeOf<T>::value) {
+            throw MatrixFileError(std::string("Matrix file holds ") + dtypeName(getDType())
+                                  + ", requested " + dtypeName(DTypeOf<T>::value));
+        }
+        return BasicMatrixView<const T>(reinterpret_cast<const T*>(elements), hdr->rows, hdr->cols,
+                                        hdr->row_stride, hdr->col_stride);
+    }
+
+    // Copy into an owned matrix (for when the data must be modified)
+    template <typename T>
+    BasicMatrix<T> toMatrix() const {
+        return view<T>().toMatrix();
+    }
+
+private:
+    std::shared_ptr<const MappedFile> file;
+    const MatrixFileHeader* hdr;
+    const std::byte* elements;
+};
+
+} // namespace matrix
+
+#endif // MATRIX_IO_H
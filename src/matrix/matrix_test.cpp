@@ -1,8 +1,83 @@
 #include "matrix.h"
+#include "thread_pool.h"
+#include "simd.h"
+#include "expression.h"
+#include "matrix_view.h"
+#include "matrix_io.h"
+#include "memory_resource.h"
+#include "quantized_matrix.h"
+#include "packed_matrix.h"
+#include <cstddef>
 #include <iostream>
 #include <vector>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+// Number of failed checks; main returns non-zero if any check fails
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    std::cout << (condition ? "[PASS] " : "[FAIL] ") << what << "\n";
+    if (!condition) {
+        ++failures;
+    }
+}
+
+// Fill a matrix with uniform values in [-1, 1)
+static matrix::Matrix randomMatrix(size_t rows, size_t cols, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    matrix::Matrix m(rows, cols);
+    for (size_t i = 0; i < rows; ++i) {
+        for (double& value : m.row(i)) {
+            value = dist(gen);
+        }
+    }
+    return m;
+}
+
+// Textbook i-j-k product used as the accuracy reference
+static matrix::Matrix naiveMultiply(const matrix::Matrix& a, const matrix::Matrix& b) {
+    matrix::Matrix result(a.getRows(), b.getCols());
+    for (size_t i = 0; i < a.getRows(); ++i) {
+        for (size_t j = 0; j < b.getCols(); ++j) {
+            double sum = 0.0;
+            for (size_t k = 0; k < a.getCols(); ++k) {
+                sum += a.get(i, k) * b.get(k, j);
+            }
+            result.set(i, j, sum);
+        }
+    }
+    return result;
+}
+
+// Largest element-wise absolute difference between two same-shaped matrices
+static double maxAbsDiff(const matrix::Matrix& a, const matrix::Matrix& b) {
+    double diff = 0.0;
+    for (size_t i = 0; i < a.getRows(); ++i) {
+        for (size_t j = 0; j < a.getCols(); ++j) {
+            diff = std::max(diff, std::abs(a.get(i, j) - b.get(i, j)));
+        }
+    }
+    return diff;
+}
+
+int main(int argc, char** argv) {
+    // Registered with ctest as matrix_threaded_exit: threaded GEMM leaves
+    // pack buffers in the pool workers' thread_locals, which are freed while
+    // the pool is torn down during static destruction. The process must
+    // still exit cleanly.
+    if (argc > 1 && std::string(argv[1]) == "--threaded-exit") {
+        matrix::setNumThreads(4);
+        matrix::Matrix a = randomMatrix(301, 257, 1);
+        matrix::Matrix b = randomMatrix(257, 199, 2);
+        matrix::Matrix c = a.multiply(b);
+        return maxAbsDiff(c, naiveMultiply(a, b)) <= 1e-10 ? 0 : 1;
+    }
 
-int main() {
     std::cout << "Matrix Multiplication Test\n";
     std::cout << "=========================\n";
 
@@ -64,5 +139,622 @@ int main() {
     filled.print();
     std::cout << "\n";
 
-    return 0;
+    // Wide rows are padded to whole cache lines but stay contiguous
+    std::cout << "Creating a 3x70 matrix and reading it through row spans:\n";
+    matrix::Matrix wide(3, 70, 1.5);
+    double row_sum = 0.0;
+    for (double value : wide.row(2)) {
+        row_sum += value;
+    }
+    std::cout << "Stride: " << wide.getStride() << ", last row sum: " << row_sum
+              << " (expected 105)\n\n";
+
+    // Blocked GEMM vs. the naive reference on shapes that exercise every
+    // edge case of the blocking (partial register tiles and cache blocks)
+    std::cout << "Comparing blocked multiply against the naive reference:\n";
+    const size_t shapes[][3] = {{1, 1, 1}, {7, 5, 3}, {37, 300, 41}, {130, 97, 259}, {200, 2100, 9}};
+    for (const auto& shape : shapes) {
+        matrix::Matrix a = randomMatrix(shape[0], shape[1], 1);
+        matrix::Matrix b = randomMatrix(shape[1], shape[2], 2);
+        double diff = maxAbsDiff(a.multiply(b), naiveMultiply(a, b));
+        check(diff <= 1e-12 * static_cast<double>(shape[1]),
+              std::to_string(shape[0]) + "x" + std::to_string(shape[1]) + " * "
+              + std::to_string(shape[1]) + "x" + std::to_string(shape[2])
+              + " max diff " + std::to_string(diff));
+    }
+    std::cout << "\n";
+
+    // The threaded product must match the serial one exactly
+    std::cout << "Comparing threaded multiply against the serial kernel:\n";
+    {
+        matrix::Matrix a = randomMatrix(301, 257, 3);
+        matrix::Matrix b = randomMatrix(257, 199, 4);
+        matrix::setNumThreads(1);
+        matrix::Matrix serial = a.multiply(b);
+        matrix::setNumThreads(4);
+        matrix::Matrix threaded = a.multiply(b);
+        check(matrix::getNumThreads() == 4, "thread count is configurable");
+        check(maxAbsDiff(serial, threaded) == 0.0, "4 threads give the serial result bitwise");
+
+        std::vector<int> hits(1000, 0);
+        matrix::globalThreadPool().parallelFor(hits.size(), [&](size_t i) { ++hits[i]; });
+        check(std::all_of(hits.begin(), hits.end(), [](int h) { return h == 1; }),
+              "parallelFor runs every index exactly once");
+    }
+    std::cout << "\n";
+
+    // Every kernel set the CPU supports must agree with the scalar reference
+    std::cout << "Checking SIMD kernels (detected: " << matrix::simd::isaName(matrix::simd::detectIsa()) << "):\n";
+    {
+        std::vector<double> xs;
+        for (double x = -30.0; x <= 30.0; x += 0.0137) {
+            xs.push_back(x);
+        }
+        xs.push_back(1e-9);
+        xs.push_back(-1e-300);
+        std::vector<double> out(xs.size());
+
+        matrix::Matrix a = randomMatrix(150, 300, 5);
+        matrix::Matrix b = randomMatrix(300, 77, 6);
+        matrix::Matrix reference = naiveMultiply(a, b);
+
+        using matrix::simd::Isa;
+        for (Isa isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2, Isa::AVX512}) {
+            if (isa > matrix::simd::detectIsa()) {
+                continue;
+            }
+            matrix::simd::setIsa(isa);
+            std::string name = matrix::simd::isaName(isa);
+
+            // Relative error in units of DBL_EPSILON
+            auto worstUlps = [&](double (*ref)(double), double abs_slack) {
+                double worst = 0.0;
+                for (size_t i = 0; i < xs.size(); ++i) {
+                    double expected = ref(xs[i]);
+                    double err = std::abs(out[i] - expected) - abs_slack;
+                    worst = std::max(worst, err / (std::abs(expected) * 2.220446049250313e-16));
+                }
+                return worst;
+            };
+
+            matrix::simd::exp(xs.data(), out.data(), xs.size());
+            check(worstUlps([](double x) { return std::exp(x); }, 0.0) <= 4.0, name + " exp within 4 ulp");
+            matrix::simd::tanh(xs.data(), out.data(), xs.size());
+            check(worstUlps([](double x) { return std::tanh(x); }, 1e-16) <= 4.0, name + " tanh within 4 ulp");
+            matrix::simd::sigmoid(xs.data(), out.data(), xs.size());
+            check(worstUlps([](double x) { return 1.0 / (1.0 + std::exp(-x)); }, 0.0) <= 4.0,
+                  name + " sigmoid within 4 ulp");
+            matrix::simd::relu(xs.data(), out.data(), xs.size());
+            check(out.front() == 0.0 && out.back() == 0.0 && out[xs.size() - 2] == 1e-9, name + " relu");
+
+            matrix::simd::gelu(xs.data(), out.data(), xs.size());
+            double gelu_err = 0.0;
+            for (size_t i = 0; i < xs.size(); ++i) {
+                double x = xs[i];
+                double expected = 0.5 * x * (1.0 + std::tanh(0.7978845608028654 * (x + 0.044715 * x * x * x)));
+                gelu_err = std::max(gelu_err, std::abs(out[i] - expected) / (1.0 + std::abs(x)));
+            }
+            check(gelu_err <= 1e-14, name + " gelu matches the tanh form");
+            matrix::simd::leakyRelu(xs.data(), out.data(), xs.size(), 0.1);
+            check(out.front() == -3.0 && out[xs.size() - 2] == 1e-9 && out.back() == -1e-301, name + " leaky relu");
+
+            // Softmax rows of odd lengths (vector tails) and huge offsets
+            double softmax_err = 0.0;
+            for (size_t n : {size_t(1), size_t(3), size_t(17), xs.size()}) {
+                for (double offset : {0.0, 1000.0, -1000.0}) {
+                    std::vector<double> row(n);
+                    for (size_t i = 0; i < n; ++i) {
+                        row[i] = xs[i * 7 % xs.size()] + offset;
+                    }
+                    double max = *std::max_element(row.begin(), row.end());
+                    double sum = 0.0;
+                    for (double v : row) {
+                        sum += std::exp(v - max);
+                    }
+                    std::vector<double> soft(n), log_soft(n);
+                    matrix::simd::softmax(row.data(), soft.data(), n);
+                    matrix::simd::logSoftmax(row.data(), log_soft.data(), n);
+                    for (size_t i = 0; i < n; ++i) {
+                        double p = std::exp(row[i] - max) / sum;
+                        softmax_err = std::max(softmax_err, std::abs(soft[i] - p) / p);
+                        // Log-probabilities carry the absolute rounding error of x - max
+                        double log_err = std::abs(log_soft[i] - (row[i] - max - std::log(sum)));
+                        softmax_err = std::max(softmax_err, log_err / (1.0 + std::abs(max)));
+                    }
+                }
+            }
+            check(softmax_err <= 1e-13, name + " softmax and log-softmax are stable and accurate");
+
+            double diff = maxAbsDiff(a.multiply(b), reference);
+            check(diff <= 1e-12 * 300, name + " multiply matches the naive reference");
+        }
+        matrix::simd::setIsa(matrix::simd::detectIsa());
+    }
+    std::cout << "\n";
+
+    // Single precision and bfloat16 storage against the double product
+    std::cout << "Checking float and bfloat16 matrices:\n";
+    {
+        matrix::Matrix a = randomMatrix(120, 400, 7);
+        matrix::Matrix b = randomMatrix(400, 90, 8);
+        matrix::Matrix reference = a.multiply(b);
+
+        matrix::MatrixF product_f = matrix::MatrixF(a).multiply(matrix::MatrixF(b));
+        double diff_f = maxAbsDiff(matrix::Matrix(product_f), reference);
+        check(diff_f <= 1e-4, "float multiply within 1e-4 of double, diff " + std::to_string(diff_f));
+
+        // Inputs rounded to bfloat16 (8-bit significand) lose ~2^-9 each, but
+        // the float accumulation must not add error on top: against the
+        // double product of the already-rounded inputs, only the final
+        // rounding to bfloat16 (half an ulp, at most 2^-8 relative) remains
+        matrix::MatrixBF16 a_bf(a);
+        matrix::MatrixBF16 b_bf(b);
+        matrix::Matrix rounded = matrix::Matrix(a_bf).multiply(matrix::Matrix(b_bf));
+        matrix::Matrix product_bf(a_bf.multiply(b_bf));
+        double worst_rel = 0.0;
+        for (size_t i = 0; i < rounded.getRows(); ++i) {
+            for (size_t j = 0; j < rounded.getCols(); ++j) {
+                double ref = rounded(i, j);
+                worst_rel = std::max(worst_rel, std::abs(product_bf(i, j) - ref) / std::max(std::abs(ref), 1e-3));
+            }
+        }
+        check(worst_rel <= 1.0 / 256, "bfloat16 multiply accumulates in float, rel diff " + std::to_string(worst_rel));
+
+        std::vector<float> xs;
+        for (float x = -20.0f; x <= 20.0f; x += 0.0137f) {
+            xs.push_back(x);
+        }
+        std::vector<float> out(xs.size());
+        size_t violations = 0;
+        matrix::simd::tanh(xs.data(), out.data(), xs.size());
+        for (size_t i = 0; i < xs.size(); ++i) {
+            float expected = std::tanh(xs[i]);
+            float err = std::abs(out[i] - expected);
+            if (err > 1e-7f && err > 4.0f * 1.1920929e-7f * std::abs(expected)) {
+                ++violations;
+            }
+        }
+        check(violations == 0, "float tanh within 4 ulp or 1e-7");
+    }
+    std::cout << "\n";
+
+    // Fused expressions against step-by-step evaluation
+    std::cout << "Checking fused element-wise expressions:\n";
+    {
+        matrix::Matrix x = randomMatrix(16, 40, 9);
+        matrix::Matrix w = randomMatrix(40, 24, 10);
+        matrix::Matrix bias = randomMatrix(1, 24, 11);
+
+        matrix::Matrix fused = matrix::relu(matrix::matmul(x, w) + bias);
+        matrix::Matrix z = x.multiply(w);
+        double diff = 0.0;
+        for (size_t i = 0; i < z.getRows(); ++i) {
+            for (size_t j = 0; j < z.getCols(); ++j) {
+                double expected = std::max(0.0, z(i, j) + bias(0, j));
+                diff = std::max(diff, std::abs(fused(i, j) - expected));
+            }
+        }
+        check(fused.getRows() == 16 && fused.getCols() == 24 && diff == 0.0,
+              "relu(matmul(x, W) + b) broadcasts the bias row");
+
+        // The product is moved through the tree, not copied: one buffer for
+        // the GEMM result and one for the output
+        size_t allocations_before = matrix::heapResource()->stats().allocations;
+        matrix::Matrix fused_again = matrix::relu(matrix::matmul(x, w) + bias);
+        size_t expression_allocations = matrix::heapResource()->stats().allocations - allocations_before;
+        check(expression_allocations == 2 && fused_again(5, 7) == fused(5, 7),
+              "a product operand is not copied into the expression");
+
+        // A single-row product broadcasts like a single-row matrix
+        matrix::Matrix x1 = randomMatrix(1, 40, 14);
+        matrix::Matrix y = randomMatrix(16, 24, 15);
+        matrix::Matrix broadcast = matrix::matmul(x1, w) + y;
+        matrix::Matrix z1 = x1.multiply(w);
+        double broadcast_diff = 0.0;
+        for (size_t i = 0; i < y.getRows(); ++i) {
+            for (size_t j = 0; j < y.getCols(); ++j) {
+                broadcast_diff = std::max(broadcast_diff, std::abs(broadcast(i, j) - (z1(0, j) + y(i, j))));
+            }
+        }
+        check(broadcast.getRows() == 16 && broadcast_diff == 0.0, "a single-row product broadcasts across rows");
+
+        matrix::Matrix a = randomMatrix(5, 7, 12);
+        matrix::Matrix b = randomMatrix(5, 7, 13);
+        matrix::Matrix combo = 2.0 * a - a * b + 1.0;
+        matrix::Matrix mapped = matrix::map(a, [](double v) { return v * v; });
+        check(std::abs(combo(3, 4) - (2.0 * a(3, 4) - a(3, 4) * b(3, 4) + 1.0)) < 1e-15
+              && mapped(2, 6) == a(2, 6) * a(2, 6),
+              "scalar, element-wise and map() operators");
+
+        // Re-assigning into a same-shaped matrix evaluates in place
+        const double* buffer = a.data();
+        a = -a + b;
+        check(a.data() == buffer, "same-shape assignment reuses the buffer");
+
+        bool threw = false;
+        try {
+            matrix::Matrix bad = a + w;
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "mismatched element-wise shapes throw");
+    }
+    std::cout << "\n";
+
+    // Views: sliced and transposed operands without copies
+    std::cout << "Checking zero-copy matrix views:\n";
+    {
+        matrix::Matrix x = randomMatrix(64, 80, 14);
+        matrix::Matrix w = randomMatrix(80, 48, 15);
+        matrix::Matrix full = x.multiply(w);
+
+        // Micro-batch: rows 16..31 of x times w, written into rows 16..31 of out
+        matrix::Matrix out(64, 48);
+        matrix::multiplyInto(matrix::view(x).rowRange(16, 16), w, matrix::view(out).rowRange(16, 16));
+        check(maxAbsDiff(matrix::view(out).rowRange(16, 16).toMatrix(),
+                         matrix::view(full).rowRange(16, 16).toMatrix()) == 0.0
+              && out(15, 0) == 0.0 && out(32, 0) == 0.0,
+              "row-range multiply into a row range of the output");
+
+        // Transposed operand: (w^T)^T == w, and x^T against an explicit copy
+        matrix::Matrix wt = matrix::view(w).transposed().toMatrix();
+        matrix::Matrix via_view = matrix::multiply(matrix::view(x), matrix::view(wt).transposed());
+        check(maxAbsDiff(via_view, full) <= 1e-12, "transposed-operand multiply");
+
+        // Column block of w (sharding) against a copied block
+        matrix::ConstMatrixView shard = matrix::view(std::as_const(w)).colRange(8, 24);
+        matrix::Matrix sharded = matrix::multiply(matrix::view(x), shard);
+        check(maxAbsDiff(sharded, x.multiply(shard.toMatrix())) == 0.0 && sharded.getCols() == 24,
+              "column-block multiply");
+    }
+    std::cout << "\n";
+
+    // Binary matrix files mapped back without copying
+    std::cout << "Checking memory-mapped matrix files:\n";
+    {
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+        std::string path = (dir / "matrix_test_weights.bin").string();
+        matrix::Matrix weights = randomMatrix(33, 130, 16);
+        matrix::saveMatrix(path, weights);
+
+        {
+            matrix::MappedMatrix mapped(path);
+            matrix::ConstMatrixView mapped_view = mapped.view<double>();
+            check(mapped.getDType() == matrix::DType::Float64 && mapped_view.getRows() == 33
+                  && maxAbsDiff(mapped_view.toMatrix(), weights) == 0.0,
+                  "mapped view matches the saved matrix");
+            check(reinterpret_cast<uintptr_t>(mapped_view.data()) % 64 == 0, "mapped data is 64-byte aligned");
+
+            matrix::Matrix x = randomMatrix(4, 33, 17);
+            check(maxAbsDiff(matrix::multiply(matrix::view(x), mapped_view), x.multiply(weights)) == 0.0,
+                  "multiply reads mapped weights in place");
+
+            bool threw = false;
+            try {
+                mapped.view<float>();
+            } catch (const matrix::MatrixFileError&) {
+                threw = true;
+            }
+            check(threw, "requesting the wrong element type throws");
+        }
+
+        // Headers whose stride arithmetic wraps around 2^64 back into the
+        // buffer: (rows - 1) * row_stride, then (last + 1) * element_size
+        const uint64_t crafted[][2] = {{(uint64_t(1) << 63) + 1, 2}, {33, uint64_t(1) << 56}};
+        for (const auto& [rows, row_stride] : crafted) {
+            matrix::saveMatrix(path, weights);
+            {
+                std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+                file.seekp(offsetof(matrix::MatrixFileHeader, rows));
+                file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+                file.seekp(offsetof(matrix::MatrixFileHeader, row_stride));
+                file.write(reinterpret_cast<const char*>(&row_stride), sizeof(row_stride));
+            }
+            bool threw = false;
+            try {
+                matrix::MappedMatrix overflowing(path);
+            } catch (const matrix::MatrixFileError&) {
+                threw = true;
+            }
+            check(threw, "a header with overflowing strides is rejected (rows " + std::to_string(rows)
+                         + ", row stride " + std::to_string(row_stride) + ")");
+        }
+
+        // Published XXH64 test vectors
+        check(matrix::checksum64("", 0) == 0xEF46DB3751D8E999ULL && matrix::checksum64("a", 1) == 0xD24EC4F1A98C6E5BULL
+              && matrix::checksum64("abc", 3) == 0x44BC2CF5AD770999ULL,
+              "checksum64 matches XXH64");
+
+        std::ofstream(path, std::ios::binary) << "not a matrix file at all, but long enough to hold a header....";
+        bool threw = false;
+        try {
+            matrix::MappedMatrix corrupt(path);
+        } catch (const matrix::MatrixFileError&) {
+            threw = true;
+        }
+        check(threw, "a file with a bad header is rejected");
+        std::filesystem::remove(path);
+    }
+    std::cout << "\n";
+
+    // Pluggable memory resources
+    std::cout << "Checking memory resources:\n";
+    {
+        matrix::Matrix a = randomMatrix(40, 70, 18);
+        matrix::Matrix b = randomMatrix(70, 50, 19);
+        matrix::Matrix expected = a.multiply(b);
+
+        matrix::PoolResource pool;
+        {
+            matrix::ScopedResource scope(&pool);
+            for (int i = 0; i < 5; ++i) {
+                matrix::Matrix product = a.multiply(b);
+                check(i > 0 || product.getResource() == &pool, "matrices in a scope use its resource");
+                check(maxAbsDiff(product, expected) == 0.0, "pooled product " + std::to_string(i) + " is correct");
+            }
+        }
+        matrix::AllocatorStats pool_stats = pool.stats();
+        check(pool_stats.allocations == 5 && pool_stats.bytes_in_use == 0, "pool counts allocations and frees");
+        check(pool_stats.bytes_reserved == 16384 && pool_stats.peak_bytes == 40 * 50 * sizeof(double),
+              "pool reuses one buffer for repeated requests");
+        check(matrix::Matrix(2, 2).getResource() == matrix::heapResource(), "the heap is restored after the scope");
+
+        matrix::Matrix kept(1, 1);
+        matrix::ArenaResource& arena = matrix::threadArena();
+        {
+            matrix::ArenaScope scope;
+            matrix::Matrix t1 = a.multiply(b);
+            matrix::Matrix t2 = t1 + t1;
+            check(arena.liveAllocations() == 2 && t2.getResource() == &arena, "arena serves the temporaries");
+            kept = std::move(t2);
+            check(arena.liveAllocations() == 1, "a moved-from arena matrix releases its block");
+        }
+        auto make_in_scope = [] {
+            matrix::ArenaScope scope;
+            return matrix::Matrix(3, 3, 1.0);
+        };
+        check(kept.getResource() == matrix::heapResource() && maxAbsDiff(kept, expected + expected) == 0.0,
+              "move-assigning into an existing matrix keeps its resource");
+        {
+            matrix::Matrix escaped = make_in_scope();
+            check(escaped.getResource() == &arena && escaped.get(2, 2) == 1.0 && arena.liveAllocations() == 1,
+                  "a matrix outliving its arena scope stays valid");
+        }
+        {
+            matrix::ArenaScope scope;
+            matrix::Matrix t = a.multiply(b);
+        }
+        check(arena.liveAllocations() == 0 && arena.stats().bytes_in_use == 0, "the arena is recycled once empty");
+
+        bool threw = false;
+        {
+            matrix::ScopedResource scope(&arena);
+            matrix::Matrix held(1, 1);
+            try {
+                arena.reset();
+            } catch (const std::logic_error&) {
+                threw = true;
+            }
+        }
+        check(threw, "resetting an arena with live blocks throws");
+    }
+    std::cout << "\n";
+
+    // Bias and activation fused into the GEMM epilogue must match separate
+    // passes bitwise
+    std::cout << "Checking fused bias + activation epilogues:\n";
+    {
+        using matrix::EpilogueActivation;
+        const size_t fused_shapes[][3] = {{3, 5, 4}, {37, 300, 41}, {300, 257, 130}};
+        const std::pair<EpilogueActivation, const char*> activations[] = {
+            {EpilogueActivation::ReLU, "ReLU"}, {EpilogueActivation::Sigmoid, "Sigmoid"},
+            {EpilogueActivation::Tanh, "Tanh"}};
+        matrix::setNumThreads(4);
+        for (const auto& shape : fused_shapes) {
+            matrix::Matrix a = randomMatrix(shape[0], shape[1], 20);
+            matrix::Matrix b = randomMatrix(shape[1], shape[2], 21);
+            matrix::Matrix bias = randomMatrix(1, shape[2], 22);
+            matrix::Matrix z = a.multiply(b);
+            for (size_t i = 0; i < z.getRows(); ++i) {
+                matrix::simd::add(z.row(i).data(), bias.data(), z.row(i).data(), z.getCols());
+            }
+            for (const auto& [activation, name] : activations) {
+                matrix::Matrix expected(z.getRows(), z.getCols());
+                for (size_t i = 0; i < z.getRows(); ++i) {
+                    const double* in = z.row(i).data();
+                    double* out = expected.row(i).data();
+                    if (activation == EpilogueActivation::ReLU) {
+                        matrix::simd::relu(in, out, z.getCols());
+                    } else if (activation == EpilogueActivation::Sigmoid) {
+                        matrix::simd::sigmoid(in, out, z.getCols());
+                    } else {
+                        matrix::simd::tanh(in, out, z.getCols());
+                    }
+                }
+                matrix::Matrix out;
+                matrix::Matrix pre;
+                matrix::Matrix::multiplyInto(a, b, bias, activation, out, &pre);
+                check(maxAbsDiff(out, expected) == 0.0 && maxAbsDiff(pre, z) == 0.0,
+                      std::string(name) + " fused into " + std::to_string(shape[0]) + "x"
+                      + std::to_string(shape[1]) + " * " + std::to_string(shape[1]) + "x"
+                      + std::to_string(shape[2]));
+            }
+        }
+
+        matrix::Matrix a = randomMatrix(20, 30, 23);
+        matrix::Matrix b = randomMatrix(30, 10, 24);
+        matrix::MatrixBF16 out;
+        matrix::MatrixBF16::multiplyInto(matrix::MatrixBF16(a), matrix::MatrixBF16(b), matrix::MatrixBF16(),
+                                         EpilogueActivation::ReLU, out);
+        matrix::Matrix reference = matrix::Matrix(matrix::MatrixBF16(a)).multiply(matrix::Matrix(matrix::MatrixBF16(b)));
+        double worst = 0.0;
+        for (size_t i = 0; i < reference.getRows(); ++i) {
+            for (size_t j = 0; j < reference.getCols(); ++j) {
+                double r = std::max(reference.get(i, j), 0.0);
+                worst = std::max(worst, std::abs(static_cast<float>(out.get(i, j)) - r) - std::abs(r) * 0x1p-8);
+            }
+        }
+        check(worst <= 1e-6, "bfloat16 ReLU epilogue rounds once");
+
+        bool threw = false;
+        try {
+            matrix::Matrix::multiplyInto(a, b, matrix::Matrix(1, 3), EpilogueActivation::None, reference);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "a bias of the wrong width is rejected");
+    }
+    std::cout << "\n";
+
+    std::cout << "Checking int8 quantized multiply:\n";
+    {
+        using matrix::EpilogueActivation;
+        matrix::Matrix a = randomMatrix(200, 1000, 31);
+        matrix::Matrix w = randomMatrix(1000, 300, 32);
+        matrix::Matrix bias = randomMatrix(1, 300, 33);
+        matrix::QuantizedMatrix q = matrix::QuantizedMatrix::fromDense(w);
+        double input_scale = matrix::symmetricScale(a);
+
+        // Per-channel rounding error is at most half a step
+        matrix::Matrix dequantized = q.toDense();
+        double worst_step = 0.0;
+        for (size_t i = 0; i < w.getRows(); ++i) {
+            for (size_t j = 0; j < w.getCols(); ++j) {
+                worst_step = std::max(worst_step, std::abs(dequantized(i, j) - w(i, j)) / q.getScales()[j]);
+            }
+        }
+        check(worst_step <= 0.5 + 1e-9, "weights round to the nearest per-channel step");
+        check(q.byteSize() * 7 < w.getRows() * w.getCols() * sizeof(double), "int8 weights are ~8x smaller");
+
+        // The int32 path must equal the double product of the quantized operands
+        matrix::Matrix quantized_a(a.getRows(), a.getCols());
+        for (size_t i = 0; i < a.getRows(); ++i) {
+            for (size_t j = 0; j < a.getCols(); ++j) {
+                quantized_a(i, j) = input_scale * std::clamp(std::nearbyint(a(i, j) / input_scale), -127.0, 127.0);
+            }
+        }
+        matrix::Matrix z = naiveMultiply(quantized_a, dequantized);
+        matrix::Matrix expected(z.getRows(), z.getCols());
+        for (size_t i = 0; i < z.getRows(); ++i) {
+            for (size_t j = 0; j < z.getCols(); ++j) {
+                z(i, j) += bias(0, j);
+                expected(i, j) = std::max(z(i, j), 0.0);
+            }
+        }
+
+        using matrix::simd::Isa;
+        for (Isa isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2, Isa::AVX512}) {
+            if (isa > matrix::simd::detectIsa()) {
+                continue;
+            }
+            matrix::simd::setIsa(isa);
+            matrix::Matrix out;
+            matrix::Matrix pre;
+            matrix::QuantizedMatrix::multiplyInto(a, input_scale, q, bias, EpilogueActivation::ReLU, out, &pre);
+            check(maxAbsDiff(out, expected) <= 1e-11 && maxAbsDiff(pre, z) <= 1e-11,
+                  std::string(matrix::simd::isaName(isa)) + " int8 multiply with ReLU epilogue is exact");
+        }
+        matrix::simd::setIsa(matrix::simd::detectIsa());
+
+        // Against the double product the error is a small fraction of its scale
+        matrix::Matrix out;
+        matrix::QuantizedMatrix::multiplyInto(a, input_scale, q, matrix::Matrix(), EpilogueActivation::None, out);
+        matrix::Matrix exact = a.multiply(w);
+        double err_sq = 0.0;
+        double ref_sq = 0.0;
+        for (size_t i = 0; i < exact.getRows(); ++i) {
+            for (size_t j = 0; j < exact.getCols(); ++j) {
+                err_sq += (out(i, j) - exact(i, j)) * (out(i, j) - exact(i, j));
+                ref_sq += exact(i, j) * exact(i, j);
+            }
+        }
+        double relative = std::sqrt(err_sq / ref_sq);
+        check(relative < 0.02, "int8 multiply within 2% of double, relative error " + std::to_string(relative));
+
+        // Inputs beyond the calibrated range saturate instead of wrapping
+        matrix::Matrix big(1, 1000, 10.0);
+        matrix::QuantizedMatrix::multiplyInto(big, input_scale, q, matrix::Matrix(), EpilogueActivation::None, out);
+        double saturated = 0.0;
+        for (size_t p = 0; p < 1000; ++p) {
+            saturated += 127.0 * input_scale * dequantized(p, 0);
+        }
+        check(std::abs(out(0, 0) - saturated) <= 1e-9, "out-of-range inputs saturate");
+
+        bool threw = false;
+        try {
+            matrix::QuantizedMatrix::multiplyInto(randomMatrix(2, 3, 1), input_scale, q, matrix::Matrix(),
+                                                  EpilogueActivation::None, out);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "mismatched quantized dimensions throw");
+    }
+    std::cout << "\n";
+
+    std::cout << "Checking pre-packed multiply:\n";
+    {
+        using matrix::EpilogueActivation;
+        // k spans two KC blocks and n two NC blocks plus a partial sliver
+        matrix::Matrix a = randomMatrix(130, 300, 41);
+        matrix::Matrix w = randomMatrix(300, 2061, 42);
+        matrix::Matrix bias = randomMatrix(1, 2061, 43);
+        matrix::Matrix small_a = randomMatrix(5, 7, 44);
+        matrix::Matrix small_w = randomMatrix(7, 3, 45);
+
+        using matrix::simd::Isa;
+        for (Isa isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2, Isa::AVX512}) {
+            if (isa > matrix::simd::detectIsa()) {
+                continue;
+            }
+            matrix::simd::setIsa(isa);
+            std::string name = matrix::simd::isaName(isa);
+            matrix::PackedMatrix packed = matrix::PackedMatrix::fromDense(w);
+            check(maxAbsDiff(packed.toDense(), w) == 0.0, name + " packing round-trips");
+
+            // Same blocking and microkernel as the unpacked product, so the
+            // result matches bitwise, serial or threaded
+            matrix::Matrix expected;
+            matrix::Matrix expected_pre;
+            matrix::Matrix::multiplyInto(a, w, bias, EpilogueActivation::Tanh, expected, &expected_pre);
+            for (size_t threads : {1, 4}) {
+                matrix::setNumThreads(threads);
+                matrix::Matrix out;
+                matrix::Matrix pre;
+                matrix::PackedMatrix::multiplyInto(a, packed, bias, EpilogueActivation::Tanh, out, &pre);
+                check(maxAbsDiff(out, expected) == 0.0 && maxAbsDiff(pre, expected_pre) == 0.0,
+                      name + " packed multiply with " + std::to_string(threads) + " threads matches bitwise");
+            }
+
+            matrix::Matrix small_out;
+            matrix::PackedMatrix::multiplyInto(small_a, matrix::PackedMatrix::fromDense(small_w), matrix::Matrix(),
+                                               EpilogueActivation::None, small_out);
+            check(maxAbsDiff(small_out, naiveMultiply(small_a, small_w)) < 1e-13,
+                  name + " tiny packed multiply is correct");
+        }
+
+        // Panels packed for one instruction set still multiply under another
+        matrix::simd::setIsa(Isa::Scalar);
+        matrix::PackedMatrix scalar_packed = matrix::PackedMatrix::fromDense(w);
+        matrix::simd::setIsa(matrix::simd::detectIsa());
+        matrix::Matrix out;
+        matrix::PackedMatrix::multiplyInto(a, scalar_packed, bias, EpilogueActivation::None, out);
+        matrix::Matrix expected = naiveMultiply(a, w);
+        for (size_t i = 0; i < expected.getRows(); ++i) {
+            for (size_t j = 0; j < expected.getCols(); ++j) {
+                expected(i, j) += bias(0, j);
+            }
+        }
+        check(maxAbsDiff(out, expected) < 1e-12, "panels packed for another tile width fall back correctly");
+
+        bool threw = false;
+        try {
+            matrix::PackedMatrix::multiplyInto(small_a, scalar_packed, matrix::Matrix(), EpilogueActivation::None, out);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "mismatched packed dimensions throw");
+    }
+    std::cout << "\n";
+
+    return failures == 0 ? 0 : 1;
 }
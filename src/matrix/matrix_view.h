@@ -0,0 +1,174 @@
+#ifndef MATRIX_VIEW_H
+#define MATRIX_VIEW_H
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "matrix.h"
+#include "gemm.h"
+#include "../profiler/profiler.h"
+
+namespace matrix {
+
+// Non-owning strided window onto matrix data.
+//
+// Element (i, j) lives at data()[i * getRowStride() + j * getColStride()].
+// Row ranges, column blocks and transposes are all expressed by adjusting
+// the base pointer (offset) and the two strides, so slicing never copies.
+// A view must not outlive the matrix it refers to. T may be const-qualified
+// for read-only views.
+template <typename T>
+class BasicMatrixView {
+public:
+    using value_type = std::remove_const_t<T>;
+    using Owner = std::conditional_t<std::is_const_v<T>, const BasicMatrix<value_type>, BasicMatrix<value_type>>;
+
+    // Empty (0x0) view
+    BasicMatrixView() = default;
+
+    // View over raw strided memory
+    BasicMatrixView(T* data, size_t rows, size_t cols, size_t row_stride, size_t col_stride = 1)
+        : ptr(data), rows(rows), cols(cols), row_stride(row_stride), col_stride(col_stride) {}
+
+    // View over a whole matrix
+    BasicMatrixView(Owner& m)
+        : ptr(m.data()), rows(m.getRows()), cols(m.getCols()), row_stride(m.getStride()), col_stride(1) {}
+
+    // Read-only view from a mutable one
+    template <typename U>
+        requires(std::is_const_v<T> && std::is_same_v<const U, T>)
+    BasicMatrixView(const BasicMatrixView<U>& other)
+        : ptr(other.data()), rows(other.getRows()), cols(other.getCols()),
+          row_stride(other.getRowStride()), col_stride(other.getColStride()) {}
+
+    size_t getRows() const { return rows; }
+    size_t getCols() const { return cols; }
+    size_t getRowStride() const { return row_stride; }
+    size_t getColStride() const { return col_stride; }
+    T* data() const { return ptr; }
+
+    // True when this view walks its source column-wise (see transposed())
+    bool isTransposed() const { return col_stride != 1 && row_stride == 1; }
+
+    // Unchecked element access
+    T& operator()(size_t row, size_t col) const { return ptr[row * row_stride + col * col_stride]; }
+
+    // Access element (for reading)
+    value_type get(size_t row, size_t col) const {
+        if (row >= rows || col >= cols) {
+            throw std::out_of_range("Matrix view indices out of range");
+        }
+        return (*this)(row, col);
+    }
+
+    // Rows [first, first + count)
+    BasicMatrixView rowRange(size_t first, size_t count) const {
+        return block(first, 0, count, cols);
+    }
+
+    // Columns [first, first + count)
+    BasicMatrixView colRange(size_t first, size_t count) const {
+        return block(0, first, rows, count);
+    }
+
+    // num_rows x num_cols block whose top-left element is (row, col)
+    BasicMatrixView block(size_t row, size_t col, size_t num_rows, size_t num_cols) const {
+        if (row + num_rows > rows || col + num_cols > cols) {
+            throw std::out_of_range("Matrix view block out of range");
+        }
+        return BasicMatrixView(ptr + row * row_stride + col * col_stride, num_rows, num_cols, row_stride, col_stride);
+    }
+
+    // Transposed view (strides swapped, no data movement)
+    BasicMatrixView transposed() const {
+        return BasicMatrixView(ptr, cols, rows, col_stride, row_stride);
+    }
+
+    // Copy the viewed elements into a new, densely stored matrix
+    BasicMatrix<value_type> toMatrix() const {
+        BasicMatrix<value_type> result(rows, cols);
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                result(i, j) = (*this)(i, j);
+            }
+        }
+        return result;
+    }
+
+private:
+    T* ptr = nullptr;
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t row_stride = 0;
+    size_t col_stride = 1;
+};
+
+using MatrixView = BasicMatrixView<double>;
+using ConstMatrixView = BasicMatrixView<const double>;
+using MatrixViewF = BasicMatrixView<float>;
+using ConstMatrixViewF = BasicMatrixView<const float>;
+
+// Whole-matrix views
+template <typename T>
+BasicMatrixView<T> view(BasicMatrix<T>& m) {
+    return BasicMatrixView<T>(m);
+}
+
+template <typename T>
+BasicMatrixView<const T> view(const BasicMatrix<T>& m) {
+    return BasicMatrixView<const T>(m);
+}
+
+// Matrix multiplication of views into a caller-owned view. Operands may be
+// transposed or sliced; out must have unit column stride (for example a
+// row range of a larger matrix) and must not overlap a or b. An optional
+// epilogue (see epilogue.h) is fused into the product; its pointers address
+// the same origin as out.
+// T is deduced from a; b and out convert to matching views.
+template <typename T>
+void multiplyInto(BasicMatrixView<const T> a, std::type_identity_t<BasicMatrixView<const T>> b,
+                  std::type_identity_t<BasicMatrixView<T>> out,
+                  const std::type_identity_t<Epilogue<T>>& epilogue = {}) {
+    if (a.getCols() != b.getRows() || out.getRows() != a.getRows() || out.getCols() != b.getCols()) {
+        throw std::invalid_argument("Matrix dimensions mismatch for multiplication: "
+                                   + std::to_string(a.getRows()) + "x" + std::to_string(a.getCols())
+                                   + " and " + std::to_string(b.getRows()) + "x" + std::to_string(b.getCols())
+                                   + " into " + std::to_string(out.getRows()) + "x" + std::to_string(out.getCols()));
+    }
+    if (out.getColStride() != 1) {
+        throw std::invalid_argument("Matrix multiplication output view must have unit column stride");
+    }
+    PROFILE_SCOPE_FLOPS("Matrix::multiply", "gemm",
+                        2.0 * double(a.getRows()) * double(b.getCols()) * double(a.getCols()));
+    detail::gemm<T>(a.getRows(), b.getCols(), a.getCols(),
+                    a.data(), a.getRowStride(), a.getColStride(),
+                    b.data(), b.getRowStride(), b.getColStride(),
+                    out.data(), out.getRowStride(), epilogue);
+}
+
+// Matrix multiplication of views into a new matrix
+template <typename T>
+BasicMatrix<T> multiply(BasicMatrixView<const T> a, std::type_identity_t<BasicMatrixView<const T>> b) {
+    BasicMatrix<T> result(a.getRows(), b.getCols());
+    multiplyInto<T>(a, b, BasicMatrixView<T>(result));
+    return result;
+}
+
+// Overloads taking a mutable view as the first operand
+template <typename T>
+    requires(!std::is_const_v<T>)
+void multiplyInto(BasicMatrixView<T> a, std::type_identity_t<BasicMatrixView<const T>> b,
+                  std::type_identity_t<BasicMatrixView<T>> out,
+                  const std::type_identity_t<Epilogue<T>>& epilogue = {}) {
+    multiplyInto<T>(BasicMatrixView<const T>(a), b, out, epilogue);
+}
+
+template <typename T>
+    requires(!std::is_const_v<T>)
+BasicMatrix<T> multiply(BasicMatrixView<T> a, std::type_identity_t<BasicMatrixView<const T>> b) {
+    return multiply<T>(BasicMatrixView<const T>(a), b);
+}
+
+} // namespace matrix
+
+#endif // MATRIX_VIEW_H
@@ -0,0 +1,219 @@
+#include "memory_resource.h"
+#include "../profiler/profiler.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace matrix {
+
+void* MemoryResource::allocate(size_t bytes, size_t alignment) {
+    void* p = doAllocate(bytes, alignment);
+    size_t now = in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t seen = peak.load(std::memory_order_relaxed);
+    while (now > seen && !peak.compare_exchange_weak(seen, now, std::memory_order_relaxed)) {
+    }
+    count.fetch_add(1, std::memory_order_relaxed);
+    profiler::countAllocation(bytes);
+    return p;
+}
+
+void MemoryResource::deallocate(void* p, size_t bytes, size_t alignment) noexcept {
+    if (!p) {
+        return;
+    }
+    doDeallocate(p, bytes, alignment);
+    in_use.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+AllocatorStats MemoryResource::stats() const {
+    AllocatorStats s;
+    s.bytes_in_use = in_use.load(std::memory_order_relaxed);
+    s.peak_bytes = peak.load(std::memory_order_relaxed);
+    s.allocations = count.load(std::memory_order_relaxed);
+    s.bytes_reserved = reservedBytes();
+    return s;
+}
+
+void MemoryResource::resetPeak() {
+    peak.store(in_use.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// HeapResource
+
+void* HeapResource::doAllocate(size_t bytes, size_t alignment) {
+    void* p = ::operator new(bytes, std::align_val_t(alignment));
+    reserved.fetch_add(bytes, std::memory_order_relaxed);
+    return p;
+}
+
+void HeapResource::doDeallocate(void* p, size_t bytes, size_t alignment) noexcept {
+    ::operator delete(p, std::align_val_t(alignment));
+    reserved.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+size_t HeapResource::reservedBytes() const {
+    return reserved.load(std::memory_order_relaxed);
+}
+
+// ArenaResource
+
+ArenaResource::ArenaResource(size_t initial_bytes) : initial_size(std::max<size_t>(initial_bytes, kMatrixAlignment)) {}
+
+ArenaResource::~ArenaResource() {
+    releaseChunks();
+}
+
+void ArenaResource::addChunk(size_t min_bytes) {
+    size_t size = chunks.empty() ? initial_size : chunks.back().size * 2;
+    size = std::max(size, min_bytes);
+    auto* data = static_cast<std::byte*>(::operator new(size, std::align_val_t(kMatrixAlignment)));
+    chunks.push_back({data, size});
+    reserved += size;
+    offset = 0;
+}
+
+void ArenaResource::releaseChunks() {
+    for (const Chunk& chunk : chunks) {
+        ::operator delete(chunk.data, std::align_val_t(kMatrixAlignment));
+    }
+    chunks.clear();
+    reserved = 0;
+    offset = 0;
+}
+
+void* ArenaResource::doAllocate(size_t bytes, size_t alignment) {
+    size_t start = chunks.empty() ? 0 : (offset + alignment - 1) & ~(alignment - 1);
+    if (chunks.empty() || start + bytes > chunks.back().size) {
+        // Chunks are cache-line aligned, which covers every alignment a
+        // matrix buffer asks for
+        addChunk(bytes + (alignment > kMatrixAlignment ? alignment : 0));
+        start = (reinterpret_cast<uintptr_t>(chunks.back().data) % alignment == 0)
+                    ? 0
+                    : alignment - reinterpret_cast<uintptr_t>(chunks.back().data) % alignment;
+    }
+    high_water += start - offset + bytes;
+    offset = start + bytes;
+    ++live;
+    return chunks.back().data + start;
+}
+
+void ArenaResource::doDeallocate(void* p, size_t bytes, size_t) noexcept {
+    // Rewind when the most recent block is freed first (the common case for
+    // temporaries that die in reverse order of creation)
+    if (!chunks.empty() && static_cast<std::byte*>(p) + bytes == chunks.back().data + offset) {
+        offset -= bytes;
+    }
+    --live;
+}
+
+void ArenaResource::reset() {
+    if (live != 0) {
+        throw std::logic_error("ArenaResource::reset called with live allocations");
+    }
+    if (chunks.size() > 1) {
+        // Coalesce: the next cycle of the same size fits in one chunk
+        size_t needed = std::max(high_water, initial_size);
+        releaseChunks();
+        addChunk(needed);
+    }
+    offset = 0;
+    high_water = 0;
+}
+
+// PoolResource
+
+PoolResource::~PoolResource() {
+    release();
+}
+
+size_t PoolResource::classFor(size_t bytes, size_t alignment) {
+    if (bytes > kMaxClassBytes || alignment > kMatrixAlignment) {
+        return kNumClasses;
+    }
+    size_t rounded = std::bit_ceil(std::max(bytes, kMinClassBytes));
+    return std::countr_zero(rounded) - std::countr_zero(kMinClassBytes);
+}
+
+void* PoolResource::doAllocate(size_t bytes, size_t alignment) {
+    size_t c = classFor(bytes, alignment);
+    if (c == kNumClasses) {
+        void* p = ::operator new(bytes, std::align_val_t(std::max(alignment, kMatrixAlignment)));
+        reserved.fetch_add(bytes, std::memory_order_relaxed);
+        return p;
+    }
+    {
+        std::lock_guard<std::mutex> guard(classes[c].lock);
+        if (FreeBlock* block = classes[c].free_list) {
+            classes[c].free_list = block->next;
+            return block;
+        }
+    }
+    size_t class_bytes = kMinClassBytes << c;
+    void* p = ::operator new(class_bytes, std::align_val_t(kMatrixAlignment));
+    reserved.fetch_add(class_bytes, std::memory_order_relaxed);
+    return p;
+}
+
+void PoolResource::doDeallocate(void* p, size_t bytes, size_t alignment) noexcept {
+    size_t c = classFor(bytes, alignment);
+    if (c == kNumClasses) {
+        ::operator delete(p, std::align_val_t(std::max(alignment, kMatrixAlignment)));
+        reserved.fetch_sub(bytes, std::memory_order_relaxed);
+        return;
+    }
+    std::lock_guard<std::mutex> guard(classes[c].lock);
+    auto* block = static_cast<FreeBlock*>(p);
+    block->next = classes[c].free_list;
+    classes[c].free_list = block;
+}
+
+void PoolResource::release() {
+    for (size_t c = 0; c < kNumClasses; ++c) {
+        std::lock_guard<std::mutex> guard(classes[c].lock);
+        while (FreeBlock* block = classes[c].free_list) {
+            classes[c].free_list = block->next;
+            ::operator delete(block, std::align_val_t(kMatrixAlignment));
+            reserved.fetch_sub(kMinClassBytes << c, std::memory_order_relaxed);
+        }
+    }
+}
+
+// Current resource selection
+
+static std::atomic<MemoryResource*> default_resource{nullptr};
+static thread_local MemoryResource* thread_resource = nullptr;
+
+// Never destroyed: buffers bound to it are freed by thread_locals of the
+// global pool's workers, which are joined during static destruction, after
+// a function-local static constructed later would already be gone
+MemoryResource* heapResource() {
+    static HeapResource* heap = new HeapResource;
+    return heap;
+}
+
+ArenaResource& threadArena() {
+    thread_local ArenaResource arena;
+    return arena;
+}
+
+MemoryResource* currentResource() {
+    if (thread_resource) {
+        return thread_resource;
+    }
+    MemoryResource* r = default_resource.load(std::memory_order_acquire);
+    return r ? r : heapResource();
+}
+
+MemoryResource* setCurrentResource(MemoryResource* r) {
+    return std::exchange(thread_resource, r);
+}
+
+MemoryResource* setDefaultResource(MemoryResource* r) {
+    MemoryResource* previous = default_resource.exchange(r, std::memory_order_acq_rel);
+    return previous ? previous : heapResource();
+}
+
+} // namespace matrix
@@ -0,0 +1,223 @@
+#ifndef MEMORY_RESOURCE_H
+#define MEMORY_RESOURCE_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace matrix {
+
+// Alignment (in bytes) of every matrix buffer: one cache line, which also
+// covers the widest vector register we load from (512-bit).
+constexpr size_t kMatrixAlignment = 64;
+
+// Allocation counters kept by every memory resource
+struct AllocatorStats {
+    size_t bytes_in_use = 0;    // bytes handed out and not yet returned
+    size_t peak_bytes = 0;      // high-water mark of bytes_in_use
+    size_t allocations = 0;     // allocate() calls since construction
+    size_t bytes_reserved = 0;  // bytes currently held from the system heap
+};
+
+// Source of matrix buffers.
+//
+// Every BasicMatrix draws its storage from the resource that was current on
+// the constructing thread (see currentResource()) and returns it to the same
+// resource, so installing a resource around a block of code redirects the
+// temporaries created there without touching the code itself. Matrices that
+// already exist keep their resource, including when a temporary is
+// move-assigned into them.
+class MemoryResource {
+public:
+    virtual ~MemoryResource() = default;
+
+    void* allocate(size_t bytes, size_t alignment = kMatrixAlignment);
+    void deallocate(void* p, size_t bytes, size_t alignment = kMatrixAlignment) noexcept;
+
+    // Snapshot of the counters
+    AllocatorStats stats() const;
+
+    // Restart peak tracking from the current usage
+    void resetPeak();
+
+    // Short identifier for reports ("heap", "arena", "pool")
+    virtual const char* name() const = 0;
+
+protected:
+    virtual void* doAllocate(size_t bytes, size_t alignment) = 0;
+    virtual void doDeallocate(void* p, size_t bytes, size_t alignment) noexcept = 0;
+
+    // Bytes held from the system heap, for stats()
+    virtual size_t reservedBytes() const = 0;
+
+private:
+    std::atomic<size_t> in_use{0};
+    std::atomic<size_t> peak{0};
+    std::atomic<size_t> count{0};
+};
+
+// Plain aligned operator new/delete. The default resource.
+class HeapResource : public MemoryResource {
+public:
+    const char* name() const override { return "heap"; }
+
+protected:
+    void* doAllocate(size_t bytes, size_t alignment) override;
+    void doDeallocate(void* p, size_t bytes, size_t alignment) noexcept override;
+    size_t reservedBytes() const override;
+
+private:
+    std::atomic<size_t> reserved{0};
+};
+
+// Bump allocator for short-lived temporaries.
+//
+// Allocation is a pointer increment; deallocation only rewinds when the
+// block is the most recent one. reset() recycles everything at once and, if
+// the arena had to grow, replaces its chunks with a single chunk large enough
+// for the whole previous cycle, so a steady request loop settles on one
+// upstream allocation. Not thread-safe: use one arena per thread (see
+// threadArena()).
+class ArenaResource : public MemoryResource {
+public:
+    explicit ArenaResource(size_t initial_bytes = 1 << 16);
+    ~ArenaResource() override;
+
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    // Recycle all memory. Throws std::logic_error if blocks are still live.
+    void reset();
+
+    // Blocks allocated and not yet deallocated
+    size_t liveAllocations() const { return live; }
+
+    const char* name() const override { return "arena"; }
+
+protected:
+    void* doAllocate(size_t bytes, size_t alignment) override;
+    void doDeallocate(void* p, size_t bytes, size_t alignment) noexcept override;
+    size_t reservedBytes() const override { return reserved; }
+
+private:
+    struct Chunk {
+        std::byte* data;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t offset = 0;      // first free byte in chunks.back()
+    size_t live = 0;
+    size_t reserved = 0;
+    size_t high_water = 0;  // bytes bumped since the last reset, across chunks
+    size_t initial_size;
+
+    void addChunk(size_t min_bytes);
+    void releaseChunks();
+};
+
+// Recycles buffers by power-of-two size class.
+//
+// A freed buffer goes on its class's free list and is handed back by the
+// next request of the same class, so repeated requests of similar shapes
+// stop reaching the system heap after the first round. Thread-safe: each
+// class has its own lock. Requests above the largest class go straight to
+// the heap.
+class PoolResource : public MemoryResource {
+public:
+    PoolResource() = default;
+    ~PoolResource() override;
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    // Return every cached (free) buffer to the heap
+    void release();
+
+    const char* name() const override { return "pool"; }
+
+    // Smallest and largest size classes (bytes)
+    static constexpr size_t kMinClassBytes = 64;
+    static constexpr size_t kMaxClassBytes = size_t(1) << 26;
+
+protected:
+    void* doAllocate(size_t bytes, size_t alignment) override;
+    void doDeallocate(void* p, size_t bytes, size_t alignment) noexcept override;
+    size_t reservedBytes() const override { return reserved.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kNumClasses = 21;  // 64 B .. 64 MiB
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct SizeClass {
+        std::mutex lock;
+        FreeBlock* free_list = nullptr;
+    };
+
+    SizeClass classes[kNumClasses];
+    std::atomic<size_t> reserved{0};
+
+    // Size class for a request, or kNumClasses if it is not pooled
+    static size_t classFor(size_t bytes, size_t alignment);
+};
+
+// Process-wide heap resource. It is never destroyed, so buffers may be
+// returned to it from thread_local and static destructors.
+MemoryResource* heapResource();
+
+// This thread's arena (created on first use, destroyed at thread exit)
+ArenaResource& threadArena();
+
+// Resource used for new matrices on this thread: the one installed with
+// setCurrentResource(), or the default resource if none is installed
+MemoryResource* currentResource();
+
+// Install r on this thread (nullptr restores the default); returns the
+// previously installed resource
+MemoryResource* setCurrentResource(MemoryResource* r);
+
+// Resource used by threads that have not installed their own (initially the
+// heap); returns the previous default. r must outlive every matrix it backs.
+MemoryResource* setDefaultResource(MemoryResource* r);
+
+// Installs a resource on this thread for the lifetime of the scope
+class ScopedResource {
+public:
+    explicit ScopedResource(MemoryResource* r) : previous(setCurrentResource(r)) {}
+    ~ScopedResource() { setCurrentResource(previous); }
+
+    ScopedResource(const ScopedResource&) = delete;
+    ScopedResource& operator=(const ScopedResource&) = delete;
+
+private:
+    MemoryResource* previous;
+};
+
+// Serves one request's temporaries from this thread's arena and recycles
+// them on exit. If a matrix allocated in the scope is still alive at exit
+// (e.g. it was returned to the caller) the reset is skipped, so the matrix
+// stays valid; the memory is recycled by the next scope that ends clean.
+class ArenaScope {
+public:
+    ArenaScope() : arena(threadArena()), scope(&arena) {}
+    ~ArenaScope() {
+        if (arena.liveAllocations() == 0) {
+            arena.reset();
+        }
+    }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    ArenaResource& arena;
+    ScopedResource scope;
+};
+
+} // namespace matrix
+
+#endif // MEMORY_RESOURCE_H
@@ -0,0 +1,78 @@
+#include "packed_matrix.h"
+#include "gemm.h"
+#include "simd_kernels.h"
+#include "../profiler/profiler.h"
+#include <stdexcept>
+#include <string>
+
+namespace matrix {
+
+// Pack a dense matrix for the active instruction set
+PackedMatrix PackedMatrix::fromDense(ConstMatrixView dense) {
+    PackedMatrix result;
+    result.rows = dense.getRows();
+    result.cols = dense.getCols();
+    result.nr = simd::detail::kernelsFor<double>().nr;
+    result.panels.assign(detail::packedPanelSize(result.rows, result.cols, result.nr), 0.0);
+    if (result.rows != 0 && result.cols != 0) {
+        detail::packPanels(result.rows, result.cols, dense.data(), dense.getRowStride(), dense.getColStride(),
+                           result.nr, result.panels.data());
+    }
+    return result;
+}
+
+// Unpack to a row-major matrix
+Matrix PackedMatrix::toDense() const {
+    Matrix result(rows, cols);
+    if (rows != 0 && cols != 0) {
+        detail::unpackPanels(rows, cols, panels.data(), nr, result.data(), result.getStride());
+    }
+    return result;
+}
+
+// Fused product against the packed panels
+void PackedMatrix::multiplyInto(const Matrix& a, const PackedMatrix& b, const Matrix& bias,
+                                EpilogueActivation activation, Matrix& out, Matrix* pre_activation) {
+    if (a.getCols() != b.rows) {
+        throw std::invalid_argument("Matrix dimensions mismatch for multiplication: "
+                                   + std::to_string(a.getRows()) + "x" + std::to_string(a.getCols())
+                                   + " and " + std::to_string(b.rows) + "x" + std::to_string(b.cols));
+    }
+    bool has_bias = bias.getRows() != 0 || bias.getCols() != 0;
+    if (has_bias && (bias.getRows() != 1 || bias.getCols() != b.cols)) {
+        throw std::invalid_argument("Bias must be a 1x" + std::to_string(b.cols) + " row");
+    }
+    for (const Matrix* target : {&out, pre_activation}) {
+        if (target && (target == &a || target == &bias)) {
+            throw std::invalid_argument("Matrix multiplication output must not alias an operand");
+        }
+    }
+    if (pre_activation == &out) {
+        throw std::invalid_argument("Pre-activation output must differ from the result");
+    }
+
+    PROFILE_SCOPE_FLOPS("PackedMatrix::multiply", "gemm",
+                        2.0 * double(a.getRows()) * double(b.cols) * double(b.rows));
+    out.resize(a.getRows(), b.cols);
+    Epilogue<double> epilogue;
+    epilogue.bias = has_bias ? bias.data() : nullptr;
+    epilogue.activation = activation;
+    if (pre_activation) {
+        pre_activation->resize(a.getRows(), b.cols);
+        epilogue.pre_activation = pre_activation->data();
+        epilogue.ld_pre = pre_activation->getStride();
+    }
+
+    if (b.nr != simd::detail::kernelsFor<double>().nr) {
+        // Packed for another instruction set's tile: fall back to the
+        // unpacked product
+        Matrix dense = b.toDense();
+        detail::gemm<double>(a.getRows(), b.cols, b.rows, a.data(), a.getStride(), 1,
+                             dense.data(), dense.getStride(), 1, out.data(), out.getStride(), epilogue);
+        return;
+    }
+    detail::gemmPacked(a.getRows(), b.cols, b.rows, a.data(), a.getStride(), 1, b.panels.data(), b.nr,
+                       out.data(), out.getStride(), epilogue);
+}
+
+} // namespace matrix
@@ -0,0 +1,53 @@
+#ifndef PACKED_MATRIX_H
+#define PACKED_MATRIX_H
+
+#include <vector>
+#include "aligned_allocator.h"
+#include "epilogue.h"
+#include "matrix.h"
+#include "matrix_view.h"
+
+namespace matrix {
+
+// Right-hand operand packed once into the panel layout the double GEMM
+// microkernel streams (see gemm.h), for weights that multiply many inputs.
+// A product against it skips packing B, which otherwise costs a full pass
+// over the weights on every call. The panels are laid out for the register
+// tile of the instruction set active when packing; if the active set later
+// changes to one with a different tile, products still work but unpack the
+// weights on every call.
+class PackedMatrix {
+private:
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t nr = 0;  // Columns per packed sliver
+    std::vector<double, AlignedAllocator<double>> panels;
+
+public:
+    // Empty (0x0) matrix
+    PackedMatrix() = default;
+
+    // Pack a dense (possibly strided, transposed or memory-mapped) matrix
+    static PackedMatrix fromDense(ConstMatrixView dense);
+
+    // Unpack to a row-major matrix
+    Matrix toDense() const;
+
+    size_t getRows() const { return rows; }
+    size_t getCols() const { return cols; }
+    size_t getSliverWidth() const { return nr; }
+
+    // Bytes of packed storage, including the zero padding of the last sliver
+    size_t byteSize() const { return panels.size() * sizeof(double); }
+
+    // Fused product out = activation(a * b + bias) as Matrix::multiplyInto(),
+    // with b pre-packed. bias is empty (0x0) or 1 x cols; pre_activation, if
+    // non-null, receives a * b + bias. Large products are split over the
+    // shared ThreadPool.
+    static void multiplyInto(const Matrix& a, const PackedMatrix& b, const Matrix& bias,
+                             EpilogueActivation activation, Matrix& out, Matrix* pre_activation = nullptr);
+};
+
+} // namespace matrix
+
+#endif // PACKED_MATRIX_H
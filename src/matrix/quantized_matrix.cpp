@@ -0,0 +1,196 @@
+#include "quantized_matrix.h"
+#include "simd.h"
+#include "simd_kernels.h"
+#include "thread_pool.h"
+#include "../profiler/profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace matrix {
+
+// Columns (and quantized input rows) are padded to this many bytes so each
+// one starts on a vector boundary
+static constexpr size_t kQuantizedPadding = 16;
+
+// Output tiles: QM rows of the input against enough weight columns to keep
+// roughly kQuantizedPanelBytes of int8 weights in L2 while the rows stream
+static constexpr size_t QM = 32;
+static constexpr size_t kQuantizedPanelBytes = 128 * 1024;
+
+// Below this many multiply-adds the product runs serially
+static constexpr size_t kParallelQuantizedFlops = 1 << 21;
+
+static constexpr double kInt8Max = 127.0;
+
+template <typename T>
+using QuantBuffer = std::vector<T, AlignedAllocator<T>>;
+
+static int8_t quantizeValue(double x, double inverse_scale) {
+    double q = std::nearbyint(x * inverse_scale);
+    return static_cast<int8_t>(std::clamp(q, -kInt8Max, kInt8Max));
+}
+
+double symmetricScale(ConstMatrixView x) {
+    double max_abs = 0.0;
+    for (size_t i = 0; i < x.getRows(); ++i) {
+        for (size_t j = 0; j < x.getCols(); ++j) {
+            max_abs = std::max(max_abs, std::abs(x(i, j)));
+        }
+    }
+    return max_abs > 0.0 ? max_abs / kInt8Max : 1.0;
+}
+
+// Quantize a dense matrix column by column
+QuantizedMatrix QuantizedMatrix::fromDense(ConstMatrixView dense) {
+    QuantizedMatrix result;
+    result.rows = dense.getRows();
+    result.cols = dense.getCols();
+    result.stride = (result.rows + kQuantizedPadding - 1) / kQuantizedPadding * kQuantizedPadding;
+    result.values.assign(result.cols * result.stride, 0);
+    result.scales.resize(result.cols);
+
+    for (size_t j = 0; j < result.cols; ++j) {
+        ConstMatrixView column = dense.colRange(j, 1);
+        double scale = symmetricScale(column);
+        result.scales[j] = scale;
+        int8_t* out = result.values.data() + j * result.stride;
+        for (size_t p = 0; p < result.rows; ++p) {
+            out[p] = quantizeValue(column(p, 0), 1.0 / scale);
+        }
+    }
+    return result;
+}
+
+// Expand back to doubles
+Matrix QuantizedMatrix::toDense() const {
+    Matrix result(rows, cols);
+    for (size_t j = 0; j < cols; ++j) {
+        const int8_t* q = column(j);
+        for (size_t p = 0; p < rows; ++p) {
+            result(p, j) = scales[j] * q[p];
+        }
+    }
+    return result;
+}
+
+// Quantized product with requantization, bias and activation fused
+void QuantizedMatrix::multiplyInto(const Matrix& a, double input_scale, const QuantizedMatrix& q,
+                                   const Matrix& bias, EpilogueActivation activation, Matrix& out,
+                                   Matrix* pre_activation) {
+    if (a.getCols() != q.rows) {
+        throw std::invalid_argument("Matrix dimensions mismatch for quantized multiplication: "
+                                   + std::to_string(a.getRows()) + "x" + std::to_string(a.getCols())
+                                   + " and " + std::to_string(q.rows) + "x" + std::to_string(q.cols));
+    }
+    if (!(input_scale > 0.0) || !std::isfinite(input_scale)) {
+        throw std::invalid_argument("Quantization input scale must be positive and finite");
+    }
+    bool has_bias = bias.getRows() != 0 || bias.getCols() != 0;
+    if (has_bias && (bias.getRows() != 1 || bias.getCols() != q.cols)) {
+        throw std::invalid_argument("Bias must be a 1x" + std::to_string(q.cols) + " row");
+    }
+    for (const Matrix* target : {&out, pre_activation}) {
+        if (target && (target == &a || target == &bias)) {
+            throw std::invalid_argument("Matrix multiplication output must not alias an operand");
+        }
+    }
+    if (pre_activation == &out) {
+        throw std::invalid_argument("Pre-activation output must differ from the result");
+    }
+
+    size_t m = a.getRows();
+    size_t n = q.cols;
+    size_t k = q.rows;
+    PROFILE_SCOPE_FLOPS("QuantizedMatrix::multiply", "gemm", 2.0 * double(m) * double(n) * double(k));
+    out.resize(m, n);
+    if (pre_activation) {
+        pre_activation->resize(m, n);
+    }
+    if (m == 0 || n == 0) {
+        return;
+    }
+
+    // Quantize the input once, padding each row like the weight columns.
+    // Buffers are reused across calls on the same thread, so they always
+    // come from the heap rather than whatever resource is current.
+    thread_local QuantBuffer<int8_t> qa{AlignedAllocator<int8_t>(heapResource())};
+    thread_local QuantBuffer<double> requant{AlignedAllocator<double>(heapResource())};
+    qa.assign(m * q.stride, 0);
+    double inverse_scale = 1.0 / input_scale;
+    for (size_t i = 0; i < m; ++i) {
+        const double* row = a.row(i).data();
+        int8_t* dst = qa.data() + i * q.stride;
+        for (size_t p = 0; p < k; ++p) {
+            dst[p] = quantizeValue(row[p], inverse_scale);
+        }
+    }
+
+    // Combined requantization factor of each output column
+    requant.resize(n);
+    for (size_t j = 0; j < n; ++j) {
+        requant[j] = input_scale * q.scales[j];
+    }
+
+    const simd::detail::GemmS8Func gemm_s8 = simd::detail::kernels().gemm_s8;
+    size_t qn = std::max<size_t>(4, kQuantizedPanelBytes / std::max<size_t>(q.stride, 1) / 4 * 4);
+    qn = std::min(qn, n);
+    size_t m_tiles = (m + QM - 1) / QM;
+    size_t n_tiles = (n + qn - 1) / qn;
+    const int8_t* a_data = qa.data();
+    const double* scale_data = requant.data();
+    const double* bias_data = has_bias ? bias.data() : nullptr;
+
+    auto tile = [&](size_t t) {
+        size_t i0 = (t % m_tiles) * QM;
+        size_t j0 = (t / m_tiles) * qn;
+        size_t mt = std::min(QM, m - i0);
+        size_t nt = std::min(qn, n - j0);
+
+        thread_local QuantBuffer<int32_t> acc{AlignedAllocator<int32_t>(heapResource())};
+        acc.resize(QM * qn);
+        gemm_s8(mt, nt, q.stride, a_data + i0 * q.stride, q.stride,
+                q.values.data() + j0 * q.stride, q.stride, acc.data(), qn);
+
+        // Requantize, add the bias and activate while the tile is in cache
+        for (size_t i = 0; i < mt; ++i) {
+            const int32_t* acc_row = acc.data() + i * qn;
+            double* row = out.row(i0 + i).data() + j0;
+            for (size_t j = 0; j < nt; ++j) {
+                double z = acc_row[j] * scale_data[j0 + j];
+                row[j] = bias_data ? z + bias_data[j0 + j] : z;
+            }
+            if (pre_activation) {
+                std::copy_n(row, nt, pre_activation->row(i0 + i).data() + j0);
+            }
+            switch (activation) {
+            case EpilogueActivation::None:
+                break;
+            case EpilogueActivation::ReLU:
+                simd::relu(row, row, nt);
+                break;
+            case EpilogueActivation::Sigmoid:
+                simd::sigmoid(row, row, nt);
+                break;
+            case EpilogueActivation::Tanh:
+                simd::tanh(row, row, nt);
+                break;
+            case EpilogueActivation::GELU:
+                simd::gelu(row, row, nt);
+                break;
+            }
+        }
+    };
+
+    size_t tiles = m_tiles * n_tiles;
+    if (tiles == 1 || m * n * k < kParallelQuantizedFlops || ThreadPool::inWorker() || getNumThreads() == 1) {
+        for (size_t t = 0; t < tiles; ++t) {
+            tile(t);
+        }
+        return;
+    }
+    globalThreadPool().parallelFor(tiles, tile);
+}
+
+} // namespace matrix
@@ -0,0 +1,75 @@
+#ifndef QUANTIZED_MATRIX_H
+#define QUANTIZED_MATRIX_H
+
+#include <cstdint>
+#include <vector>
+#include "aligned_allocator.h"
+#include "epilogue.h"
+#include "matrix.h"
+#include "matrix_view.h"
+
+namespace matrix {
+
+// Symmetric scale mapping [-max|x|, max|x|] onto the int8 range [-127, 127],
+// i.e. max|x| / 127 (1 for an all-zero input). Used to calibrate the input
+// scale of a quantized product from a representative sample batch.
+double symmetricScale(ConstMatrixView x);
+
+// Weight matrix quantized to int8 with one symmetric scale per column:
+//
+//   W(p, j) ~= scale[j] * q(p, j),   q in [-127, 127]
+//
+// so every output channel keeps its own dynamic range and the rounding error
+// of an element is at most scale[j] / 2. The int8 values are stored
+// transposed, each column contiguous and padded to getStride() bytes, which
+// is the layout the int8 GEMM kernel streams. Storage is rows * cols bytes
+// plus one double per column, an 8x reduction over double weights.
+class QuantizedMatrix {
+private:
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t stride = 0;  // Bytes between consecutive columns
+    std::vector<int8_t, AlignedAllocator<int8_t>> values;
+    std::vector<double> scales;
+
+public:
+    // Empty (0x0) matrix
+    QuantizedMatrix() = default;
+
+    // Quantize a dense (possibly strided or memory-mapped) matrix
+    static QuantizedMatrix fromDense(ConstMatrixView dense);
+
+    // Expand back to doubles, scale[j] * q(p, j)
+    Matrix toDense() const;
+
+    size_t getRows() const { return rows; }
+    size_t getCols() const { return cols; }
+    size_t getStride() const { return stride; }
+
+    // Contiguous int8 values of column j
+    const int8_t* column(size_t j) const { return values.data() + j * stride; }
+    const std::vector<double>& getScales() const { return scales; }
+
+    // Bytes of quantized storage (values and scales)
+    size_t byteSize() const { return values.size() + scales.size() * sizeof(double); }
+
+    // Quantized product with a fused epilogue:
+    //
+    //   pre = dequantize(quantize(a, input_scale) * q) + bias
+    //   out = activation(pre)
+    //
+    // a is quantized row by row with the given per-tensor scale (values
+    // beyond 127 * input_scale saturate), multiplied against the int8
+    // weights with exact int32 accumulation, and each int32 result is
+    // requantized by input_scale * scale[j] on its way to out, where the
+    // bias and activation are applied while the tile is still in cache.
+    // bias is empty (0x0) or 1 x cols; pre_activation, if non-null,
+    // receives pre. Large products are split over the shared ThreadPool.
+    static void multiplyInto(const Matrix& a, double input_scale, const QuantizedMatrix& q,
+                             const Matrix& bias, EpilogueActivation activation, Matrix& out,
+                             Matrix* pre_activation = nullptr);
+};
+
+} // namespace matrix
+
+#endif // QUANTIZED_MATRIX_H
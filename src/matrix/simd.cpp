@@ -0,0 +1,365 @@
+#include "simd.h"
+#include "simd_kernels.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+#if defined(MATRIX_HAVE_X86_KERNELS)
+#include <cpuid.h>
+#endif
+
+namespace matrix {
+namespace simd {
+namespace detail {
+
+// Reference kernels: plain loops over the C++ standard library, exact to
+// the libm implementation. Used when no vector ISA is available and as the
+// baseline the vector kernels are tested against.
+
+template <typename T>
+static void scalarGemmMicro(size_t kc, const T* a, const T* b,
+                            T* c, size_t ldc, size_t mr, size_t nr, bool accumulate) {
+    constexpr size_t MR = 4;
+    constexpr size_t NR = 8;
+    T acc[MR][NR] = {};
+    for (size_t p = 0; p < kc; ++p) {
+        for (size_t i = 0; i < MR; ++i) {
+            T a_ip = a[i];
+            for (size_t j = 0; j < NR; ++j) {
+                acc[i][j] += a_ip * b[j];
+            }
+        }
+        a += MR;
+        b += NR;
+    }
+
+    for (size_t i = 0; i < mr; ++i) {
+        T* c_row = c + i * ldc;
+        for (size_t j = 0; j < nr; ++j) {
+            c_row[j] = accumulate ? c_row[j] + acc[i][j] : acc[i][j];
+        }
+    }
+}
+
+template <typename T>
+static void scalarRelu(const T* in, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = in[i] > 0 ? in[i] : T(0);
+    }
+}
+
+template <typename T>
+static void scalarSigmoid(const T* in, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = T(1) / (T(1) + std::exp(-in[i]));
+    }
+}
+
+template <typename T>
+static void scalarTanh(const T* in, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = std::tanh(in[i]);
+    }
+}
+
+template <typename T>
+static void scalarExp(const T* in, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = std::exp(in[i]);
+    }
+}
+
+template <typename T>
+static void scalarGelu(const T* in, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        T x = in[i];
+        out[i] = T(0.5) * x * (T(1) + std::tanh(T(0.7978845608028654) * (x + T(0.044715) * x * x * x)));
+    }
+}
+
+template <typename T>
+static void scalarLeakyRelu(const T* in, T* out, size_t n, T alpha) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = in[i] > 0 ? in[i] : alpha * in[i];
+    }
+}
+
+template <typename T>
+static void scalarSoftmax(const T* in, T* out, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    T max = *std::max_element(in, in + n);
+    T sum = T(0);
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = std::exp(in[i] - max);
+        sum += out[i];
+    }
+    T scale = T(1) / sum;
+    for (size_t i = 0; i < n; ++i) {
+        out[i] *= scale;
+    }
+}
+
+template <typename T>
+static void scalarLogSoftmax(const T* in, T* out, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    T max = *std::max_element(in, in + n);
+    T sum = T(0);
+    for (size_t i = 0; i < n; ++i) {
+        sum += std::exp(in[i] - max);
+    }
+    T shift = max + std::log(sum);
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = in[i] - shift;
+    }
+}
+
+template <typename T>
+static void scalarAdd(const T* a, const T* b, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+template <typename T>
+static void scalarMul(const T* a, const T* b, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+template <typename T>
+static KernelSet<T> scalarKernelSet() {
+    return KernelSet<T>{
+        4, 8,
+        &scalarGemmMicro<T>,
+        &scalarRelu<T>, &scalarSigmoid<T>, &scalarTanh<T>, &scalarExp<T>,
+        &scalarGelu<T>, &scalarLeakyRelu<T>, &scalarSoftmax<T>, &scalarLogSoftmax<T>,
+        &scalarAdd<T>, &scalarMul<T>,
+    };
+}
+
+static void scalarGemmS8(size_t m, size_t n, size_t k,
+                         const int8_t* a, size_t lda,
+                         const int8_t* b, size_t ldb,
+                         int32_t* c, size_t ldc) {
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            int32_t sum = 0;
+            for (size_t p = 0; p < k; ++p) {
+                sum += int32_t(a[i * lda + p]) * b[j * ldb + p];
+            }
+            c[i * ldc + j] = sum;
+        }
+    }
+}
+
+const KernelTable& scalarKernels() {
+    static const KernelTable table{Isa::Scalar, scalarKernelSet<double>(), scalarKernelSet<float>(), &scalarGemmS8};
+    return table;
+}
+
+static const KernelTable& tableFor(Isa isa) {
+    switch (isa) {
+#if defined(MATRIX_HAVE_X86_KERNELS)
+    case Isa::SSE2:
+        return sse2Kernels();
+    case Isa::AVX2:
+        return avx2Kernels();
+    case Isa::AVX512:
+        return avx512Kernels();
+#endif
+    default:
+        return scalarKernels();
+    }
+}
+
+static Isa initialIsa() {
+    Isa best = detectIsa();
+    if (const char* env = std::getenv("MATRIX_SIMD")) {
+        std::string name(env);
+        for (Isa isa : {Isa::Scalar, Isa::SSE2, Isa::AVX2, Isa::AVX512}) {
+            if (name == isaName(isa) && isa <= best) {
+                return isa;
+            }
+        }
+    }
+    return best;
+}
+
+static std::atomic<const KernelTable*> active_table{nullptr};
+
+const KernelTable& kernels() {
+    const KernelTable* table = active_table.load(std::memory_order_acquire);
+    if (!table) {
+        const KernelTable* initial = &tableFor(initialIsa());
+        active_table.compare_exchange_strong(table, initial, std::memory_order_acq_rel);
+        table = active_table.load(std::memory_order_acquire);
+    }
+    return *table;
+}
+
+} // namespace detail
+
+#if defined(MATRIX_HAVE_X86_KERNELS)
+// Read extended control register 0 (which register state the OS saves)
+static unsigned long long readXcr0() {
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+}
+#endif
+
+Isa detectIsa() {
+    static const Isa detected = [] {
+#if defined(MATRIX_HAVE_X86_KERNELS)
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            return Isa::Scalar;
+        }
+        bool sse2 = edx & bit_SSE2;
+        bool fma = ecx & bit_FMA;
+        bool osxsave = ecx & bit_OSXSAVE;
+        if (!sse2) {
+            return Isa::Scalar;
+        }
+
+        // AVX state (XMM|YMM) and AVX-512 state (opmask|ZMM_Hi256|Hi16_ZMM)
+        // must both be supported by the CPU and enabled by the OS
+        unsigned long long xcr0 = osxsave ? readXcr0() : 0;
+        bool os_avx = (xcr0 & 0x6) == 0x6;
+        bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            return Isa::SSE2;
+        }
+        bool avx2 = ebx & bit_AVX2;
+        bool avx512f = ebx & bit_AVX512F;
+        bool avx512dq = ebx & bit_AVX512DQ;
+
+        if (os_avx512 && avx512f && avx512dq && fma) {
+            return Isa::AVX512;
+        }
+        if (os_avx && avx2 && fma) {
+            return Isa::AVX2;
+        }
+        return Isa::SSE2;
+#else
+        return Isa::Scalar;
+#endif
+    }();
+    return detected;
+}
+
+Isa activeIsa() {
+    return detail::kernels().isa;
+}
+
+void setIsa(Isa isa) {
+    if (isa > detectIsa()) {
+        throw std::invalid_argument(std::string("Instruction set not supported by this CPU: ") + isaName(isa));
+    }
+    detail::active_table.store(&detail::tableFor(isa), std::memory_order_release);
+}
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::SSE2:
+        return "sse2";
+    case Isa::AVX2:
+        return "avx2";
+    case Isa::AVX512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+void relu(const double* in, double* out, size_t n) {
+    detail::kernels().f64.relu(in, out, n);
+}
+
+void sigmoid(const double* in, double* out, size_t n) {
+    detail::kernels().f64.sigmoid(in, out, n);
+}
+
+void tanh(const double* in, double* out, size_t n) {
+    detail::kernels().f64.tanh(in, out, n);
+}
+
+void exp(const double* in, double* out, size_t n) {
+    detail::kernels().f64.exp(in, out, n);
+}
+
+void gelu(const double* in, double* out, size_t n) {
+    detail::kernels().f64.gelu(in, out, n);
+}
+
+void leakyRelu(const double* in, double* out, size_t n, double alpha) {
+    detail::kernels().f64.leaky_relu(in, out, n, alpha);
+}
+
+void softmax(const double* in, double* out, size_t n) {
+    detail::kernels().f64.softmax(in, out, n);
+}
+
+void logSoftmax(const double* in, double* out, size_t n) {
+    detail::kernels().f64.log_softmax(in, out, n);
+}
+
+void add(const double* a, const double* b, double* out, size_t n) {
+    detail::kernels().f64.add(a, b, out, n);
+}
+
+void mul(const double* a, const double* b, double* out, size_t n) {
+    detail::kernels().f64.mul(a, b, out, n);
+}
+
+void relu(const float* in, float* out, size_t n) {
+    detail::kernels().f32.relu(in, out, n);
+}
+
+void sigmoid(const float* in, float* out, size_t n) {
+    detail::kernels().f32.sigmoid(in, out, n);
+}
+
+void tanh(const float* in, float* out, size_t n) {
+    detail::kernels().f32.tanh(in, out, n);
+}
+
+void exp(const float* in, float* out, size_t n) {
+    detail::kernels().f32.exp(in, out, n);
+}
+
+void gelu(const float* in, float* out, size_t n) {
+    detail::kernels().f32.gelu(in, out, n);
+}
+
+void leakyRelu(const float* in, float* out, size_t n, float alpha) {
+    detail::kernels().f32.leaky_relu(in, out, n, alpha);
+}
+
+void softmax(const float* in, float* out, size_t n) {
+    detail::kernels().f32.softmax(in, out, n);
+}
+
+void logSoftmax(const float* in, float* out, size_t n) {
+    detail::kernels().f32.log_softmax(in, out, n);
+}
+
+void add(const float* a, const float* b, float* out, size_t n) {
+    detail::kernels().f32.add(a, b, out, n);
+}
+
+void mul(const float* a, const float* b, float* out, size_t n) {
+    detail::kernels().f32.mul(a, b, out, n);
+}
+
+} // namespace simd
+} // namespace matrix
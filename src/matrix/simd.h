@@ -0,0 +1,83 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef>
+
+namespace matrix {
+namespace simd {
+
+// Instruction sets with a dedicated kernel implementation, in increasing
+// order of capability.
+enum class Isa {
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+// Best instruction set supported by this CPU and operating system (CPUID
+// feature bits plus XGETBV for OS-enabled register state)
+Isa detectIsa();
+
+// Instruction set the kernels currently dispatch to. Defaults to
+// detectIsa(), or to the MATRIX_SIMD environment variable (scalar, sse2,
+// avx2, avx512) when it names a supported level.
+Isa activeIsa();
+
+// Force dispatch to a given instruction set, e.g. to test the scalar path
+// on a machine with AVX-512. Throws std::invalid_argument if the CPU does
+// not support it.
+void setIsa(Isa isa);
+
+// Lower-case name of an instruction set ("scalar", "sse2", ...)
+const char* isaName(Isa isa);
+
+// Element-wise kernels over n contiguous elements; out may alias the input.
+//
+// The vector paths use polynomial approximations: exp and sigmoid are within
+// 4 ulp of std::exp, tanh within 4 ulp of std::tanh plus 1e-16 absolute
+// (1e-7 for float). Arguments outside the finite range of exp are clamped
+// to [-708, 709] for double and [-87, 88] for float.
+void relu(const double* in, double* out, size_t n);
+void sigmoid(const double* in, double* out, size_t n);
+void tanh(const double* in, double* out, size_t n);
+void exp(const double* in, double* out, size_t n);
+
+// GELU in its tanh form, 0.5 x (1 + tanh(sqrt(2/pi) (x + 0.044715 x^3))),
+// which stays within 1e-3 of the erf definition. LeakyReLU passes positive
+// values and scales the rest by alpha.
+void gelu(const double* in, double* out, size_t n);
+void leakyRelu(const double* in, double* out, size_t n, double alpha);
+
+void relu(const float* in, float* out, size_t n);
+void sigmoid(const float* in, float* out, size_t n);
+void tanh(const float* in, float* out, size_t n);
+void exp(const float* in, float* out, size_t n);
+void gelu(const float* in, float* out, size_t n);
+void leakyRelu(const float* in, float* out, size_t n, float alpha);
+
+// Row kernels over one row of n contiguous elements; out may alias in.
+//
+// softmax: out = exp(x - max) / sum(exp(x - max))
+// logSoftmax: out = x - max - log(sum(exp(x - max)))
+//
+// Subtracting the row maximum keeps every exponent <= 0, so neither can
+// overflow, and the largest term contributes exactly 1 to the sum. After the
+// max pass, the exponentials are computed and summed in a single pass.
+void softmax(const double* in, double* out, size_t n);
+void logSoftmax(const double* in, double* out, size_t n);
+
+void softmax(const float* in, float* out, size_t n);
+void logSoftmax(const float* in, float* out, size_t n);
+
+// out = a + b and out = a * b, element-wise
+void add(const double* a, const double* b, double* out, size_t n);
+void mul(const double* a, const double* b, double* out, size_t n);
+
+void add(const float* a, const float* b, float* out, size_t n);
+void mul(const float* a, const float* b, float* out, size_t n);
+
+} // namespace simd
+} // namespace matrix
+
+#endif // SIMD_H
@@ -0,0 +1,15 @@
+// Kernels for AVX2; this file is compiled with the matching -m flags.
+#include "simd_impl.h"
+
+namespace matrix {
+namespace simd {
+namespace detail {
+
+const KernelTable& avx2Kernels() {
+    static const KernelTable table = makeKernelTable<32, 6, 2>(Isa::AVX2);
+    return table;
+}
+
+} // namespace detail
+} // namespace simd
+} // namespace matrix
@@ -0,0 +1,15 @@
+// Kernels for AVX-512; this file is compiled with the matching -m flags.
+#include "simd_impl.h"
+
+namespace matrix {
+namespace simd {
+namespace detail {
+
+const KernelTable& avx512Kernels() {
+    static const KernelTable table = makeKernelTable<64, 8, 2>(Isa::AVX512);
+    return table;
+}
+
+} // namespace detail
+} // namespace simd
+} // namespace matrix
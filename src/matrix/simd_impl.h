@@ -0,0 +1,458 @@
+#ifndef SIMD_IMPL_H
+#define SIMD_IMPL_H
+
+// Portable vector kernels written with GCC/Clang vector extensions.
+//
+// This header is included by exactly one translation unit per instruction
+// set (simd_sse2.cpp, simd_avx2.cpp, ...), each compiled with its own -m
+// flags. Everything here has internal linkage so the differently compiled
+// copies can never be merged by the linker, and nothing from the standard
+// library is instantiated for the same reason.
+
+#include "simd_kernels.h"
+
+namespace matrix {
+namespace simd {
+namespace detail {
+namespace {
+
+template <typename T, size_t W>
+struct VecOf {
+    typedef T type __attribute__((vector_size(sizeof(T) * W)));
+};
+
+template <typename T>
+struct BitsOf;
+
+template <>
+struct BitsOf<double> {
+    using type = unsigned long long;
+};
+
+template <>
+struct BitsOf<float> {
+    using type = unsigned int;
+};
+
+template <typename T, size_t W>
+using Vec = typename VecOf<T, W>::type;
+
+template <typename T, size_t W>
+using UVec = typename VecOf<typename BitsOf<T>::type, W>::type;
+
+template <typename V, typename T>
+inline V load(const T* p) {
+    V v;
+    __builtin_memcpy(&v, p, sizeof(V));
+    return v;
+}
+
+template <typename V, typename T>
+inline void store(T* p, V v) {
+    __builtin_memcpy(p, &v, sizeof(V));
+}
+
+// Lane-wise mask ? a : b, mask lanes being all-ones or all-zeros
+template <typename V, typename M>
+inline V select(M mask, V a, V b) {
+    return (V)((mask & (M)a) | (~mask & (M)b));
+}
+
+template <typename V>
+inline V clamp(V x, V lo, V hi) {
+    x = select(x < lo, lo, x);
+    return select(x > hi, hi, x);
+}
+
+// Constants for exp range reduction and the Taylor polynomial of expm1 on
+// |r| <= ln2/2 (degree 12 keeps the truncation error below 2e-16 for
+// double, degree 7 below 5e-9 for float)
+template <typename T>
+struct ExpConstants;
+
+template <>
+struct ExpConstants<double> {
+    static constexpr double log2e = 1.4426950408889634;
+    static constexpr double ln2_hi = 6.93145751953125e-1;
+    static constexpr double ln2_lo = 1.42860682030941723212e-6;
+    static constexpr double round_magic = 6755399441055744.0;  // 1.5 * 2^52
+    static constexpr unsigned long long exponent_bias = 1023;
+    static constexpr int mantissa_bits = 52;
+    static constexpr double min_arg = -708.0;
+    static constexpr double max_arg = 709.0;
+    static constexpr double tanh_limit = 20.0;
+    static constexpr int terms = 12;
+    static constexpr double inv_fact[12] = {
+        1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040,
+        1.0 / 40320, 1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800, 1.0 / 479001600};
+};
+
+template <>
+struct ExpConstants<float> {
+    static constexpr float log2e = 1.44269504f;
+    static constexpr float ln2_hi = 0.693359375f;
+    static constexpr float ln2_lo = -2.12194440e-4f;
+    static constexpr float round_magic = 12582912.0f;  // 1.5 * 2^23
+    static constexpr unsigned int exponent_bias = 127;
+    static constexpr int mantissa_bits = 23;
+    static constexpr float min_arg = -87.0f;
+    static constexpr float max_arg = 88.0f;
+    static constexpr float tanh_limit = 9.0f;
+    static constexpr int terms = 7;
+    static constexpr float inv_fact[7] = {
+        1.0f, 1.0f / 2, 1.0f / 6, 1.0f / 24, 1.0f / 120, 1.0f / 720, 1.0f / 5040};
+};
+
+// Split exp(x) = scale * (1 + poly): scale = 2^n exactly and
+// poly = expm1(r) with r = x - n * ln2, |r| <= ln2/2.
+template <typename T, size_t W>
+inline void expParts(Vec<T, W> x, Vec<T, W>& scale, Vec<T, W>& poly) {
+    using C = ExpConstants<T>;
+    using V = Vec<T, W>;
+    using U = UVec<T, W>;
+
+    x = clamp(x, V{} + C::min_arg, V{} + C::max_arg);
+
+    // Round x / ln2 to the nearest integer; the low mantissa bits of t then
+    // hold n, which we shift straight into the exponent field of 2^n
+    V t = x * C::log2e + C::round_magic;
+    V n = t - C::round_magic;
+    V r = (x - n * C::ln2_hi) - n * C::ln2_lo;
+    scale = (V)(((U)t + C::exponent_bias) << C::mantissa_bits);
+
+    V q = V{} + C::inv_fact[C::terms - 1];
+    for (int i = C::terms - 2; i >= 0; --i) {
+        q = q * r + C::inv_fact[i];
+    }
+    poly = q * r;
+}
+
+template <typename T, size_t W>
+inline Vec<T, W> vexp(Vec<T, W> x) {
+    Vec<T, W> scale, poly;
+    expParts<T, W>(x, scale, poly);
+    return scale * poly + scale;
+}
+
+// tanh(x) = e / (e + 2) with e = expm1(2x), which keeps full relative
+// accuracy near zero
+template <typename T, size_t W>
+inline Vec<T, W> vtanh(Vec<T, W> x) {
+    using C = ExpConstants<T>;
+    using V = Vec<T, W>;
+    x = clamp(x, V{} - C::tanh_limit, V{} + C::tanh_limit);
+    V scale, poly;
+    expParts<T, W>(x + x, scale, poly);
+    V e = scale * poly + (scale - T(1));
+    return e / (e + T(2));
+}
+
+template <typename T, size_t W>
+inline Vec<T, W> vsigmoid(Vec<T, W> x) {
+    return T(1) / (T(1) + vexp<T, W>(-x));
+}
+
+template <typename T, size_t W>
+inline Vec<T, W> vrelu(Vec<T, W> x) {
+    using V = Vec<T, W>;
+    return select(x > T(0), x, V{});
+}
+
+template <typename T, size_t W>
+inline Vec<T, W> vgelu(Vec<T, W> x) {
+    // 0.5 x (1 + tanh(u)) = x * sigmoid(2u), u = sqrt(2/pi) (x + 0.044715 x^3)
+    constexpr T k = T(2 * 0.7978845608028654);
+    constexpr T k3 = T(2 * 0.7978845608028654 * 0.044715);
+    return x * vsigmoid<T, W>(x * (k + k3 * x * x));
+}
+
+template <typename T, size_t W>
+inline T horizontalSum(Vec<T, W> v) {
+    T sum = T(0);
+    for (size_t j = 0; j < W; ++j) {
+        sum += v[j];
+    }
+    return sum;
+}
+
+template <typename T, size_t W>
+inline T rowMax(const T* in, size_t n) {
+    using V = Vec<T, W>;
+    T result = in[0];
+    size_t i = 0;
+    if (n >= W) {
+        V m = load<V>(in);
+        for (i = W; i + W <= n; i += W) {
+            V x = load<V>(in + i);
+            m = select(x > m, x, m);
+        }
+        for (size_t j = 0; j < W; ++j) {
+            result = m[j] > result ? m[j] : result;
+        }
+    }
+    for (; i < n; ++i) {
+        result = in[i] > result ? in[i] : result;
+    }
+    return result;
+}
+
+// sum(exp(x - max)) over a row, storing the terms to out if non-null. The
+// tail goes through a padded temporary so it uses the vector exp too.
+template <typename T, size_t W>
+inline T expSum(const T* in, T* out, size_t n, T max) {
+    using V = Vec<T, W>;
+    V acc{};
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        V e = vexp<T, W>(load<V>(in + i) - max);
+        if (out) {
+            store(out + i, e);
+        }
+        acc += e;
+    }
+    T sum = horizontalSum<T, W>(acc);
+    if (i < n) {
+        T tmp[W];
+        for (size_t j = 0; j < W; ++j) {
+            tmp[j] = i + j < n ? in[i + j] : max;
+        }
+        store(tmp, vexp<T, W>(load<V>(tmp) - max));
+        for (size_t j = 0; i + j < n; ++j) {
+            if (out) {
+                out[i + j] = tmp[j];
+            }
+            sum += tmp[j];
+        }
+    }
+    return sum;
+}
+
+// Apply a vector functor over n elements; the tail goes through a zero
+// padded temporary so it uses the same approximation as the body
+template <typename T, size_t W, typename F>
+inline void unaryLoop(const T* in, T* out, size_t n, F f) {
+    using V = Vec<T, W>;
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        store(out + i, f(load<V>(in + i)));
+    }
+    if (i < n) {
+        T tmp[W] = {};
+        for (size_t j = 0; i + j < n; ++j) {
+            tmp[j] = in[i + j];
+        }
+        store(tmp, f(load<V>(tmp)));
+        for (size_t j = 0; i + j < n; ++j) {
+            out[i + j] = tmp[j];
+        }
+    }
+}
+
+template <typename T, size_t W, typename F>
+inline void binaryLoop(const T* a, const T* b, T* out, size_t n, F f) {
+    using V = Vec<T, W>;
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        store(out + i, f(load<V>(a + i), load<V>(b + i)));
+    }
+    for (; i < n; ++i) {
+        out[i] = f(a[i], b[i]);
+    }
+}
+
+template <typename T, size_t W>
+void reluKernel(const T* in, T* out, size_t n) {
+    unaryLoop<T, W>(in, out, n, [](Vec<T, W> x) { return vrelu<T, W>(x); });
+}
+
+template <typename T, size_t W>
+void sigmoidKernel(const T* in, T* out, size_t n) {
+    unaryLoop<T, W>(in, out, n, [](Vec<T, W> x) { return vsigmoid<T, W>(x); });
+}
+
+template <typename T, size_t W>
+void tanhKernel(const T* in, T* out, size_t n) {
+    unaryLoop<T, W>(in, out, n, [](Vec<T, W> x) { return vtanh<T, W>(x); });
+}
+
+template <typename T, size_t W>
+void expKernel(const T* in, T* out, size_t n) {
+    unaryLoop<T, W>(in, out, n, [](Vec<T, W> x) { return vexp<T, W>(x); });
+}
+
+template <typename T, size_t W>
+void geluKernel(const T* in, T* out, size_t n) {
+    unaryLoop<T, W>(in, out, n, [](Vec<T, W> x) { return vgelu<T, W>(x); });
+}
+
+template <typename T, size_t W>
+void leakyReluKernel(const T* in, T* out, size_t n, T alpha) {
+    unaryLoop<T, W>(in, out, n, [alpha](Vec<T, W> x) { return select(x > T(0), x, x * alpha); });
+}
+
+template <typename T, size_t W>
+void softmaxKernel(const T* in, T* out, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    T max = rowMax<T, W>(in, n);
+    T scale = T(1) / expSum<T, W>(in, out, n, max);
+    unaryLoop<T, W>(out, out, n, [scale](Vec<T, W> e) { return e * scale; });
+}
+
+template <typename T, size_t W>
+void logSoftmaxKernel(const T* in, T* out, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    T max = rowMax<T, W>(in, n);
+    T shift = max + __builtin_log(expSum<T, W>(in, nullptr, n, max));
+    unaryLoop<T, W>(in, out, n, [shift](Vec<T, W> x) { return x - shift; });
+}
+
+template <typename T, size_t W>
+void addKernel(const T* a, const T* b, T* out, size_t n) {
+    binaryLoop<T, W>(a, b, out, n, [](auto x, auto y) { return x + y; });
+}
+
+template <typename T, size_t W>
+void mulKernel(const T* a, const T* b, T* out, size_t n) {
+    binaryLoop<T, W>(a, b, out, n, [](auto x, auto y) { return x * y; });
+}
+
+// MR x (NV * W) register-tiled GEMM microkernel. The accumulator tile is
+// MR * NV vector registers; each k step loads NV vectors of packed B and
+// broadcasts MR scalars of packed A.
+template <typename T, size_t W, size_t MR, size_t NV>
+void gemmMicroKernel(size_t kc, const T* a, const T* b,
+                     T* c, size_t ldc, size_t mr, size_t nr, bool accumulate) {
+    using V = Vec<T, W>;
+    constexpr size_t NR = NV * W;
+
+    V acc[MR][NV];
+    for (size_t i = 0; i < MR; ++i) {
+        for (size_t j = 0; j < NV; ++j) {
+            acc[i][j] = V{};
+        }
+    }
+
+    for (size_t p = 0; p < kc; ++p) {
+        V bv[NV];
+        for (size_t j = 0; j < NV; ++j) {
+            bv[j] = load<V>(b + j * W);
+        }
+        for (size_t i = 0; i < MR; ++i) {
+            V ai = V{} + a[i];
+            for (size_t j = 0; j < NV; ++j) {
+                acc[i][j] += ai * bv[j];
+            }
+        }
+        a += MR;
+        b += NR;
+    }
+
+    if (mr == MR && nr == NR) {
+        for (size_t i = 0; i < MR; ++i) {
+            T* c_row = c + i * ldc;
+            for (size_t j = 0; j < NV; ++j) {
+                V value = accumulate ? load<V>(c_row + j * W) + acc[i][j] : acc[i][j];
+                store(c_row + j * W, value);
+            }
+        }
+        return;
+    }
+
+    // Edge tile: spill the accumulators and copy out the valid part
+    T tile[MR][NR];
+    for (size_t i = 0; i < MR; ++i) {
+        for (size_t j = 0; j < NV; ++j) {
+            store(&tile[i][j * W], acc[i][j]);
+        }
+    }
+    for (size_t i = 0; i < mr; ++i) {
+        T* c_row = c + i * ldc;
+        for (size_t j = 0; j < nr; ++j) {
+            c_row[j] = accumulate ? c_row[j] + tile[i][j] : tile[i][j];
+        }
+    }
+}
+
+// Int8 GEMM, four output columns at a time so every loaded row of A feeds
+// four dot products. Written as plain integer code, which the compiler
+// vectorizes with this file's -m flags (sign-extend to 16 bits, 16-bit
+// multiply, widen and add into int32 lanes); the 16-bit products cannot
+// overflow because both operands stay within [-127, 127].
+static void gemmS8Kernel(size_t m, size_t n, size_t k,
+                         const int8_t* a, size_t lda,
+                         const int8_t* b, size_t ldb,
+                         int32_t* c, size_t ldc) {
+    for (size_t i = 0; i < m; ++i) {
+        const int8_t* a_row = a + i * lda;
+        int32_t* c_row = c + i * ldc;
+        size_t j = 0;
+        for (; j + 4 <= n; j += 4) {
+            const int8_t* b0 = b + j * ldb;
+            const int8_t* b1 = b0 + ldb;
+            const int8_t* b2 = b1 + ldb;
+            const int8_t* b3 = b2 + ldb;
+            int32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+            for (size_t p = 0; p < k; ++p) {
+                int32_t x = a_row[p];
+                s0 += x * b0[p];
+                s1 += x * b1[p];
+                s2 += x * b2[p];
+                s3 += x * b3[p];
+            }
+            c_row[j] = s0;
+            c_row[j + 1] = s1;
+            c_row[j + 2] = s2;
+            c_row[j + 3] = s3;
+        }
+        for (; j < n; ++j) {
+            const int8_t* b_row = b + j * ldb;
+            int32_t sum = 0;
+            for (size_t p = 0; p < k; ++p) {
+                sum += int32_t(a_row[p]) * b_row[p];
+            }
+            c_row[j] = sum;
+        }
+    }
+}
+
+template <typename T, size_t W, size_t MR, size_t NV>
+KernelSet<T> makeKernelSet() {
+    return KernelSet<T>{
+        MR,
+        NV * W,
+        &gemmMicroKernel<T, W, MR, NV>,
+        &reluKernel<T, W>,
+        &sigmoidKernel<T, W>,
+        &tanhKernel<T, W>,
+        &expKernel<T, W>,
+        &geluKernel<T, W>,
+        &leakyReluKernel<T, W>,
+        &softmaxKernel<T, W>,
+        &logSoftmaxKernel<T, W>,
+        &addKernel<T, W>,
+        &mulKernel<T, W>,
+    };
+}
+
+// Build the kernel table for a vector register of BYTES bytes and an
+// MR x (NV * lanes) GEMM tile for both element types
+template <size_t BYTES, size_t MR, size_t NV>
+KernelTable makeKernelTable(Isa isa) {
+    return KernelTable{
+        isa,
+        makeKernelSet<double, BYTES / sizeof(double), MR, NV>(),
+        makeKernelSet<float, BYTES / sizeof(float), MR, NV>(),
+        &gemmS8Kernel,
+    };
+}
+
+} // namespace
+} // namespace detail
+} // namespace simd
+} // namespace matrix
+
+#endif // SIMD_IMPL_H
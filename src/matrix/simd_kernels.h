@@ -0,0 +1,90 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "simd.h"
+
+namespace matrix {
+namespace simd {
+namespace detail {
+
+// GEMM microkernel: C[mr x nr] (+)= A_sliver * B_sliver over kc steps, where
+// the slivers are packed as described in gemm.cpp and the tile is
+// KernelSet::mr x KernelSet::nr (mr/nr <= that for edge tiles).
+template <typename T>
+using GemmMicroFunc = void (*)(size_t kc, const T* a, const T* b,
+                               T* c, size_t ldc, size_t mr, size_t nr, bool accumulate);
+template <typename T>
+using UnaryFunc = void (*)(const T* in, T* out, size_t n);
+template <typename T>
+using ParamUnaryFunc = void (*)(const T* in, T* out, size_t n, T param);
+template <typename T>
+using BinaryFunc = void (*)(const T* a, const T* b, T* out, size_t n);
+
+// Int8 GEMM block: c[i * ldc + j] = sum_p a[i * lda + p] * b[j * ldb + p]
+// for i < m, j < n, p < k, summed exactly in int32. Both operands keep the
+// k dimension contiguous, i.e. B is stored transposed (one row per output
+// column). Exact as long as k * 127 * 127 fits in int32 (k < 2^17).
+using GemmS8Func = void (*)(size_t m, size_t n, size_t k,
+                            const int8_t* a, size_t lda,
+                            const int8_t* b, size_t ldb,
+                            int32_t* c, size_t ldc);
+
+// Kernels for one element type
+template <typename T>
+struct KernelSet {
+    size_t mr;
+    size_t nr;
+    GemmMicroFunc<T> gemm_micro;
+    UnaryFunc<T> relu;
+    UnaryFunc<T> sigmoid;
+    UnaryFunc<T> tanh;
+    UnaryFunc<T> exp;
+    UnaryFunc<T> gelu;
+    ParamUnaryFunc<T> leaky_relu;
+    UnaryFunc<T> softmax;      // Over one row of n elements
+    UnaryFunc<T> log_softmax;  // Over one row of n elements
+    BinaryFunc<T> add;
+    BinaryFunc<T> mul;
+};
+
+// One complete set of kernels for a single instruction set
+struct KernelTable {
+    Isa isa;
+    KernelSet<double> f64;
+    KernelSet<float> f32;
+    GemmS8Func gemm_s8;
+};
+
+// Kernel table for the active instruction set
+const KernelTable& kernels();
+
+// Kernels of the active instruction set for element type T
+template <typename T>
+const KernelSet<T>& kernelsFor();
+
+template <>
+inline const KernelSet<double>& kernelsFor<double>() {
+    return kernels().f64;
+}
+
+template <>
+inline const KernelSet<float>& kernelsFor<float>() {
+    return kernels().f32;
+}
+
+// Per-ISA tables, each defined in its own translation unit built with the
+// matching -m flags. Only called after CPU support has been verified.
+const KernelTable& scalarKernels();
+#if defined(MATRIX_HAVE_X86_KERNELS)
+const KernelTable& sse2Kernels();
+const KernelTable& avx2Kernels();
+const KernelTable& avx512Kernels();
+#endif
+
+} // namespace detail
+} // namespace simd
+} // namespace matrix
+
+#endif // SIMD_KERNELS_H
@@ -0,0 +1,15 @@
+// Kernels for SSE2; this file is compiled with the matching -m flags.
+#include "simd_impl.h"
+
+namespace matrix {
+namespace simd {
+namespace detail {
+
+const KernelTable& sse2Kernels() {
+    static const KernelTable table = makeKernelTable<16, 4, 2>(Isa::SSE2);
+    return table;
+}
+
+} // namespace detail
+} // namespace simd
+} // namespace matrix
@@ -0,0 +1,263 @@
+#include "sparse_matrix.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace matrix {
+
+// Below this many multiply-adds a product runs serially
+static constexpr size_t kParallelSparseFlops = 1 << 18;
+
+// Rows (or columns) handed to one pool task
+static constexpr size_t kRowsPerTask = 16;
+
+// Run body(begin, end) over [0, count) in chunks, on the pool when the
+// product is large enough to pay for it
+template <typename Body>
+static void forChunks(size_t count, size_t flops, Body body) {
+    if (flops < kParallelSparseFlops || count <= kRowsPerTask) {
+        body(size_t(0), count);
+        return;
+    }
+    size_t chunks = (count + kRowsPerTask - 1) / kRowsPerTask;
+    globalThreadPool().parallelFor(chunks, [&](size_t chunk) {
+        size_t begin = chunk * kRowsPerTask;
+        body(begin, std::min(count, begin + kRowsPerTask));
+    });
+}
+
+static void checkIndexRange(size_t rows, size_t cols) {
+    if (rows > std::numeric_limits<uint32_t>::max() || cols > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("Sparse matrix dimensions must be below 2^32");
+    }
+}
+
+// Default constructor
+template <typename T>
+BasicSparseMatrix<T>::BasicSparseMatrix() : layout(SparseLayout::CSR), rows(0), cols(0), offsets(1, 0) {}
+
+// Constructor from raw compressed arrays
+template <typename T>
+BasicSparseMatrix<T>::BasicSparseMatrix(size_t rows, size_t cols, SparseLayout layout,
+                                        std::vector<size_t> offsets, std::vector<uint32_t> indices,
+                                        std::vector<T> values)
+    : layout(layout), rows(rows), cols(cols),
+      offsets(std::move(offsets)), indices(std::move(indices)), values(std::move(values)) {
+    checkIndexRange(rows, cols);
+    size_t major = layout == SparseLayout::CSR ? rows : cols;
+    size_t minor = layout == SparseLayout::CSR ? cols : rows;
+    if (this->offsets.size() != major + 1 || this->offsets.front() != 0
+        || this->offsets.back() != this->values.size() || this->indices.size() != this->values.size()) {
+        throw std::invalid_argument("Sparse matrix arrays are inconsistent");
+    }
+    for (size_t i = 0; i < major; ++i) {
+        if (this->offsets[i] > this->offsets[i + 1]) {
+            throw std::invalid_argument("Sparse matrix offsets must be non-decreasing");
+        }
+    }
+    for (uint32_t index : this->indices) {
+        if (index >= minor) {
+            throw std::invalid_argument("Sparse matrix index out of range");
+        }
+    }
+}
+
+// Keep the elements of dense with |value| > threshold
+template <typename T>
+BasicSparseMatrix<T> BasicSparseMatrix<T>::fromDense(const BasicMatrix<T>& dense, T threshold, SparseLayout layout) {
+    checkIndexRange(dense.getRows(), dense.getCols());
+    BasicSparseMatrix result;
+    result.rows = dense.getRows();
+    result.cols = dense.getCols();
+    result.layout = SparseLayout::CSR;
+    result.offsets.assign(1, 0);
+    for (size_t i = 0; i < dense.getRows(); ++i) {
+        auto row = dense.row(i);
+        for (size_t j = 0; j < row.size(); ++j) {
+            if (std::abs(row[j]) > threshold) {
+                result.indices.push_back(static_cast<uint32_t>(j));
+                result.values.push_back(row[j]);
+            }
+        }
+        result.offsets.push_back(result.values.size());
+    }
+    return layout == SparseLayout::CSR ? result : result.toLayout(layout);
+}
+
+// Expand to a dense matrix
+template <typename T>
+BasicMatrix<T> BasicSparseMatrix<T>::toDense() const {
+    BasicMatrix<T> dense(rows, cols);
+    size_t major = layout == SparseLayout::CSR ? rows : cols;
+    for (size_t i = 0; i < major; ++i) {
+        for (size_t p = offsets[i]; p < offsets[i + 1]; ++p) {
+            if (layout == SparseLayout::CSR) {
+                dense(i, indices[p]) = values[p];
+            } else {
+                dense(indices[p], i) = values[p];
+            }
+        }
+    }
+    return dense;
+}
+
+// Same matrix in the other compressed layout (counting-sort transpose)
+template <typename T>
+BasicSparseMatrix<T> BasicSparseMatrix<T>::toLayout(SparseLayout target) const {
+    if (target == layout) {
+        return *this;
+    }
+    size_t major = layout == SparseLayout::CSR ? rows : cols;
+    size_t minor = layout == SparseLayout::CSR ? cols : rows;
+
+    BasicSparseMatrix result;
+    result.layout = target;
+    result.rows = rows;
+    result.cols = cols;
+    result.offsets.assign(minor + 1, 0);
+    result.indices.resize(values.size());
+    result.values.resize(values.size());
+
+    for (uint32_t index : indices) {
+        ++result.offsets[index + 1];
+    }
+    for (size_t j = 0; j < minor; ++j) {
+        result.offsets[j + 1] += result.offsets[j];
+    }
+    std::vector<size_t> next(result.offsets.begin(), result.offsets.end() - 1);
+    for (size_t i = 0; i < major; ++i) {
+        for (size_t p = offsets[i]; p < offsets[i + 1]; ++p) {
+            size_t dst = next[indices[p]]++;
+            result.indices[dst] = static_cast<uint32_t>(i);
+            result.values[dst] = values[p];
+        }
+    }
+    return result;
+}
+
+// Fraction of stored elements
+template <typename T>
+double BasicSparseMatrix<T>::density() const {
+    if (rows == 0 || cols == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(values.size()) / (static_cast<double>(rows) * static_cast<double>(cols));
+}
+
+// Sparse x dense
+template <typename T>
+BasicMatrix<T> BasicSparseMatrix<T>::multiply(const BasicMatrix<T>& b) const {
+    BasicMatrix<T> result;
+    multiplyInto(b, result);
+    return result;
+}
+
+template <typename T>
+void BasicSparseMatrix<T>::multiplyInto(const BasicMatrix<T>& b, BasicMatrix<T>& out) const {
+    if (cols != b.getRows()) {
+        throw std::invalid_argument("Matrix dimensions mismatch for sparse multiplication: "
+                                   + std::to_string(rows) + "x" + std::to_string(cols)
+                                   + " and " + std::to_string(b.getRows()) + "x" + std::to_string(b.getCols()));
+    }
+    if (&out == &b) {
+        throw std::invalid_argument("Matrix multiplication output must not alias an operand");
+    }
+    size_t n = b.getCols();
+    out.resize(rows, n);
+    size_t flops = values.size() * n;
+
+    if (layout == SparseLayout::CSR) {
+        // out.row(i) = sum over row i's non-zeros of v * b.row(col)
+        forChunks(rows, flops, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                T* out_row = out.row(i).data();
+                std::fill_n(out_row, n, T(0));
+                for (size_t p = offsets[i]; p < offsets[i + 1]; ++p) {
+                    T v = values[p];
+                    const T* b_row = b.row(indices[p]).data();
+                    for (size_t j = 0; j < n; ++j) {
+                        out_row[j] += v * b_row[j];
+                    }
+                }
+            }
+        });
+        return;
+    }
+
+    // CSC scatters into arbitrary output rows, so split over column blocks
+    for (size_t i = 0; i < rows; ++i) {
+        std::fill_n(out.row(i).data(), n, T(0));
+    }
+    forChunks(n, flops, [&](size_t begin, size_t end) {
+        for (size_t k = 0; k < cols; ++k) {
+            const T* b_row = b.row(k).data();
+            for (size_t p = offsets[k]; p < offsets[k + 1]; ++p) {
+                T v = values[p];
+                T* out_row = out.row(indices[p]).data();
+                for (size_t j = begin; j < end; ++j) {
+                    out_row[j] += v * b_row[j];
+                }
+            }
+        }
+    });
+}
+
+// Dense x sparse
+template <typename T>
+BasicMatrix<T> BasicSparseMatrix<T>::multiply(const BasicMatrix<T>& a, const BasicSparseMatrix& s) {
+    BasicMatrix<T> result;
+    multiplyInto(a, s, result);
+    return result;
+}
+
+template <typename T>
+void BasicSparseMatrix<T>::multiplyInto(const BasicMatrix<T>& a, const BasicSparseMatrix& s, BasicMatrix<T>& out) {
+    if (a.getCols() != s.rows) {
+        throw std::invalid_argument("Matrix dimensions mismatch for sparse multiplication: "
+                                   + std::to_string(a.getRows()) + "x" + std::to_string(a.getCols())
+                                   + " and " + std::to_string(s.rows) + "x" + std::to_string(s.cols));
+    }
+    if (&out == &a) {
+        throw std::invalid_argument("Matrix multiplication output must not alias an operand");
+    }
+    size_t m = a.getRows();
+    out.resize(m, s.cols);
+    size_t flops = s.values.size() * m;
+
+    forChunks(m, flops, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const T* a_row = a.row(i).data();
+            T* out_row = out.row(i).data();
+            if (s.layout == SparseLayout::CSR) {
+                // out.row(i) = sum_k a(i, k) * s.row(k), skipping zero a(i, k)
+                std::fill_n(out_row, s.cols, T(0));
+                for (size_t k = 0; k < s.rows; ++k) {
+                    T a_ik = a_row[k];
+                    if (a_ik == T(0)) {
+                        continue;
+                    }
+                    for (size_t p = s.offsets[k]; p < s.offsets[k + 1]; ++p) {
+                        out_row[s.indices[p]] += a_ik * s.values[p];
+                    }
+                }
+            } else {
+                // out(i, j) = dot(a.row(i), column j of s)
+                for (size_t j = 0; j < s.cols; ++j) {
+                    T sum = T(0);
+                    for (size_t p = s.offsets[j]; p < s.offsets[j + 1]; ++p) {
+                        sum += a_row[s.indices[p]] * s.values[p];
+                    }
+                    out_row[j] = sum;
+                }
+            }
+        }
+    });
+}
+
+template class BasicSparseMatrix<double>;
+template class BasicSparseMatrix<float>;
+
+} // namespace matrix
@@ -0,0 +1,86 @@
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+#include <cstdint>
+#include <vector>
+#include "matrix.h"
+
+namespace matrix {
+
+// Compressed storage orientation of a sparse matrix
+enum class SparseLayout {
+    CSR,  // compressed sparse rows: offsets per row, column indices
+    CSC   // compressed sparse columns: offsets per column, row indices
+};
+
+// Sparse matrix in CSR or CSC form.
+//
+// For CSR, the non-zeros of row i are values[offsets[i] .. offsets[i + 1])
+// with their column numbers in indices[]; CSC is the same with rows and
+// columns swapped. Indices are 32-bit to halve their footprint, so each
+// dimension must be below 2^32.
+//
+// Products against dense matrices cost O(nnz * n) instead of O(rows * cols
+// * n) and are split by output row (or column block) over the shared
+// ThreadPool once they are large enough.
+template <typename T>
+class BasicSparseMatrix {
+private:
+    SparseLayout layout;
+    size_t rows;
+    size_t cols;
+    std::vector<size_t> offsets;
+    std::vector<uint32_t> indices;
+    std::vector<T> values;
+
+public:
+    // Default constructor (0x0, CSR)
+    BasicSparseMatrix();
+
+    // Constructor from raw compressed arrays (validated)
+    BasicSparseMatrix(size_t rows, size_t cols, SparseLayout layout,
+                      std::vector<size_t> offsets, std::vector<uint32_t> indices, std::vector<T> values);
+
+    // Keep the elements of dense with |value| > threshold
+    static BasicSparseMatrix fromDense(const BasicMatrix<T>& dense, T threshold = T(0),
+                                       SparseLayout layout = SparseLayout::CSR);
+
+    // Expand to a dense matrix
+    BasicMatrix<T> toDense() const;
+
+    // Same matrix in the other compressed layout (copy if already in layout)
+    BasicSparseMatrix toLayout(SparseLayout target) const;
+
+    size_t getRows() const { return rows; }
+    size_t getCols() const { return cols; }
+    SparseLayout getLayout() const { return layout; }
+
+    // Number of stored elements
+    size_t getNonZeros() const { return values.size(); }
+
+    // Fraction of stored elements, nnz / (rows * cols)
+    double density() const;
+
+    // Raw compressed arrays
+    const std::vector<size_t>& getOffsets() const { return offsets; }
+    const std::vector<uint32_t>& getIndices() const { return indices; }
+    const std::vector<T>& getValues() const { return values; }
+
+    // Sparse x dense: (rows x cols) * b (cols x n)
+    BasicMatrix<T> multiply(const BasicMatrix<T>& b) const;
+    void multiplyInto(const BasicMatrix<T>& b, BasicMatrix<T>& out) const;
+
+    // Dense x sparse: a (m x rows) * s (rows x cols)
+    static BasicMatrix<T> multiply(const BasicMatrix<T>& a, const BasicSparseMatrix& s);
+    static void multiplyInto(const BasicMatrix<T>& a, const BasicSparseMatrix& s, BasicMatrix<T>& out);
+};
+
+extern template class BasicSparseMatrix<double>;
+extern template class BasicSparseMatrix<float>;
+
+using SparseMatrix = BasicSparseMatrix<double>;
+using SparseMatrixF = BasicSparseMatrix<float>;
+
+} // namespace matrix
+
+#endif // SPARSE_MATRIX_H
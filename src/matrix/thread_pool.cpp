@@ -0,0 +1,189 @@
+#include "thread_pool.h"
+#include <cstdlib>
+#include <exception>
+#include <string>
+
+namespace matrix {
+
+// Work shared by all tasks of a single parallelFor() call
+struct ThreadPool::Job {
+    TaskFunc fn;
+    std::atomic<size_t> remaining;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+static thread_local bool tls_in_worker = false;
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    size_t num_workers = num_threads > 1 ? num_threads - 1 : 0;
+    for (size_t i = 0; i < num_workers; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < num_workers; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+bool ThreadPool::inWorker() {
+    return tls_in_worker;
+}
+
+void ThreadPool::runTask(const Task& task) {
+    Job* job = task.job;
+    try {
+        job->fn.call(job->fn.object, task.index);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(job->error_mutex);
+        if (!job->error) {
+            job->error = std::current_exception();
+        }
+    }
+    job->remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool ThreadPool::popOwn(size_t id, Task& task) {
+    Queue& queue = *queues[id];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.head == queue.tasks.size()) {
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    if (queue.head == queue.tasks.size()) {
+        queue.tasks.clear();
+        queue.head = 0;
+    }
+    return true;
+}
+
+bool ThreadPool::steal(size_t start, Task& task) {
+    for (size_t i = 0; i < queues.size(); ++i) {
+        Queue& queue = *queues[(start + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.head < queue.tasks.size()) {
+            task = queue.tasks[queue.head++];
+            if (queue.head == queue.tasks.size()) {
+                queue.tasks.clear();
+                queue.head = 0;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t id) {
+    tls_in_worker = true;
+    Task task;
+    while (true) {
+        if (popOwn(id, task) || steal(id + 1, task)) {
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [this] { return stopping || pending.load() > 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::run(size_t count, TaskFunc fn) {
+    if (count == 0) {
+        return;
+    }
+    if (workers.empty() || count == 1 || tls_in_worker) {
+        for (size_t i = 0; i < count; ++i) {
+            fn.call(fn.object, i);
+        }
+        return;
+    }
+
+    Job job;
+    job.fn = fn;
+    job.remaining = count;
+
+    // Publish the task count before the tasks so that pending never
+    // underflows when a worker picks one up straight away
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        pending.fetch_add(count, std::memory_order_acq_rel);
+    }
+
+    // Deal tasks round-robin so every worker starts with local work
+    size_t first = next_queue.fetch_add(1) % queues.size();
+    for (size_t i = 0; i < count; ++i) {
+        Queue& queue = *queues[(first + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(Task{&job, i});
+    }
+    wake.notify_all();
+
+    // Help out until every task of this job has finished
+    Task task;
+    while (job.remaining.load(std::memory_order_acquire) > 0) {
+        if (steal(first, task)) {
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+            runTask(task);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    if (job.error) {
+        std::rethrow_exception(job.error);
+    }
+}
+
+static std::mutex global_pool_mutex;
+static std::unique_ptr<ThreadPool> global_pool;
+
+// Thread count from MATRIX_NUM_THREADS, falling back to the hardware count
+static size_t defaultThreadCount() {
+    if (const char* env = std::getenv("MATRIX_NUM_THREADS")) {
+        try {
+            size_t value = std::stoul(env);
+            if (value > 0) {
+                return value;
+            }
+        } catch (const std::exception&) {
+            // Ignore malformed values and use the hardware default
+        }
+    }
+    size_t hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? hardware : 1;
+}
+
+ThreadPool& globalThreadPool() {
+    std::lock_guard<std::mutex> lock(global_pool_mutex);
+    if (!global_pool) {
+        global_pool = std::make_unique<ThreadPool>(defaultThreadCount());
+    }
+    return *global_pool;
+}
+
+void setNumThreads(size_t num_threads) {
+    std::lock_guard<std::mutex> lock(global_pool_mutex);
+    global_pool.reset();
+    global_pool = std::make_unique<ThreadPool>(num_threads > 0 ? num_threads : defaultThreadCount());
+}
+
+size_t getNumThreads() {
+    return globalThreadPool().getNumThreads();
+}
+
+} // namespace matrix
@@ -0,0 +1,101 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace matrix {
+
+// Persistent work-stealing thread pool used by the parallel matrix kernels.
+//
+// Each worker owns a deque of tasks: it pops from the back of its own deque
+// and, when that runs dry, steals from the front of the others. The thread
+// calling parallelFor() takes part in the work, so a pool of N threads
+// starts N - 1 workers.
+class ThreadPool {
+public:
+    // Create a pool that runs work on num_threads threads (including the caller)
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    // Non-copyable
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads that execute work, including the calling thread
+    size_t getNumThreads() const { return workers.size() + 1; }
+
+    // Run fn(i) for every i in [0, count) and block until all calls finish.
+    // The first exception thrown by fn is rethrown here. Calls made from
+    // inside a pool task run serially on the current thread. fn is called
+    // through a non-owning reference, so dispatch never allocates once the
+    // task queues have grown to their steady-state size.
+    template <typename F>
+    void parallelFor(size_t count, F&& fn) {
+        using Fn = std::remove_reference_t<F>;
+        run(count, TaskFunc{const_cast<void*>(static_cast<const void*>(&fn)), [](void* f, size_t i) {
+            (*static_cast<Fn*>(f))(i);
+        }});
+    }
+
+    // True when the current thread is a pool worker
+    static bool inWorker();
+
+private:
+    struct Job;
+
+    // Type-erased, non-owning reference to the parallelFor body
+    struct TaskFunc {
+        void* object;
+        void (*call)(void* object, size_t index);
+    };
+
+    struct Task {
+        Job* job;
+        size_t index;
+    };
+
+    // Deque over a vector: the owner pushes and pops at the back, thieves
+    // take from head. The vector keeps its capacity when drained.
+    struct Queue {
+        std::mutex mutex;
+        std::vector<Task> tasks;
+        size_t head = 0;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> pending{0};
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> next_queue{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    void run(size_t count, TaskFunc fn);
+    void workerLoop(size_t id);
+    bool popOwn(size_t id, Task& task);
+    bool steal(size_t start, Task& task);
+    static void runTask(const Task& task);
+};
+
+// Shared pool used by Matrix::multiply and friends. It is created on first
+// use with the thread count from the MATRIX_NUM_THREADS environment variable,
+// or std::thread::hardware_concurrency() when unset.
+ThreadPool& globalThreadPool();
+
+// Replace the shared pool with one of num_threads threads (0 = hardware
+// default). Must not be called while other threads are using the pool.
+void setNumThreads(size_t num_threads);
+
+// Number of threads the shared pool runs work on
+size_t getNumThreads();
+
+} // namespace matrix
+
+#endif // THREAD_POOL_H
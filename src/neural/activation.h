@@ -2,42 +2,133 @@
 #define ACTIVATION_H
 
 #include <cmath>
+#include <concepts>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <typeinfo>
+#include <variant>
+#include <vector>
 #include "../matrix/matrix.h"
+#include "../matrix/simd.h"
+#include "../matrix/matrix_view.h"
+#include "../profiler/profiler.h"
 
 namespace neural {
 
+// How an activation maps its input
+enum class ActivationKind {
+    ElementWise,  // Each output depends only on the matching input
+    RowWise       // Each output depends on its whole row (e.g. Softmax)
+};
+
 class Activation {
 public:
     virtual ~Activation() = default;
+
+    // Element-wise unless overridden (see RowWiseActivation)
+    virtual ActivationKind kind() const { return ActivationKind::ElementWise; }
     
     // Apply activation function to a matrix
     virtual matrix::Matrix apply(const matrix::Matrix& input) const = 0;
-    
-    // Compute derivative for backpropagation (if needed later)
+
+    // Apply activation function into a caller-owned matrix (resized to match
+    // input; may be the input itself). Built-in activations override this
+    // to run without allocating; the default falls back to apply().
+    virtual void applyInto(const matrix::Matrix& input, matrix::Matrix& output) const {
+        output = apply(input);
+    }
+
+    // Apply activation function from one view into another of the same
+    // shape, e.g. a micro-batch row range or a column block of a larger
+    // matrix. The default copies through apply(); built-ins work in place.
+    virtual void applyTo(matrix::ConstMatrixView input, matrix::MatrixView output) const {
+        checkSameShape(input, output);
+        matrix::Matrix result = apply(input.toMatrix());
+        for (size_t i = 0; i < output.getRows(); ++i) {
+            for (size_t j = 0; j < output.getCols(); ++j) {
+                output(i, j) = result(i, j);
+            }
+        }
+    }
+
+    // Compute derivative with respect to the pre-activation input, used by
+    // the default backward()
     virtual matrix::Matrix derivative(const matrix::Matrix& input) const = 0;
+
+    // Gradient with respect to the pre-activation input given the gradient
+    // with respect to the output, i.e. the vector-Jacobian product of each
+    // row. Used by DenseLayer::backward(). The default multiplies by
+    // derivative() element-wise, which is exact for element-wise
+    // activations; row-wise ones override it.
+    virtual void backward(const matrix::Matrix& input, const matrix::Matrix& output_grad,
+                          matrix::Matrix& input_grad) const {
+        input_grad = derivative(input);
+        for (size_t i = 0; i < input_grad.getRows(); ++i) {
+            matrix::simd::mul(input_grad.row(i).data(), output_grad.row(i).data(), input_grad.row(i).data(),
+                              input_grad.getCols());
+        }
+    }
+
+protected:
+    static void checkSameShape(matrix::ConstMatrixView input, matrix::MatrixView output) {
+        if (input.getRows() != output.getRows() || input.getCols() != output.getCols()) {
+            throw std::invalid_argument("Activation output view shape doesn't match input");
+        }
+    }
+
+    // Run a contiguous-row kernel over every row of a view, going through a
+    // scratch row when either side has a non-unit column stride
+    template <typename Kernel>
+    static void forEachRow(matrix::ConstMatrixView input, matrix::MatrixView output, Kernel kernel) {
+        checkSameShape(input, output);
+        size_t cols = input.getCols();
+        if (input.getColStride() == 1 && output.getColStride() == 1) {
+            for (size_t i = 0; i < input.getRows(); ++i) {
+                kernel(&input(i, 0), &output(i, 0), cols);
+            }
+            return;
+        }
+        std::vector<double> scratch(cols);
+        for (size_t i = 0; i < input.getRows(); ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                scratch[j] = input(i, j);
+            }
+            kernel(scratch.data(), scratch.data(), cols);
+            for (size_t j = 0; j < cols; ++j) {
+                output(i, j) = scratch[j];
+            }
+        }
+    }
 };
 
 class ReLU : public Activation {
 public:
     matrix::Matrix apply(const matrix::Matrix& input) const override {
-        matrix::Matrix result(input.getRows(), input.getCols());
-        
+        matrix::Matrix result;
+        applyInto(input, result);
+        return result;
+    }
+
+    void applyInto(const matrix::Matrix& input, matrix::Matrix& output) const override {
+        output.resize(input.getRows(), input.getCols());
         for (size_t i = 0; i < input.getRows(); ++i) {
-            for (size_t j = 0; j < input.getCols(); ++j) {
-                double value = input.get(i, j);
-                result.set(i, j, value > 0 ? value : 0.0);
-            }
+            matrix::simd::relu(input.row(i).data(), output.row(i).data(), input.getCols());
         }
-        
-        return result;
+    }
+
+    void applyTo(matrix::ConstMatrixView input, matrix::MatrixView output) const override {
+        forEachRow(input, output, [](const double* in, double* out, size_t n) { matrix::simd::relu(in, out, n); });
     }
     
     matrix::Matrix derivative(const matrix::Matrix& input) const override {
         matrix::Matrix result(input.getRows(), input.getCols());
         
         for (size_t i = 0; i < input.getRows(); ++i) {
-            for (size_t j = 0; j < input.getCols(); ++j) {
-                result.set(i, j, input.get(i, j) > 0 ? 1.0 : 0.0);
+            auto in = input.row(i);
+            auto out = result.row(i);
+            for (size_t j = 0; j < in.size(); ++j) {
+                out[j] = in[j] > 0 ? 1.0 : 0.0;
             }
         }
         
@@ -48,26 +139,68 @@ public:
 class Sigmoid : public Activation {
 public:
     matrix::Matrix apply(const matrix::Matrix& input) const override {
+        matrix::Matrix result;
+        applyInto(input, result);
+        return result;
+    }
+
+    void applyInto(const matrix::Matrix& input, matrix::Matrix& output) const override {
+        output.resize(input.getRows(), input.getCols());
+        for (size_t i = 0; i < input.getRows(); ++i) {
+            matrix::simd::sigmoid(input.row(i).data(), output.row(i).data(), input.getCols());
+        }
+    }
+
+    void applyTo(matrix::ConstMatrixView input, matrix::MatrixView output) const override {
+        forEachRow(input, output, [](const double* in, double* out, size_t n) { matrix::simd::sigmoid(in, out, n); });
+    }
+    
+    matrix::Matrix derivative(const matrix::Matrix& input) const override {
+        matrix::Matrix sigmoid_output = apply(input);
         matrix::Matrix result(input.getRows(), input.getCols());
         
         for (size_t i = 0; i < input.getRows(); ++i) {
-            for (size_t j = 0; j < input.getCols(); ++j) {
-                double x = input.get(i, j);
-                result.set(i, j, 1.0 / (1.0 + std::exp(-x)));
+            auto in = sigmoid_output.row(i);
+            auto out = result.row(i);
+            for (size_t j = 0; j < in.size(); ++j) {
+                double s = in[j];
+                out[j] = s * (1.0 - s);
             }
         }
         
         return result;
     }
+};
+
+class Tanh : public Activation {
+public:
+    matrix::Matrix apply(const matrix::Matrix& input) const override {
+        matrix::Matrix result;
+        applyInto(input, result);
+        return result;
+    }
+
+    void applyInto(const matrix::Matrix& input, matrix::Matrix& output) const override {
+        output.resize(input.getRows(), input.getCols());
+        for (size_t i = 0; i < input.getRows(); ++i) {
+            matrix::simd::tanh(input.row(i).data(), output.row(i).data(), input.getCols());
+        }
+    }
+
+    void applyTo(matrix::ConstMatrixView input, matrix::MatrixView output) const override {
+        forEachRow(input, output, [](const double* in, double* out, size_t n) { matrix::simd::tanh(in, out, n); });
+    }
     
     matrix::Matrix derivative(const matrix::Matrix& input) const override {
-        matrix::Matrix sigmoid_output = apply(input);
+        matrix::Matrix tanh_output = apply(input);
         matrix::Matrix result(input.getRows(), input.getCols());
         
         for (size_t i = 0; i < input.getRows(); ++i) {
-            for (size_t j = 0; j < input.getCols(); ++j) {
-                double s = sigmoid_output.get(i, j);
-                result.set(i, j, s * (1.0 - s));
+            auto in = tanh_output.row(i);
+            auto out = result.row(i);
+            for (size_t j = 0; j < in.size(); ++j) {
+                double t = in[j];
+                out[j] = 1.0 - t * t;
             }
         }
         
@@ -75,34 +208,408 @@ public:
     }
 };
 
-class Tanh : public Activation {
+// GELU, tanh form: 0.5 x (1 + tanh(sqrt(2/pi) (x + 0.044715 x^3)))
+class GELU : public Activation {
 public:
     matrix::Matrix apply(const matrix::Matrix& input) const override {
+        matrix::Matrix result;
+        applyInto(input, result);
+        return result;
+    }
+
+    void applyInto(const matrix::Matrix& input, matrix::Matrix& output) const override {
+        output.resize(input.getRows(), input.getCols());
+        for (size_t i = 0; i < input.getRows(); ++i) {
+            matrix::simd::gelu(input.row(i).data(), output.row(i).data(), input.getCols());
+        }
+    }
+
+    void applyTo(matrix::ConstMatrixView input, matrix::MatrixView output) const override {
+        forEachRow(input, output, [](const double* in, double* out, size_t n) { matrix::simd::gelu(in, out, n); });
+    }
+
+    matrix::Matrix derivative(const matrix::Matrix& input) const override {
+        constexpr double c = 0.7978845608028654;  // sqrt(2 / pi)
+        constexpr double a = 0.044715;
         matrix::Matrix result(input.getRows(), input.getCols());
-        
+
         for (size_t i = 0; i < input.getRows(); ++i) {
-            for (size_t j = 0; j < input.getCols(); ++j) {
-                double x = input.get(i, j);
-                result.set(i, j, std::tanh(x));
+            auto in = input.row(i);
+            auto out = result.row(i);
+            // t = tanh(u) for the whole row, then
+            // d/dx = 0.5 (1 + t) + 0.5 x (1 - t^2) du/dx
+            for (size_t j = 0; j < in.size(); ++j) {
+                out[j] = c * (in[j] + a * in[j] * in[j] * in[j]);
+            }
+            matrix::simd::tanh(out.data(), out.data(), out.size());
+            for (size_t j = 0; j < in.size(); ++j) {
+                double x = in[j];
+                double t = out[j];
+                out[j] = 0.5 * (1.0 + t) + 0.5 * x * (1.0 - t * t) * c * (1.0 + 3.0 * a * x * x);
             }
         }
-        
+
         return result;
     }
-    
+};
+
+// max(x, alpha * x) for 0 <= alpha < 1
+class LeakyReLU : public Activation {
+private:
+    double alpha;
+
+public:
+    explicit LeakyReLU(double alpha = 0.01) : alpha(alpha) {}
+
+    double getAlpha() const { return alpha; }
+
+    matrix::Matrix apply(const matrix::Matrix& input) const override {
+        matrix::Matrix result;
+        applyInto(input, result);
+        return result;
+    }
+
+    void applyInto(const matrix::Matrix& input, matrix::Matrix& output) const override {
+        output.resize(input.getRows(), input.getCols());
+        for (size_t i = 0; i < input.getRows(); ++i) {
+            matrix::simd::leakyRelu(input.row(i).data(), output.row(i).data(), input.getCols(), alpha);
+        }
+    }
+
+    void applyTo(matrix::ConstMatrixView input, matrix::MatrixView output) const override {
+        forEachRow(input, output, [this](const double* in, double* out, size_t n) {
+            matrix::simd::leakyRelu(in, out, n, alpha);
+        });
+    }
+
     matrix::Matrix derivative(const matrix::Matrix& input) const override {
-        matrix::Matrix tanh_output = apply(input);
         matrix::Matrix result(input.getRows(), input.getCols());
-        
+
+        for (size_t i = 0; i < input.getRows(); ++i) {
+            auto in = input.row(i);
+            auto out = result.row(i);
+            for (size_t j = 0; j < in.size(); ++j) {
+                out[j] = in[j] > 0 ? 1.0 : alpha;
+            }
+        }
+
+        return result;
+    }
+};
+
+// f(x) = x, for linear layers (e.g. a low-rank factorization or the
+// output of a regression model)
+class Identity : public Activation {
+public:
+    matrix::Matrix apply(const matrix::Matrix& input) const override {
+        return input;
+    }
+
+    void applyInto(const matrix::Matrix& input, matrix::Matrix& output) const override {
+        if (&output != &input) {
+            output = input;
+        }
+    }
+
+    void applyTo(matrix::ConstMatrixView input, matrix::MatrixView output) const override {
+        checkSameShape(input, output);
         for (size_t i = 0; i < input.getRows(); ++i) {
             for (size_t j = 0; j < input.getCols(); ++j) {
-                double t = tanh_output.get(i, j);
-                result.set(i, j, 1.0 - t * t);
+                output(i, j) = input(i, j);
             }
         }
-        
+    }
+
+    matrix::Matrix derivative(const matrix::Matrix& input) const override {
+        return matrix::Matrix(input.getRows(), input.getCols(), 1.0);
+    }
+
+    void backward(const matrix::Matrix&, const matrix::Matrix& output_grad,
+                  matrix::Matrix& input_grad) const override {
+        input_grad = output_grad;
+    }
+};
+
+// Base for activations that normalize over each row. Their Jacobian is a
+// full matrix per row rather than a diagonal, so there is no element-wise
+// derivative(); gradients go through backward() instead.
+class RowWiseActivation : public Activation {
+public:
+    ActivationKind kind() const override { return ActivationKind::RowWise; }
+
+    matrix::Matrix apply(const matrix::Matrix& input) const override {
+        matrix::Matrix result;
+        applyInto(input, result);
         return result;
     }
+
+    void applyInto(const matrix::Matrix& input, matrix::Matrix& output) const override {
+        output.resize(input.getRows(), input.getCols());
+        for (size_t i = 0; i < input.getRows(); ++i) {
+            applyRow(input.row(i).data(), output.row(i).data(), input.getCols());
+        }
+    }
+
+    void applyTo(matrix::ConstMatrixView input, matrix::MatrixView output) const override {
+        forEachRow(input, output, [this](const double* in, double* out, size_t n) { applyRow(in, out, n); });
+    }
+
+    matrix::Matrix derivative(const matrix::Matrix&) const override {
+        throw std::logic_error("Row-wise activations have no element-wise derivative; use backward()");
+    }
+
+    void backward(const matrix::Matrix& input, const matrix::Matrix& output_grad,
+                  matrix::Matrix& input_grad) const override = 0;
+
+protected:
+    // Activation of one contiguous row of n values (out may alias in)
+    virtual void applyRow(const double* in, double* out, size_t n) const = 0;
+};
+
+// Row-wise softmax, exp(x_j - max) / sum_k exp(x_k - max)
+class Softmax : public RowWiseActivation {
+public:
+    // dL/dx_j = y_j (g_j - sum_k g_k y_k)
+    void backward(const matrix::Matrix& input, const matrix::Matrix& output_grad,
+                  matrix::Matrix& input_grad) const override {
+        applyInto(input, input_grad);
+        for (size_t i = 0; i < input_grad.getRows(); ++i) {
+            auto y = input_grad.row(i);
+            auto g = output_grad.row(i);
+            double dot = 0.0;
+            for (size_t j = 0; j < y.size(); ++j) {
+                dot += g[j] * y[j];
+            }
+            for (size_t j = 0; j < y.size(); ++j) {
+                y[j] *= g[j] - dot;
+            }
+        }
+    }
+
+protected:
+    void applyRow(const double* in, double* out, size_t n) const override {
+        matrix::simd::softmax(in, out, n);
+    }
+};
+
+// Row-wise log-softmax, x_j - max - log(sum_k exp(x_k - max)). More
+// accurate than log(Softmax) for very negative scores, which would
+// otherwise round to log(0).
+class LogSoftmax : public RowWiseActivation {
+public:
+    // dL/dx_j = g_j - softmax(x)_j * sum_k g_k
+    void backward(const matrix::Matrix& input, const matrix::Matrix& output_grad,
+                  matrix::Matrix& input_grad) const override {
+        input_grad.resize(input.getRows(), input.getCols());
+        for (size_t i = 0; i < input.getRows(); ++i) {
+            auto s = input_grad.row(i);
+            auto g = output_grad.row(i);
+            matrix::simd::softmax(input.row(i).data(), s.data(), s.size());
+            double total = 0.0;
+            for (double v : g) {
+                total += v;
+            }
+            for (size_t j = 0; j < s.size(); ++j) {
+                s[j] = g[j] - s[j] * total;
+            }
+        }
+    }
+
+protected:
+    void applyRow(const double* in, double* out, size_t n) const override {
+        matrix::simd::logSoftmax(in, out, n);
+    }
+};
+
+// GEMM epilogue equivalent to an activation, or None if it has to run
+// through the virtual interface. Only the built-in classes themselves
+// qualify; a subclass may have overridden apply().
+inline matrix::EpilogueActivation fusedEpilogue(const Activation& activation) {
+    const std::type_info& type = typeid(activation);
+    if (type == typeid(ReLU)) {
+        return matrix::EpilogueActivation::ReLU;
+    }
+    if (type == typeid(Sigmoid)) {
+        return matrix::EpilogueActivation::Sigmoid;
+    }
+    if (type == typeid(Tanh)) {
+        return matrix::EpilogueActivation::Tanh;
+    }
+    if (type == typeid(GELU)) {
+        return matrix::EpilogueActivation::GELU;
+    }
+    return matrix::EpilogueActivation::None;
+}
+
+// An activation held for dispatch without virtual calls.
+//
+// The built-in activations are stored by value in a std::variant. Each call
+// is a std::visit over that variant followed by a qualified, non-virtual
+// call, so the target is fixed at compile time and can be inlined. Any
+// other Activation, including subclasses of the built-ins (which may
+// override any method), is kept behind a unique_ptr and called virtually.
+// Converts implicitly from a unique_ptr to an activation or from a built-in
+// held by value, so callers keep passing std::make_unique<ReLU>() as before.
+class ActivationFunction {
+private:
+    using Holder = std::variant<ReLU, Sigmoid, Tanh, GELU, LeakyReLU, Identity, Softmax, LogSoftmax,
+                                std::unique_ptr<Activation>>;
+    Holder holder;
+
+    template <typename A>
+    static constexpr bool is_builtin = !std::is_same_v<A, std::unique_ptr<Activation>>
+                                       && std::is_constructible_v<Holder, std::in_place_type_t<A>>;
+
+    // Store a copy of activation if its dynamic type is exactly one of
+    // Builtins
+    template <typename... Builtins>
+    bool unwrap(const Activation& activation) {
+        return (unwrapAs<Builtins>(activation) || ...);
+    }
+
+    // dynamic_cast rather than a static_cast guarded by typeid: the latter
+    // lets GCC see a cast to a type larger than the object (-Warray-bounds)
+    template <typename A>
+    bool unwrapAs(const Activation& activation) {
+        const A* builtin = dynamic_cast<const A*>(&activation);
+        if (!builtin || typeid(*builtin) != typeid(A)) {
+            return false;
+        }
+        holder.template emplace<A>(*builtin);
+        return true;
+    }
+
+    // f(activation, direct): direct is true for the by-value built-ins,
+    // whose methods f must call qualified, i.e. A::method()
+    template <typename F>
+    decltype(auto) visit(F&& f) const {
+        return std::visit([&](const auto& held) -> decltype(auto) {
+            using H = std::decay_t<decltype(held)>;
+            if constexpr (std::is_same_v<H, std::unique_ptr<Activation>>) {
+                return f(*held, std::false_type{});
+            } else {
+                return f(held, std::true_type{});
+            }
+        }, holder);
+    }
+
+public:
+    template <std::derived_from<Activation> A>
+    ActivationFunction(std::unique_ptr<A> activation) {
+        if (!activation) {
+            throw std::invalid_argument("Activation must not be null");
+        }
+        if (!unwrap<ReLU, Sigmoid, Tanh, GELU, LeakyReLU, Identity, Softmax, LogSoftmax>(*activation)) {
+            holder = std::unique_ptr<Activation>(std::move(activation));
+        }
+    }
+
+    template <std::derived_from<Activation> A>
+    ActivationFunction(A activation) {
+        if constexpr (is_builtin<A>) {
+            holder.template emplace<A>(std::move(activation));
+        } else {
+            holder = std::make_unique<A>(std::move(activation));
+        }
+    }
+
+    // The held activation, for code that wants the polymorphic interface
+    const Activation& get() const {
+        return visit([](const Activation& a, auto) -> const Activation& { return a; });
+    }
+
+    // True when calls are dispatched statically (a built-in activation)
+    bool isBuiltin() const { return !std::holds_alternative<std::unique_ptr<Activation>>(holder); }
+
+    // True for Identity, whose layers skip the activation pass entirely
+    bool isIdentity() const { return std::holds_alternative<Identity>(holder); }
+
+    // Copy of a built-in activation. Others are owned through a unique_ptr
+    // and cannot be copied, so this throws std::logic_error for them.
+    ActivationFunction copyBuiltin() const {
+        return std::visit([](const auto& held) -> ActivationFunction {
+            using H = std::decay_t<decltype(held)>;
+            if constexpr (std::is_same_v<H, std::unique_ptr<Activation>>) {
+                throw std::logic_error("Only built-in activations can be copied");
+            } else {
+                return ActivationFunction(held);
+            }
+        }, holder);
+    }
+
+    // GEMM epilogue equivalent to the activation (see fusedEpilogue())
+    matrix::EpilogueActivation fused() const {
+        if (std::holds_alternative<ReLU>(holder)) {
+            return matrix::EpilogueActivation::ReLU;
+        }
+        if (std::holds_alternative<Sigmoid>(holder)) {
+            return matrix::EpilogueActivation::Sigmoid;
+        }
+        if (std::holds_alternative<Tanh>(holder)) {
+            return matrix::EpilogueActivation::Tanh;
+        }
+        if (std::holds_alternative<GELU>(holder)) {
+            return matrix::EpilogueActivation::GELU;
+        }
+        return matrix::EpilogueActivation::None;
+    }
+
+    ActivationKind kind() const {
+        return visit([](const auto& a, auto direct) {
+            using A = std::decay_t<decltype(a)>;
+            if constexpr (decltype(direct)::value) {
+                return a.A::kind();
+            } else {
+                return a.kind();
+            }
+        });
+    }
+
+    void applyInto(const matrix::Matrix& input, matrix::Matrix& output) const {
+        PROFILE_SCOPE("Activation::apply", "activation");
+        visit([&](const auto& a, auto direct) {
+            using A = std::decay_t<decltype(a)>;
+            if constexpr (decltype(direct)::value) {
+                a.A::applyInto(input, output);
+            } else {
+                a.applyInto(input, output);
+            }
+        });
+    }
+
+    void applyTo(matrix::ConstMatrixView input, matrix::MatrixView output) const {
+        PROFILE_SCOPE("Activation::apply", "activation");
+        visit([&](const auto& a, auto direct) {
+            using A = std::decay_t<decltype(a)>;
+            if constexpr (decltype(direct)::value) {
+                a.A::applyTo(input, output);
+            } else {
+                a.applyTo(input, output);
+            }
+        });
+    }
+
+    matrix::Matrix derivative(const matrix::Matrix& input) const {
+        return visit([&](const auto& a, auto direct) {
+            using A = std::decay_t<decltype(a)>;
+            if constexpr (decltype(direct)::value) {
+                return a.A::derivative(input);
+            } else {
+                return a.derivative(input);
+            }
+        });
+    }
+
+    void backward(const matrix::Matrix& input, const matrix::Matrix& output_grad, matrix::Matrix& input_grad) const {
+        visit([&](const auto& a, auto direct) {
+            using A = std::decay_t<decltype(a)>;
+            if constexpr (decltype(direct)::value) {
+                a.A::backward(input, output_grad, input_grad);
+            } else {
+                a.backward(input, output_grad, input_grad);
+            }
+        });
+    }
 };
 
 } // namespace neural
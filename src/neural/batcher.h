@@ -0,0 +1,222 @@
+#ifndef BATCHER_H
+#define BATCHER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../profiler/profiler.h"
+#include "inference_plan.h"
+#include "sequential.h"
+
+namespace neural {
+
+// Runs one batch: output receives one row per input row
+using BatchFunction = std::function<void(const matrix::Matrix& input, matrix::Matrix& output)>;
+
+struct BatcherOptions {
+    // Largest batch handed to the model at once
+    size_t max_batch_size = 32;
+
+    // Longest the oldest queued request waits for the batch to fill up
+    std::chrono::microseconds max_wait{500};
+};
+
+// Counters since the batcher started
+struct BatcherStats {
+    size_t requests = 0;
+    size_t batches = 0;
+    size_t full_batches = 0;  // Batches closed by reaching max_batch_size
+
+    double meanBatchSize() const { return batches ? double(requests) / double(batches) : 0.0; }
+};
+
+// Coalesces single-row requests from any number of threads into batches.
+//
+// submit() queues one input row and returns a future for its output row. A
+// worker thread takes up to max_batch_size queued rows as soon as that many
+// are waiting, or once the oldest has waited max_wait, runs a single forward
+// pass over them and fulfils each future with its row of the result. An
+// exception from the forward pass is delivered through every future of
+// that batch. One 1-row product per request uses the GEMM at a fraction of
+// its throughput; a batch of 32 costs little more than one of them.
+//
+// The model is only ever called from the worker thread, so a Sequential
+// (whose forward() reuses internal buffers) is safe to serve; it must
+// outlive the batcher and not be used elsewhere meanwhile. The destructor
+// processes every request still queued before returning.
+class RequestBatcher {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        std::vector<double> input;
+        std::promise<std::vector<double>> result;
+        Clock::time_point arrival;
+    };
+
+    size_t input_size;
+    BatchFunction forward;
+    BatcherOptions options;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Request> queue;
+    bool stopping = false;
+
+    std::atomic<size_t> request_count{0};
+    std::atomic<size_t> batch_count{0};
+    std::atomic<size_t> full_batch_count{0};
+
+    std::thread worker;
+
+    static const BatcherOptions& checkBatchSize(const Sequential& model, const BatcherOptions& options) {
+        if (options.max_batch_size > model.getMaxBatchSize()) {
+            throw std::invalid_argument("Batcher maximum batch size " + std::to_string(options.max_batch_size)
+                                        + " exceeds the model's " + std::to_string(model.getMaxBatchSize()));
+        }
+        return options;
+    }
+
+    // Worker loop: wait for a full batch or the oldest request's deadline
+    void run() {
+        matrix::Matrix input;
+        matrix::Matrix output;
+        std::vector<Request> batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (queue.empty()) {
+                    return;
+                }
+                ready.wait_until(lock, queue.front().arrival + options.max_wait, [&] {
+                    return stopping || queue.size() >= options.max_batch_size;
+                });
+                size_t count = std::min(queue.size(), options.max_batch_size);
+                batch.clear();
+                std::move(queue.begin(), queue.begin() + count, std::back_inserter(batch));
+                queue.erase(queue.begin(), queue.begin() + count);
+            }
+
+            // Counted before any future is ready, so a caller that has its
+            // result also sees its batch in getStats()
+            request_count += batch.size();
+            ++batch_count;
+            if (batch.size() == options.max_batch_size) {
+                ++full_batch_count;
+            }
+            PROFILE_COUNTER("RequestBatcher::batch_size", double(batch.size()));
+
+            input.resize(batch.size(), input_size);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                std::copy(batch[i].input.begin(), batch[i].input.end(), input.row(i).begin());
+            }
+            try {
+                forward(input, output);
+                if (output.getRows() != batch.size()) {
+                    throw std::runtime_error("Batch function returned " + std::to_string(output.getRows())
+                                             + " rows for a batch of " + std::to_string(batch.size()));
+                }
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    auto row = output.row(i);
+                    batch[i].result.set_value(std::vector<double>(row.begin(), row.end()));
+                }
+            } catch (...) {
+                for (Request& request : batch) {
+                    request.result.set_exception(std::current_exception());
+                }
+            }
+        }
+    }
+
+public:
+    // Serve an arbitrary batch function over rows of input_size values
+    RequestBatcher(size_t input_size, BatchFunction forward, const BatcherOptions& options = {})
+        : input_size(input_size), forward(std::move(forward)), options(options) {
+        if (options.max_batch_size == 0) {
+            throw std::invalid_argument("Maximum batch size must be positive");
+        }
+        if (!this->forward) {
+            throw std::invalid_argument("Batch function must not be empty");
+        }
+        worker = std::thread([this] { run(); });
+    }
+
+    // Serve a Sequential model, whose maximum batch size must cover
+    // options.max_batch_size
+    RequestBatcher(Sequential& model, const BatcherOptions& options = {})
+        : RequestBatcher(model.getInputSize(),
+                         [&model](const matrix::Matrix& input, matrix::Matrix& output) {
+                             model.forward(input, output);
+                         },
+                         checkBatchSize(model, options)) {}
+
+    // Serve a compiled plan (which must outlive the batcher)
+    RequestBatcher(const InferencePlan& plan, const BatcherOptions& options = {})
+        : RequestBatcher(plan.getInputSize(),
+                         [&plan](const matrix::Matrix& input, matrix::Matrix& output) {
+                             plan.infer(input, output);
+                         },
+                         options) {}
+
+    RequestBatcher(const RequestBatcher&) = delete;
+    RequestBatcher& operator=(const RequestBatcher&) = delete;
+
+    ~RequestBatcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_one();
+        worker.join();
+    }
+
+    // Queue one input row; the future receives its output row
+    std::future<std::vector<double>> submit(std::span<const double> row) {
+        if (row.size() != input_size) {
+            throw std::invalid_argument("Request has " + std::to_string(row.size()) + " values, the model takes "
+                                        + std::to_string(input_size));
+        }
+        Request request{std::vector<double>(row.begin(), row.end()), {}, Clock::now()};
+        std::future<std::vector<double>> result = request.result.get_future();
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                throw std::logic_error("Batcher is shutting down");
+            }
+            queue.push_back(std::move(request));
+            // The worker waits for the first request, then for a full batch
+            wake = queue.size() == 1 || queue.size() >= options.max_batch_size;
+        }
+        if (wake) {
+            ready.notify_one();
+        }
+        return result;
+    }
+
+    BatcherStats getStats() const {
+        BatcherStats stats;
+        stats.requests = request_count.load();
+        stats.batches = batch_count.load();
+        stats.full_batches = full_batch_count.load();
+        return stats;
+    }
+
+    const BatcherOptions& getOptions() const { return options; }
+    size_t getInputSize() const { return input_size; }
+};
+
+} // namespace neural
+
+#endif // BATCHER_H
@@ -3,30 +3,161 @@
 
 #include <random>
 #include <memory>
+#include <optional>
 #include "../matrix/matrix.h"
+#include "../matrix/simd.h"
+#include "../matrix/sparse_matrix.h"
+#include "../matrix/matrix_view.h"
+#include "../matrix/matrix_io.h"
+#include "../matrix/quantized_matrix.h"
+#include "../profiler/profiler.h"
 #include "activation.h"
+#include "optimizer.h"
 
 namespace neural {
 
+// Gradients of the loss with respect to a layer's weights and biases
+struct DenseGradients {
+    matrix::Matrix weights;
+    matrix::Matrix biases;
+
+    // Reset to zero for a layer of the given size
+    void zero(size_t input_size, size_t output_size) {
+        weights.resize(input_size, output_size);
+        biases.resize(1, output_size);
+        for (matrix::Matrix* m : {&weights, &biases}) {
+            for (size_t i = 0; i < m->getRows(); ++i) {
+                std::fill(m->row(i).begin(), m->row(i).end(), 0.0);
+            }
+        }
+    }
+
+    // Add other's gradients to these
+    void add(const DenseGradients& other) {
+        for (auto [to, from] : {std::pair{&weights, &other.weights}, std::pair{&biases, &other.biases}}) {
+            for (size_t i = 0; i < to->getRows(); ++i) {
+                matrix::simd::add(to->row(i).data(), from->row(i).data(), to->row(i).data(), to->getCols());
+            }
+        }
+    }
+};
+
 class DenseLayer {
 private:
     size_t input_size;
     size_t output_size;
     matrix::Matrix weights;
+    matrix::SparseMatrix sparse_weights;  // Used instead of weights when sparse
+    bool sparse = false;
+    std::optional<matrix::MappedMatrix> mapped_weights;  // Used instead of weights when mapped
+    matrix::QuantizedMatrix quantized_weights;  // Used instead of weights when quantized
+    bool quantized = false;
+    double input_scale = 1.0;  // Calibrated int8 scale of the input when quantized
     matrix::Matrix biases;
-    std::unique_ptr<Activation> activation;
+    ActivationFunction activation;
+    matrix::EpilogueActivation fused;  // None: apply activation after the GEMM
+    bool training = true;
     
     // Last input and output stored for potential backpropagation
     matrix::Matrix last_input;
     matrix::Matrix last_output;
     matrix::Matrix last_z;  // Pre-activation output
 
+    // Accumulated parameter gradients (see backward())
+    DenseGradients grads;
+
+    // Dense weights, owned or memory-mapped
+    matrix::ConstMatrixView weightView() const {
+        return mapped_weights ? mapped_weights->view<double>() : matrix::view(weights);
+    }
+
+    // out = activation(X * W + b), storing X * W + b to pre_activation if
+    // non-null. For sparse weights only EpilogueActivation::None is valid.
+    void affine(const matrix::Matrix& input, matrix::Matrix& out,
+                matrix::EpilogueActivation epilogue, matrix::Matrix* pre_activation) const {
+        if (sparse) {
+            matrix::SparseMatrix::multiplyInto(input, sparse_weights, out);
+            
+            // Add biases to each row
+            for (size_t i = 0; i < out.getRows(); ++i) {
+                matrix::simd::add(out.row(i).data(), biases.row(0).data(), out.row(i).data(), output_size);
+            }
+            return;
+        }
+        if (quantized) {
+            matrix::QuantizedMatrix::multiplyInto(input, input_scale, quantized_weights, biases,
+                                                  epilogue, out, pre_activation);
+            return;
+        }
+        if (!mapped_weights) {
+            matrix::Matrix::multiplyInto(input, weights, biases, epilogue, out, pre_activation);
+            return;
+        }
+        matrix::Epilogue<double> ep;
+        ep.bias = biases.data();
+        ep.activation = epilogue;
+        out.resize(input.getRows(), output_size);
+        if (pre_activation) {
+            pre_activation->resize(input.getRows(), output_size);
+            ep.pre_activation = pre_activation->data();
+            ep.ld_pre = pre_activation->getStride();
+        }
+        matrix::multiplyInto(matrix::view(input), weightView(), matrix::view(out), ep);
+    }
+
+    // Copy mapped weights into owned storage and drop the mapping
+    void materialize() {
+        if (mapped_weights) {
+            weights = mapped_weights->toMatrix<double>();
+            mapped_weights.reset();
+        }
+    }
+
+    void checkDimensions(size_t weight_rows, size_t weight_cols) const {
+        if (weight_rows != input_size || weight_cols != output_size) {
+            throw std::invalid_argument("Weights dimensions don't match layer dimensions");
+        }
+        
+        if (biases.getRows() != 1 || biases.getCols() != output_size) {
+            throw std::invalid_argument("Biases dimensions don't match layer dimensions");
+        }
+    }
+
+    // Multiply-adds of one pass over a batch, for the profiler
+    double flops(size_t batch) const {
+        double per_row = sparse ? double(sparse_weights.getNonZeros()) : double(input_size) * double(output_size);
+        return 2.0 * double(batch) * per_row;
+    }
+
+    void checkInput(const matrix::Matrix& input) const {
+        if (input.getCols() != input_size) {
+            throw std::invalid_argument("Input dimensions don't match layer input size");
+        }
+    }
+
+    // Compute last_output (and, in training mode, last_input and last_z)
+    // for input, reusing their buffers. Profiled as DenseLayer::forward in
+    // training mode and DenseLayer::infer otherwise.
+    void computeForward(const matrix::Matrix& input) {
+        // Validate input dimensions
+        checkInput(input);
+        
+        // Store input and pre-activation output for backpropagation
+        if (training) {
+            last_input = input;
+            forward(input, last_z, last_output);
+        } else {
+            infer(input, last_output, last_z);
+        }
+    }
+
 public:
     // Constructor with random initialization
-    DenseLayer(size_t input_size, size_t output_size, std::unique_ptr<Activation> activation)
+    DenseLayer(size_t input_size, size_t output_size, ActivationFunction activation)
         : input_size(input_size),
           output_size(output_size),
-          activation(std::move(activation)) {
+          activation(std::move(activation)),
+          fused(this->activation.fused()) {
         
         // Initialize weights with random values (Xavier/Glorot initialization)
         std::random_device rd;
@@ -35,13 +166,12 @@ public:
         
         double scale = std::sqrt(6.0 / (input_size + output_size));
         
-        std::vector<std::vector<double>> weight_data(input_size, std::vector<double>(output_size));
+        weights = matrix::Matrix(input_size, output_size);
         for (size_t i = 0; i < input_size; ++i) {
-            for (size_t j = 0; j < output_size; ++j) {
-                weight_data[i][j] = dist(gen) * scale;
+            for (double& w : weights.row(i)) {
+                w = dist(gen) * scale;
             }
         }
-        weights = matrix::Matrix(weight_data);
         
         // Initialize biases to zero
         biases = matrix::Matrix(1, output_size, 0.0);
@@ -51,59 +181,276 @@ public:
     DenseLayer(size_t input_size, size_t output_size, 
                const matrix::Matrix& weights, 
                const matrix::Matrix& biases,
-               std::unique_ptr<Activation> activation)
+               ActivationFunction activation)
         : input_size(input_size),
           output_size(output_size),
           weights(weights),
           biases(biases),
-          activation(std::move(activation)) {
+          activation(std::move(activation)),
+          fused(this->activation.fused()) {
         
         // Validate matrix dimensions
-        if (weights.getRows() != input_size || weights.getCols() != output_size) {
-            throw std::invalid_argument("Weights dimensions don't match layer dimensions");
-        }
+        checkDimensions(weights.getRows(), weights.getCols());
+    }
+    
+    // Constructor with pruned (sparse) weights; the forward pass then costs
+    // O(batch * nnz) instead of O(batch * input_size * output_size)
+    DenseLayer(size_t input_size, size_t output_size,
+               const matrix::SparseMatrix& weights,
+               const matrix::Matrix& biases,
+               ActivationFunction activation)
+        : input_size(input_size),
+          output_size(output_size),
+          sparse_weights(weights.toLayout(matrix::SparseLayout::CSR)),
+          sparse(true),
+          biases(biases),
+          activation(std::move(activation)),
+          fused(this->activation.fused()) {
         
-        if (biases.getRows() != 1 || biases.getCols() != output_size) {
-            throw std::invalid_argument("Biases dimensions don't match layer dimensions");
+        // Validate matrix dimensions
+        checkDimensions(weights.getRows(), weights.getCols());
+    }
+
+    // Constructor with memory-mapped weights (see matrix_io.h), used in
+    // place without copying. The layer keeps the mapping alive. Training
+    // (parameters()) or sparsify() first copies the weights into memory.
+    DenseLayer(size_t input_size, size_t output_size,
+               const matrix::MappedMatrix& weights,
+               const matrix::Matrix& biases,
+               ActivationFunction activation)
+        : input_size(input_size),
+          output_size(output_size),
+          mapped_weights(weights),
+          biases(biases),
+          activation(std::move(activation)),
+          fused(this->activation.fused()) {
+        
+        // Validate element type and matrix dimensions
+        mapped_weights->view<double>();
+        checkDimensions(weights.getRows(), weights.getCols());
+    }
+
+    // Switch to sparse weights, dropping every weight with |w| <= threshold.
+    // The dense weight matrix is released.
+    void sparsify(double threshold) {
+        if (quantized) {
+            throw std::logic_error("Quantized layers cannot be sparsified");
+        }
+        if (!sparse) {
+            materialize();
+            sparse_weights = matrix::SparseMatrix::fromDense(weights, threshold);
+            weights = matrix::Matrix();
+            sparse = true;
+        }
+    }
+
+    // Switch to int8 weights for inference (see quantized_matrix.h): each
+    // output channel is quantized with its own symmetric scale, and the
+    // input scale is calibrated from a representative sample batch, beyond
+    // whose range inputs saturate. The double weights are released, so the
+    // layer can no longer be trained. Calling it again recalibrates the
+    // input scale only.
+    void quantize(const matrix::Matrix& calibration) {
+        if (sparse) {
+            throw std::logic_error("Sparse layers cannot be quantized");
+        }
+        checkInput(calibration);
+        input_scale = matrix::symmetricScale(calibration);
+        if (!quantized) {
+            quantized_weights = matrix::QuantizedMatrix::fromDense(weightView());
+            weights = matrix::Matrix();
+            mapped_weights.reset();
+            quantized = true;
         }
     }
     
     // Forward pass
     matrix::Matrix forward(const matrix::Matrix& input) {
-        // Validate input dimensions
-        if (input.getCols() != input_size) {
-            throw std::invalid_argument("Input dimensions don't match layer input size");
+        computeForward(input);
+        return last_output;
+    }
+
+    // Forward pass into a caller-owned output matrix. Once the cached
+    // matrices and output have grown to the batch size this performs no
+    // heap allocations.
+    void forward(const matrix::Matrix& input, matrix::Matrix& output) {
+        computeForward(input);
+        output = last_output;
+    }
+    
+    // Stateless inference: output = activation(input * W + b) without
+    // touching the cached input, pre-activation or output. const and safe to
+    // call from any number of threads at once on the same layer (given an
+    // activation without mutable state, which holds for the built-in ones).
+    // Scratch space for the non-fused path comes from the current memory
+    // resource, so an ArenaScope keeps it off the heap.
+    void infer(const matrix::Matrix& input, matrix::Matrix& output) const {
+        matrix::Matrix scratch;
+        infer(input, output, scratch);
+    }
+
+    // As above, with a caller-owned buffer for the pre-activation values of
+    // the non-fused path (unused when the activation is fused). Does not
+    // allocate once output and scratch have reached the batch size.
+    void infer(const matrix::Matrix& input, matrix::Matrix& output, matrix::Matrix& scratch) const {
+        checkInput(input);
+        PROFILE_SCOPE_FLOPS("DenseLayer::infer", "layer", flops(input.getRows()));
+        if (activation.isIdentity()) {
+            affine(input, output, matrix::EpilogueActivation::None, nullptr);
+            return;
         }
-        
-        // Store input for potential backpropagation
-        last_input = input;
-        
-        // Compute Z = X * W + b
-        matrix::Matrix z = input.multiply(weights);
-        
-        // Add biases to each row
-        for (size_t i = 0; i < z.getRows(); ++i) {
-            for (size_t j = 0; j < z.getCols(); ++j) {
-                z.set(i, j, z.get(i, j) + biases.get(0, j));
-            }
+        // Built-in activation on dense weights: bias add and activation run
+        // inside the GEMM on each output tile while it is still in cache
+        if (!sparse && fused != matrix::EpilogueActivation::None) {
+            affine(input, output, fused, nullptr);
+            return;
         }
-        
-        // Store pre-activation output
-        last_z = z;
-        
-        // Apply activation function
-        last_output = activation->apply(z);
-        
-        return last_output;
+        affine(input, scratch, matrix::EpilogueActivation::None, nullptr);
+        activation.applyInto(scratch, output);
+    }
+
+    matrix::Matrix infer(const matrix::Matrix& input) const {
+        matrix::Matrix output;
+        infer(input, output);
+        return output;
+    }
+
+    // Stateless training forward pass: z receives the pre-activation values
+    // and output the activations, ready for the stateless backward(). const
+    // and thread-safe like infer().
+    void forward(const matrix::Matrix& input, matrix::Matrix& z, matrix::Matrix& output) const {
+        checkInput(input);
+        PROFILE_SCOPE_FLOPS("DenseLayer::forward", "layer", flops(input.getRows()));
+        if (!sparse && fused != matrix::EpilogueActivation::None) {
+            affine(input, output, fused, &z);
+            return;
+        }
+        affine(input, z, matrix::EpilogueActivation::None, nullptr);
+        activation.applyInto(z, output);
     }
+
+    // Backward pass for the last forward() in training mode. Adds the
+    // gradients of the loss with respect to the weights and biases to
+    // getGradients() and returns the gradient with respect to the input.
+    matrix::Matrix backward(const matrix::Matrix& output_grad) {
+        matrix::Matrix input_grad;
+        backward(output_grad, input_grad);
+        return input_grad;
+    }
+
+    void backward(const matrix::Matrix& output_grad, matrix::Matrix& input_grad) {
+        if (!training || last_input.getRows() != output_grad.getRows()) {
+            throw std::logic_error("backward() needs a preceding forward() of the same batch in training mode");
+        }
+        if (grads.weights.getRows() != input_size) {
+            zeroGrad();
+        }
+        backward(last_input, last_z, output_grad, grads, &input_grad);
+    }
+
+    // Stateless backward pass given the input and pre-activation values of a
+    // forward pass. Adds the parameter gradients to out_grads (which must be
+    // zeroed for this layer's size) and, if input_grad is non-null, writes
+    // the gradient with respect to the input there. const and thread-safe,
+    // so shards of a batch can be processed concurrently.
+    void backward(const matrix::Matrix& input, const matrix::Matrix& z, const matrix::Matrix& output_grad,
+                  DenseGradients& out_grads, matrix::Matrix* input_grad) const {
+        if (sparse) {
+            throw std::logic_error("Backpropagation through sparse weights is not supported");
+        }
+        if (quantized) {
+            throw std::logic_error("Backpropagation through quantized weights is not supported");
+        }
+        if (output_grad.getRows() != input.getRows() || output_grad.getCols() != output_size
+            || z.getRows() != input.getRows() || z.getCols() != output_size) {
+            throw std::invalid_argument("Gradient dimensions don't match layer output size");
+        }
+        if (out_grads.weights.getRows() != input_size || out_grads.weights.getCols() != output_size) {
+            throw std::invalid_argument("Gradient accumulators don't match layer dimensions");
+        }
+
+        // delta = dL/dZ, i.e. dL/dY * f'(Z) for element-wise activations
+        matrix::Matrix delta;
+        activation.backward(z, output_grad, delta);
+
+        // dL/dW += X^T * delta, reading X transposed in place
+        matrix::Matrix weight_step(input_size, output_size);
+        matrix::multiplyInto(matrix::view(input).transposed(), matrix::view(delta), matrix::view(weight_step));
+        for (size_t i = 0; i < input_size; ++i) {
+            matrix::simd::add(out_grads.weights.row(i).data(), weight_step.row(i).data(),
+                              out_grads.weights.row(i).data(), output_size);
+        }
+
+        // dL/db += column sums of delta
+        double* bias_grad = out_grads.biases.row(0).data();
+        for (size_t i = 0; i < delta.getRows(); ++i) {
+            matrix::simd::add(bias_grad, delta.row(i).data(), bias_grad, output_size);
+        }
+
+        // dL/dX = delta * W^T
+        if (input_grad) {
+            input_grad->resize(input.getRows(), input_size);
+            matrix::multiplyInto(matrix::view(delta), weightView().transposed(), matrix::view(*input_grad));
+        }
+    }
+
+    // Reset the accumulated gradients to zero
+    void zeroGrad() { grads.zero(input_size, output_size); }
+
+    // Add gradients computed elsewhere (e.g. by the stateless backward())
+    void accumulateGradients(const DenseGradients& other) {
+        if (grads.weights.getRows() != input_size) {
+            zeroGrad();
+        }
+        grads.add(other);
+    }
+
+    const DenseGradients& getGradients() const { return grads; }
+
+    // Weights and biases paired with their accumulated gradients
+    std::vector<Parameter> parameters() {
+        if (sparse) {
+            throw std::logic_error("Sparse layers have no trainable dense parameters");
+        }
+        if (quantized) {
+            throw std::logic_error("Quantized layers have no trainable parameters");
+        }
+        materialize();
+        if (grads.weights.getRows() != input_size) {
+            zeroGrad();
+        }
+        return {{&weights, &grads.weights}, {&biases, &grads.biases}};
+    }
+
+    // Training mode (the default) keeps the last input and pre-activation
+    // output for backpropagation; inference mode skips storing them, which
+    // lets the fused path write the activations directly.
+    void setTraining(bool enabled) { training = enabled; }
+    bool isTraining() const { return training; }
     
     // Getters
+    // Owned dense weights; empty (0x0) for a sparse layer (see
+    // getSparseWeights()), a quantized one (see getQuantizedWeights()) or a
+    // mapped one (see getWeightsView())
     const matrix::Matrix& getWeights() const { return weights; }
+    // Dense weights wherever they live; empty for a sparse or quantized layer
+    matrix::ConstMatrixView getWeightsView() const { return weightView(); }
+    bool isMapped() const { return mapped_weights.has_value(); }
+    const Activation& getActivation() const { return activation.get(); }
+    const ActivationFunction& getActivationFunction() const { return activation; }
+    // True when the activation is a built-in dispatched without virtual calls
+    bool hasBuiltinActivation() const { return activation.isBuiltin(); }
+    const matrix::SparseMatrix& getSparseWeights() const { return sparse_weights; }
+    bool isSparse() const { return sparse; }
+    const matrix::QuantizedMatrix& getQuantizedWeights() const { return quantized_weights; }
+    bool isQuantized() const { return quantized; }
+    double getInputScale() const { return input_scale; }
     const matrix::Matrix& getBiases() const { return biases; }
     size_t getInputSize() const { return input_size; }
     size_t getOutputSize() const { return output_size; }
     const matrix::Matrix& getLastInput() const { return last_input; }
     const matrix::Matrix& getLastOutput() const { return last_output; }
+    // Pre-activation output of the last forward pass in training mode
     const matrix::Matrix& getLastZ() const { return last_z; }
 };
 
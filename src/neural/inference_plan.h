@@ -0,0 +1,320 @@
+#ifndef INFERENCE_PLAN_H
+#define INFERENCE_PLAN_H
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../matrix/packed_matrix.h"
+#include "sequential.h"
+
+namespace neural {
+
+// Weight representation a plan step multiplies with
+enum class PlanKernel {
+    Dense,     // Pre-packed GEMM panels (see packed_matrix.h)
+    Sparse,    // CSR weights holding only the non-zeros
+    Quantized  // Per-channel int8 weights (see quantized_matrix.h)
+};
+
+struct PlanOptions {
+    // Fold a layer with an Identity activation into the next layer when the
+    // product of their weights costs no more than the two separately
+    bool fold_linear = true;
+
+    // Benchmark CSR weights for steps with at most this fraction of
+    // non-zero weights. Lossless: only exact zeros are dropped.
+    bool allow_sparse = true;
+    double sparse_max_density = 0.5;
+
+    // Benchmark int8 weights for every step, calibrated on the sample batch.
+    // Off by default because it changes the results (see
+    // quantization.h for measuring by how much).
+    bool allow_quantized = false;
+
+    // Timed runs per candidate kernel; the fastest run counts
+    size_t benchmark_repeats = 3;
+};
+
+// What one step of a plan computes and how
+struct PlanStepInfo {
+    size_t first_layer = 0;  // First model layer folded into the step
+    size_t layer_count = 0;  // Number of model layers folded into the step
+    size_t input_size = 0;
+    size_t output_size = 0;
+    PlanKernel kernel = PlanKernel::Dense;
+    matrix::EpilogueActivation fused = matrix::EpilogueActivation::None;  // Runs inside the GEMM
+    double seconds[3] = {};  // Best benchmark time per PlanKernel, 0 if not tried
+};
+
+// A Sequential model compiled for serving.
+//
+// compile() rewrites the layer stack once:
+//  - a layer with an Identity activation is folded into the next one,
+//    W = W1 * W2 and b = b1 * W2 + b2, when that is no more work;
+//  - dense weights are packed into the GEMM panel layout up front instead
+//    of on every product;
+//  - bias and built-in element-wise activations run in the GEMM epilogue;
+//  - each step gets dense, sparse or int8 weights, whichever runs the
+//    sample batch fastest among the kernels the options allow.
+//
+// The plan owns copies of everything it needs, so it outlives the model,
+// and it has no mutators: infer() is const and may run on any number of
+// threads at once. Layers already quantized stay int8; only built-in
+// activations are supported.
+class InferencePlan {
+private:
+    struct Step {
+        PlanStepInfo info;
+        matrix::PackedMatrix packed;
+        matrix::SparseMatrix sparse;
+        matrix::QuantizedMatrix quantized;
+        double input_scale = 1.0;
+        matrix::Matrix biases;
+        ActivationFunction activation;
+
+        explicit Step(ActivationFunction activation) : activation(std::move(activation)) {}
+
+        // out = activation(input * W + b); scratch holds the pre-activation
+        // values when the activation cannot run in the epilogue
+        void run(const matrix::Matrix& input, matrix::Matrix& out, matrix::Matrix& scratch) const {
+            bool direct = info.fused != matrix::EpilogueActivation::None || activation.isIdentity();
+            matrix::Matrix& target = direct ? out : scratch;
+            switch (info.kernel) {
+            case PlanKernel::Dense:
+                matrix::PackedMatrix::multiplyInto(input, packed, biases, info.fused, target);
+                break;
+            case PlanKernel::Quantized:
+                matrix::QuantizedMatrix::multiplyInto(input, input_scale, quantized, biases, info.fused, target);
+                break;
+            case PlanKernel::Sparse:
+                matrix::SparseMatrix::multiplyInto(input, sparse, target);
+                for (size_t i = 0; i < target.getRows(); ++i) {
+                    matrix::simd::add(target.row(i).data(), biases.data(), target.row(i).data(),
+                                      info.output_size);
+                }
+                if (info.fused != matrix::EpilogueActivation::None) {
+                    activation.applyInto(target, target);
+                }
+                break;
+            }
+            if (!direct) {
+                activation.applyInto(scratch, out);
+            }
+        }
+    };
+
+    std::vector<Step> steps;
+
+    // Layers merged by folding, before a kernel is chosen
+    struct Group {
+        size_t first_layer;
+        size_t layer_count;
+        matrix::Matrix weights;  // Empty for a quantized layer
+        matrix::Matrix biases;
+        const DenseLayer* quantized;  // Source of int8 weights, or null
+        const ActivationFunction* activation;
+    };
+
+    // Fastest of repeats runs of f, after one untimed warm-up run
+    template <typename F>
+    static double bestTime(size_t repeats, F f) {
+        f();
+        double best = std::numeric_limits<double>::infinity();
+        for (size_t r = 0; r < std::max<size_t>(repeats, 1); ++r) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    }
+
+    static matrix::Matrix denseWeights(const DenseLayer& layer) {
+        return layer.isSparse() ? layer.getSparseWeights().toDense() : layer.getWeightsView().toMatrix();
+    }
+
+    // Fold the stack into groups of consecutive linear layers
+    static std::vector<Group> fold(const Sequential& model, const PlanOptions& options) {
+        std::vector<Group> groups;
+        for (size_t l = 0; l < model.size(); ++l) {
+            const DenseLayer& layer = model.layer(l);
+            if (!layer.hasBuiltinActivation()) {
+                throw std::invalid_argument("Layer " + std::to_string(l)
+                                            + " has a custom activation; inference plans support built-in ones only");
+            }
+            if (options.fold_linear && !groups.empty() && !layer.isQuantized()) {
+                Group& last = groups.back();
+                size_t in = last.weights.getRows();
+                size_t mid = layer.getInputSize();
+                size_t out = layer.getOutputSize();
+                if (!last.quantized && last.activation->isIdentity() && in * out <= in * mid + mid * out) {
+                    matrix::Matrix weights = denseWeights(layer);
+                    matrix::Matrix folded;
+                    matrix::Matrix::multiplyInto(last.weights, weights, folded);
+                    matrix::Matrix biases;
+                    matrix::Matrix::multiplyInto(last.biases, weights, layer.getBiases(),
+                                                 matrix::EpilogueActivation::None, biases);
+                    last.weights = std::move(folded);
+                    last.biases = std::move(biases);
+                    last.activation = &layer.getActivationFunction();
+                    ++last.layer_count;
+                    continue;
+                }
+            }
+            groups.push_back({l, 1, layer.isQuantized() ? matrix::Matrix() : denseWeights(layer),
+                              layer.getBiases(), layer.isQuantized() ? &layer : nullptr,
+                              &layer.getActivationFunction()});
+        }
+        return groups;
+    }
+
+    InferencePlan() = default;
+
+public:
+    // Compile model. sample is a representative input batch: each candidate
+    // kernel runs on the activations it produces at that step, and int8
+    // steps are calibrated on them. With an empty sample nothing is
+    // benchmarked and every step keeps dense (or already int8) weights.
+    static InferencePlan compile(const Sequential& model, const matrix::Matrix& sample,
+                                 const PlanOptions& options = {}) {
+        if (model.size() == 0) {
+            throw std::logic_error("Sequential model has no layers");
+        }
+        if (sample.getCols() != model.getInputSize()) {
+            throw std::invalid_argument("Sample dimensions don't match the model input size");
+        }
+        bool benchmark = sample.getRows() != 0;
+
+        InferencePlan plan;
+        matrix::Matrix current = sample;
+        matrix::Matrix next;
+        matrix::Matrix scratch;
+        for (Group& group : fold(model, options)) {
+            Step step(group.activation->copyBuiltin());
+            step.info.first_layer = group.first_layer;
+            step.info.layer_count = group.layer_count;
+            step.info.fused = group.activation->fused();
+            step.biases = std::move(group.biases);
+
+            if (group.quantized) {
+                step.info.input_size = group.quantized->getInputSize();
+                step.info.output_size = group.quantized->getOutputSize();
+                step.info.kernel = PlanKernel::Quantized;
+                step.quantized = group.quantized->getQuantizedWeights();
+                step.input_scale = group.quantized->getInputScale();
+            } else {
+                step.info.input_size = group.weights.getRows();
+                step.info.output_size = group.weights.getCols();
+                step.packed = matrix::PackedMatrix::fromDense(group.weights);
+
+                // Time every allowed candidate on this step's real input
+                auto time = [&](PlanKernel kernel) {
+                    step.info.kernel = kernel;
+                    step.info.seconds[static_cast<size_t>(kernel)] = bestTime(options.benchmark_repeats, [&] {
+                        step.run(current, next, scratch);
+                    });
+                };
+                if (benchmark) {
+                    time(PlanKernel::Dense);
+                    if (options.allow_sparse) {
+                        size_t weight_count = group.weights.getRows() * group.weights.getCols();
+                        step.sparse = matrix::SparseMatrix::fromDense(group.weights);
+                        if (step.sparse.getNonZeros() <= options.sparse_max_density * double(weight_count)) {
+                            time(PlanKernel::Sparse);
+                        }
+                    }
+                    if (options.allow_quantized) {
+                        step.quantized = matrix::QuantizedMatrix::fromDense(group.weights);
+                        step.input_scale = matrix::symmetricScale(current);
+                        time(PlanKernel::Quantized);
+                    }
+                }
+
+                // Keep the fastest and release the others
+                step.info.kernel = PlanKernel::Dense;
+                for (PlanKernel kernel : {PlanKernel::Sparse, PlanKernel::Quantized}) {
+                    double seconds = step.info.seconds[static_cast<size_t>(kernel)];
+                    if (seconds > 0.0 && seconds < step.info.seconds[static_cast<size_t>(step.info.kernel)]) {
+                        step.info.kernel = kernel;
+                    }
+                }
+                if (step.info.kernel != PlanKernel::Dense) {
+                    step.packed = matrix::PackedMatrix();
+                }
+                if (step.info.kernel != PlanKernel::Sparse) {
+                    step.sparse = matrix::SparseMatrix();
+                }
+                if (step.info.kernel != PlanKernel::Quantized) {
+                    step.quantized = matrix::QuantizedMatrix();
+                    step.input_scale = 1.0;
+                }
+            }
+
+            // Later steps see what this one will produce
+            if (benchmark) {
+                step.run(current, next, scratch);
+                std::swap(current, next);
+            }
+            plan.steps.push_back(std::move(step));
+        }
+        return plan;
+    }
+
+    // Run the plan. Intermediate activations come from the current memory
+    // resource, so an ArenaScope keeps them off the heap.
+    void infer(const matrix::Matrix& input, matrix::Matrix& output) const {
+        if (input.getCols() != getInputSize()) {
+            throw std::invalid_argument("Input dimensions don't match the plan input size");
+        }
+        if (&input == &output) {
+            throw std::invalid_argument("Plan output must not alias its input");
+        }
+        matrix::Matrix buffers[2];
+        matrix::Matrix scratch;
+        const matrix::Matrix* current = &input;
+        for (size_t i = 0; i + 1 < steps.size(); ++i) {
+            matrix::Matrix& next = buffers[i % 2];
+            steps[i].run(*current, next, scratch);
+            current = &next;
+        }
+        steps.back().run(*current, output, scratch);
+    }
+
+    matrix::Matrix infer(const matrix::Matrix& input) const {
+        matrix::Matrix output;
+        infer(input, output);
+        return output;
+    }
+
+    // Bytes of weight storage across all steps
+    size_t weightBytes() const {
+        size_t bytes = 0;
+        for (const Step& step : steps) {
+            switch (step.info.kernel) {
+            case PlanKernel::Dense:
+                bytes += step.packed.byteSize();
+                break;
+            case PlanKernel::Sparse:
+                bytes += step.sparse.getNonZeros() * (sizeof(double) + sizeof(uint32_t))
+                         + step.sparse.getOffsets().size() * sizeof(size_t);
+                break;
+            case PlanKernel::Quantized:
+                bytes += step.quantized.byteSize();
+                break;
+            }
+        }
+        return bytes;
+    }
+
+    // Getters
+    size_t size() const { return steps.size(); }
+    const PlanStepInfo& step(size_t i) const { return steps.at(i).info; }
+    size_t getInputSize() const { return steps.front().info.input_size; }
+    size_t getOutputSize() const { return steps.back().info.output_size; }
+};
+
+} // namespace neural
+
+#endif // INFERENCE_PLAN_H
@@ -0,0 +1,158 @@
+#ifndef LOSS_H
+#define LOSS_H
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "../matrix/matrix.h"
+
+namespace neural {
+
+// Loss over a batch of predictions, one sample per row.
+//
+// sum() adds up the per-sample losses and scaledGradient() returns a scaled
+// gradient of that sum, so a batch split into shards can be evaluated
+// piecewise: with scale = 1 / total rows the shard gradients add up to the
+// gradient of the mean loss of the whole batch.
+class Loss {
+public:
+    virtual ~Loss() = default;
+
+    // Sum over rows of the per-sample loss
+    virtual double sum(const matrix::Matrix& prediction, const matrix::Matrix& target) const = 0;
+
+    // scale * d sum() / d prediction, into grad (resized to match)
+    virtual void scaledGradient(const matrix::Matrix& prediction, const matrix::Matrix& target,
+                                double scale, matrix::Matrix& grad) const = 0;
+
+    // Mean per-sample loss
+    double value(const matrix::Matrix& prediction, const matrix::Matrix& target) const {
+        return prediction.getRows() == 0 ? 0.0 : sum(prediction, target) / prediction.getRows();
+    }
+
+    // Gradient of value()
+    matrix::Matrix gradient(const matrix::Matrix& prediction, const matrix::Matrix& target) const {
+        matrix::Matrix grad;
+        scaledGradient(prediction, target, prediction.getRows() == 0 ? 0.0 : 1.0 / prediction.getRows(), grad);
+        return grad;
+    }
+
+protected:
+    static void checkShapes(const matrix::Matrix& prediction, const matrix::Matrix& target) {
+        if (prediction.getRows() != target.getRows() || prediction.getCols() != target.getCols()) {
+            throw std::invalid_argument("Prediction and target dimensions don't match");
+        }
+    }
+};
+
+// Mean squared error; per sample: mean over outputs of (p - t)^2
+class MeanSquaredError : public Loss {
+public:
+    double sum(const matrix::Matrix& prediction, const matrix::Matrix& target) const override {
+        checkShapes(prediction, target);
+        double total = 0.0;
+        for (size_t i = 0; i < prediction.getRows(); ++i) {
+            auto p = prediction.row(i);
+            auto t = target.row(i);
+            for (size_t j = 0; j < p.size(); ++j) {
+                double d = p[j] - t[j];
+                total += d * d;
+            }
+        }
+        return total / prediction.getCols();
+    }
+
+    void scaledGradient(const matrix::Matrix& prediction, const matrix::Matrix& target,
+                        double scale, matrix::Matrix& grad) const override {
+        checkShapes(prediction, target);
+        grad.resize(prediction.getRows(), prediction.getCols());
+        double factor = 2.0 * scale / prediction.getCols();
+        for (size_t i = 0; i < prediction.getRows(); ++i) {
+            auto p = prediction.row(i);
+            auto t = target.row(i);
+            auto g = grad.row(i);
+            for (size_t j = 0; j < p.size(); ++j) {
+                g[j] = factor * (p[j] - t[j]);
+            }
+        }
+    }
+};
+
+// Categorical cross-entropy on predicted probabilities (rows summing to 1);
+// per sample: -sum over classes of t * log(p). Probabilities are clamped
+// away from zero.
+class CrossEntropy : public Loss {
+public:
+    static constexpr double kMinProbability = 1e-12;
+
+    double sum(const matrix::Matrix& prediction, const matrix::Matrix& target) const override {
+        checkShapes(prediction, target);
+        double total = 0.0;
+        for (size_t i = 0; i < prediction.getRows(); ++i) {
+            auto p = prediction.row(i);
+            auto t = target.row(i);
+            for (size_t j = 0; j < p.size(); ++j) {
+                if (t[j] != 0.0) {
+                    total -= t[j] * std::log(std::max(p[j], kMinProbability));
+                }
+            }
+        }
+        return total;
+    }
+
+    void scaledGradient(const matrix::Matrix& prediction, const matrix::Matrix& target,
+                        double scale, matrix::Matrix& grad) const override {
+        checkShapes(prediction, target);
+        grad.resize(prediction.getRows(), prediction.getCols());
+        for (size_t i = 0; i < prediction.getRows(); ++i) {
+            auto p = prediction.row(i);
+            auto t = target.row(i);
+            auto g = grad.row(i);
+            for (size_t j = 0; j < p.size(); ++j) {
+                g[j] = -scale * t[j] / std::max(p[j], kMinProbability);
+            }
+        }
+    }
+};
+
+// Binary cross-entropy on independent probabilities (e.g. Sigmoid outputs);
+// per sample: mean over outputs of -(t * log(p) + (1 - t) * log(1 - p)).
+// Probabilities are clamped to [eps, 1 - eps].
+class BinaryCrossEntropy : public Loss {
+public:
+    static constexpr double kEpsilon = 1e-12;
+
+    double sum(const matrix::Matrix& prediction, const matrix::Matrix& target) const override {
+        checkShapes(prediction, target);
+        double total = 0.0;
+        for (size_t i = 0; i < prediction.getRows(); ++i) {
+            auto p = prediction.row(i);
+            auto t = target.row(i);
+            for (size_t j = 0; j < p.size(); ++j) {
+                double q = std::clamp(p[j], kEpsilon, 1.0 - kEpsilon);
+                total -= t[j] * std::log(q) + (1.0 - t[j]) * std::log(1.0 - q);
+            }
+        }
+        return total / prediction.getCols();
+    }
+
+    void scaledGradient(const matrix::Matrix& prediction, const matrix::Matrix& target,
+                        double scale, matrix::Matrix& grad) const override {
+        checkShapes(prediction, target);
+        grad.resize(prediction.getRows(), prediction.getCols());
+        double factor = scale / prediction.getCols();
+        for (size_t i = 0; i < prediction.getRows(); ++i) {
+            auto p = prediction.row(i);
+            auto t = target.row(i);
+            auto g = grad.row(i);
+            for (size_t j = 0; j < p.size(); ++j) {
+                double q = std::clamp(p[j], kEpsilon, 1.0 - kEpsilon);
+                g[j] = factor * (q - t[j]) / (q * (1.0 - q));
+            }
+        }
+    }
+};
+
+} // namespace neural
+
+#endif // LOSS_H
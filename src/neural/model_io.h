@@ -0,0 +1,256 @@
+#ifndef MODEL_IO_H
+#define MODEL_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../matrix/matrix_io.h"
+#include "sequential.h"
+
+namespace neural {
+
+// Model file format (version 2, little-endian):
+//
+//   ModelFileHeader       64 bytes
+//   ModelLayerRecord[n]   one per layer, in order (40 bytes each in
+//                         version 1 files, which still load)
+//   matrix records        weights and biases of every layer, each a
+//                         64-byte-aligned record as written by
+//                         matrix::writeMatrix()
+//
+// The checksum (XXH64) covers every byte after the header. Loading parses
+// only the header and layer table; weights are either mapped in place or
+// copied straight from the mapping, so the cost of a cold start is the page
+// faults on the weights.
+
+constexpr char kModelFileMagic[8] = {'D', 'I', 'O', 'N', 'E', 'M', 'D', 'L'};
+constexpr uint32_t kModelFileVersion = 2;
+
+// Activation stored for a layer
+enum class ActivationType : uint32_t {
+    ReLU = 1,
+    Sigmoid = 2,
+    Tanh = 3,
+    GELU = 4,
+    Identity = 5,
+    LeakyReLU = 6,   // activation_param holds alpha
+    Softmax = 7,
+    LogSoftmax = 8
+};
+
+struct ModelFileHeader {
+    char magic[8];        // kModelFileMagic
+    uint32_t version;     // kModelFileVersion
+    uint32_t layer_count;
+    uint32_t dtype;       // matrix::DType of every weight matrix
+    uint32_t reserved;
+    uint64_t checksum;    // checksum64 of bytes [64, file_bytes)
+    uint64_t file_bytes;
+    uint8_t padding[24];
+};
+
+static_assert(sizeof(ModelFileHeader) == 64, "ModelFileHeader must be one cache line");
+
+struct ModelLayerRecord {
+    uint64_t input_size;
+    uint64_t output_size;
+    uint32_t activation;      // ActivationType
+    uint32_t reserved;
+    uint64_t weights_offset;  // matrix record, input_size x output_size
+    uint64_t biases_offset;   // matrix record, 1 x output_size
+    double activation_param;  // Version 2 onwards; see ActivationType
+};
+
+static_assert(sizeof(ModelLayerRecord) == 48, "ModelLayerRecord layout changed");
+
+// Size of a layer record in a file of the given version; version 1 records
+// end before activation_param
+inline size_t modelLayerRecordSize(uint32_t version) {
+    return version == 1 ? offsetof(ModelLayerRecord, activation_param) : sizeof(ModelLayerRecord);
+}
+
+struct ModelLoadOptions {
+    // Largest batch the loaded Sequential accepts
+    size_t max_batch_size = 64;
+
+    // Use the weights in place from the mapping instead of copying them
+    bool map_weights = true;
+
+    // Hash the whole file before use (reads every page once)
+    bool verify_checksum = true;
+};
+
+// Write a model. Only the built-in activations can be stored (not
+// subclasses of them); sparse and quantized layers are stored densified
+// (quantized ones dequantized).
+inline void saveModel(const std::string& path, const Sequential& model) {
+    std::vector<ModelLayerRecord> records(model.size());
+    for (size_t l = 0; l < model.size(); ++l) {
+        const DenseLayer& layer = model.layer(l);
+        switch (fusedEpilogue(layer.getActivation())) {
+        case matrix::EpilogueActivation::ReLU:
+            records[l].activation = static_cast<uint32_t>(ActivationType::ReLU);
+            break;
+        case matrix::EpilogueActivation::Sigmoid:
+            records[l].activation = static_cast<uint32_t>(ActivationType::Sigmoid);
+            break;
+        case matrix::EpilogueActivation::Tanh:
+            records[l].activation = static_cast<uint32_t>(ActivationType::Tanh);
+            break;
+        case matrix::EpilogueActivation::GELU:
+            records[l].activation = static_cast<uint32_t>(ActivationType::GELU);
+            break;
+        case matrix::EpilogueActivation::None: {
+            const Activation& activation = layer.getActivation();
+            if (typeid(activation) == typeid(Identity)) {
+                records[l].activation = static_cast<uint32_t>(ActivationType::Identity);
+            } else if (typeid(activation) == typeid(LeakyReLU)) {
+                records[l].activation = static_cast<uint32_t>(ActivationType::LeakyReLU);
+                records[l].activation_param = static_cast<const LeakyReLU&>(activation).getAlpha();
+            } else if (typeid(activation) == typeid(Softmax)) {
+                records[l].activation = static_cast<uint32_t>(ActivationType::Softmax);
+            } else if (typeid(activation) == typeid(LogSoftmax)) {
+                records[l].activation = static_cast<uint32_t>(ActivationType::LogSoftmax);
+            } else {
+                throw std::invalid_argument("Layer " + std::to_string(l) + " has an activation that cannot be saved");
+            }
+            break;
+        }
+        }
+        records[l].input_size = layer.getInputSize();
+        records[l].output_size = layer.getOutputSize();
+    }
+
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw matrix::MatrixFileError("Cannot open model file for writing: " + path);
+        }
+
+        // Header and layer table are rewritten once the offsets are known
+        ModelFileHeader header{};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(records.data()),
+                  static_cast<std::streamsize>(records.size() * sizeof(ModelLayerRecord)));
+        for (size_t l = 0; l < model.size(); ++l) {
+            const DenseLayer& layer = model.layer(l);
+            if (layer.isSparse()) {
+                records[l].weights_offset = matrix::writeMatrix(out, layer.getSparseWeights().toDense());
+            } else if (layer.isQuantized()) {
+                records[l].weights_offset = matrix::writeMatrix(out, layer.getQuantizedWeights().toDense());
+            } else if (layer.isMapped()) {
+                records[l].weights_offset = matrix::writeMatrix(out, layer.getWeightsView().toMatrix());
+            } else {
+                records[l].weights_offset = matrix::writeMatrix(out, layer.getWeights());
+            }
+            records[l].biases_offset = matrix::writeMatrix(out, layer.getBiases());
+        }
+        out.seekp(sizeof(ModelFileHeader));
+        out.write(reinterpret_cast<const char*>(records.data()),
+                  static_cast<std::streamsize>(records.size() * sizeof(ModelLayerRecord)));
+        if (!out) {
+            throw matrix::MatrixFileError("Failed to write model file: " + path);
+        }
+    }
+
+    // Checksum the payload through a mapping, then fill in the header
+    ModelFileHeader header{};
+    {
+        matrix::MappedFile file(path);
+        std::memcpy(header.magic, kModelFileMagic, sizeof(header.magic));
+        header.version = kModelFileVersion;
+        header.layer_count = static_cast<uint32_t>(model.size());
+        header.dtype = static_cast<uint32_t>(matrix::DType::Float64);
+        header.file_bytes = file.size();
+        header.checksum = matrix::checksum64(file.data() + sizeof(ModelFileHeader), file.size() - sizeof(ModelFileHeader));
+    }
+    std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out) {
+        throw matrix::MatrixFileError("Failed to write model file header: " + path);
+    }
+}
+
+// Load a model written by saveModel()
+inline Sequential loadModel(const std::string& path, const ModelLoadOptions& options = {}) {
+    auto file = std::make_shared<const matrix::MappedFile>(path);
+    if (file->size() < sizeof(ModelFileHeader)) {
+        throw matrix::MatrixFileError("Model file is truncated: " + path);
+    }
+    ModelFileHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, kModelFileMagic, sizeof(header.magic)) != 0) {
+        throw matrix::MatrixFileError("Not a model file (bad magic): " + path);
+    }
+    if (header.version != 1 && header.version != kModelFileVersion) {
+        throw matrix::MatrixFileError("Unsupported model file version " + std::to_string(header.version) + ": " + path);
+    }
+    if (header.dtype != static_cast<uint32_t>(matrix::DType::Float64)) {
+        throw matrix::MatrixFileError("Unsupported model element type: " + path);
+    }
+    size_t record_size = modelLayerRecordSize(header.version);
+    if (header.file_bytes != file->size()
+        || header.layer_count > (file->size() - sizeof(ModelFileHeader)) / record_size) {
+        throw matrix::MatrixFileError("Model file is truncated: " + path);
+    }
+    if (options.verify_checksum
+        && matrix::checksum64(file->data() + sizeof(ModelFileHeader), file->size() - sizeof(ModelFileHeader))
+               != header.checksum) {
+        throw matrix::MatrixFileError("Model file checksum mismatch: " + path);
+    }
+
+    Sequential model(options.max_batch_size);
+    for (uint32_t l = 0; l < header.layer_count; ++l) {
+        ModelLayerRecord record{};
+        std::memcpy(&record, file->data() + sizeof(ModelFileHeader) + l * record_size, record_size);
+
+        std::unique_ptr<Activation> activation;
+        switch (static_cast<ActivationType>(record.activation)) {
+        case ActivationType::ReLU:
+            activation = std::make_unique<ReLU>();
+            break;
+        case ActivationType::Sigmoid:
+            activation = std::make_unique<Sigmoid>();
+            break;
+        case ActivationType::Tanh:
+            activation = std::make_unique<Tanh>();
+            break;
+        case ActivationType::GELU:
+            activation = std::make_unique<GELU>();
+            break;
+        case ActivationType::Identity:
+            activation = std::make_unique<Identity>();
+            break;
+        case ActivationType::LeakyReLU:
+            activation = std::make_unique<LeakyReLU>(record.activation_param);
+            break;
+        case ActivationType::Softmax:
+            activation = std::make_unique<Softmax>();
+            break;
+        case ActivationType::LogSoftmax:
+            activation = std::make_unique<LogSoftmax>();
+            break;
+        default:
+            throw matrix::MatrixFileError("Unknown activation type " + std::to_string(record.activation)
+                                          + " in " + path);
+        }
+
+        matrix::MappedMatrix weights(file, record.weights_offset);
+        matrix::Matrix biases = matrix::MappedMatrix(file, record.biases_offset).toMatrix<double>();
+        if (options.map_weights) {
+            model.add(DenseLayer(record.input_size, record.output_size, weights, biases, std::move(activation)));
+        } else {
+            model.add(DenseLayer(record.input_size, record.output_size, weights.toMatrix<double>(), biases,
+                                 std::move(activation)));
+        }
+    }
+    return model;
+}
+
+} // namespace neural
+
+#endif // MODEL_IO_H
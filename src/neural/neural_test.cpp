@@ -1,9 +1,75 @@
 #include "dense.h"
 #include "activation.h"
+#include "sequential.h"
+#include "trainer.h"
+#include "model_io.h"
+#include "quantization.h"
+#include "conv.h"
+#include "pooling.h"
+#include "inference_plan.h"
+#include "batcher.h"
+#include <filesystem>
+#include "../matrix/memory_resource.h"
+#include "../profiler/profiler.h"
 #include <iostream>
 #include <vector>
 #include <memory>
 #include <iomanip>
+#include <sstream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <limits>
+#include <cmath>
+#include <thread>
+
+// Counting global allocator: every heap allocation in the process goes
+// through here, so a test can assert that a code path does not allocate.
+// GCC's -Wmismatched-new-delete cannot tell that these deletes belong to
+// the news beside them once they are inlined into a new-expression, so it
+// is silenced for the replacements.
+static std::atomic<size_t> allocation_count{0};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    ++allocation_count;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    ++allocation_count;
+    size_t align = static_cast<size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Number of failed checks; main returns non-zero if any check fails
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    std::cout << (condition ? "[PASS] " : "[FAIL] ") << what << "\n";
+    if (!condition) {
+        ++failures;
+    }
+}
 
 // Helper function to print a detailed description of a matrix
 void printMatrixDetails(const std::string& name, const matrix::Matrix& matrix) {
@@ -12,6 +78,68 @@ void printMatrixDetails(const std::string& name, const matrix::Matrix& matrix) {
     std::cout << std::endl;
 }
 
+// Direct convolution of NHWC samples, the reference for Conv2D
+static matrix::Matrix referenceConv(const matrix::Matrix& input, neural::ImageShape in, size_t out_channels,
+                                    size_t kh, size_t kw, size_t stride, size_t pad,
+                                    const matrix::Matrix& weights, const matrix::Matrix& biases) {
+    size_t oh = (in.height + 2 * pad - kh) / stride + 1;
+    size_t ow = (in.width + 2 * pad - kw) / stride + 1;
+    matrix::Matrix out(input.getRows(), oh * ow * out_channels);
+    for (size_t n = 0; n < input.getRows(); ++n) {
+        for (size_t oy = 0; oy < oh; ++oy) {
+            for (size_t ox = 0; ox < ow; ++ox) {
+                for (size_t k = 0; k < out_channels; ++k) {
+                    double sum = biases(0, k);
+                    for (size_t ky = 0; ky < kh; ++ky) {
+                        for (size_t kx = 0; kx < kw; ++kx) {
+                            long iy = static_cast<long>(oy * stride + ky) - static_cast<long>(pad);
+                            long ix = static_cast<long>(ox * stride + kx) - static_cast<long>(pad);
+                            if (iy < 0 || ix < 0 || iy >= static_cast<long>(in.height) || ix >= static_cast<long>(in.width)) {
+                                continue;
+                            }
+                            for (size_t c = 0; c < in.channels; ++c) {
+                                sum += weights((ky * kw + kx) * in.channels + c, k)
+                                       * input(n, (iy * in.width + ix) * in.channels + c);
+                            }
+                        }
+                    }
+                    out(n, (oy * ow + ox) * out_channels + k) = sum;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+// Reorder NHWC samples to NCHW
+static matrix::Matrix toNCHW(const matrix::Matrix& nhwc, neural::ImageShape shape) {
+    matrix::Matrix result(nhwc.getRows(), nhwc.getCols());
+    for (size_t n = 0; n < nhwc.getRows(); ++n) {
+        for (size_t y = 0; y < shape.height; ++y) {
+            for (size_t x = 0; x < shape.width; ++x) {
+                for (size_t c = 0; c < shape.channels; ++c) {
+                    result(n, shape.index(neural::TensorLayout::NCHW, y, x, c))
+                        = nhwc(n, shape.index(neural::TensorLayout::NHWC, y, x, c));
+                }
+            }
+        }
+    }
+    return result;
+}
+
+static double maxDiff(const matrix::Matrix& a, const matrix::Matrix& b) {
+    if (a.getRows() != b.getRows() || a.getCols() != b.getCols()) {
+        return std::numeric_limits<double>::infinity();
+    }
+    double diff = 0.0;
+    for (size_t i = 0; i < a.getRows(); ++i) {
+        for (size_t j = 0; j < a.getCols(); ++j) {
+            diff = std::max(diff, std::abs(a(i, j) - b(i, j)));
+        }
+    }
+    return diff;
+}
+
 int main() {
     std::cout << "Neural Network Dense Layer Test\n";
     std::cout << "==============================\n\n";
@@ -87,6 +215,1211 @@ int main() {
     
     matrix::Matrix tanh_output = tanh_layer.forward(input);
     printMatrixDetails("Tanh output", tanh_output);
-    
-    return 0;
+
+    // Steady-state inference through the out-parameter API must not touch
+    // the heap once every buffer has grown to the batch size
+    std::cout << "Testing steady-state forward allocations:\n";
+    {
+        neural::DenseLayer hidden(64, 128, std::make_unique<neural::ReLU>());
+        neural::DenseLayer head(128, 10, std::make_unique<neural::Sigmoid>());
+        matrix::Matrix batch(32, 64, 0.25);
+        matrix::Matrix hidden_out;
+        matrix::Matrix head_out;
+
+        hidden.forward(batch, hidden_out);
+        head.forward(hidden_out, head_out);
+
+        size_t before = allocation_count.load();
+        for (int step = 0; step < 10; ++step) {
+            hidden.forward(batch, hidden_out);
+            head.forward(hidden_out, head_out);
+        }
+        size_t allocations = allocation_count.load() - before;
+        check(allocations == 0, "10 forward passes made " + std::to_string(allocations) + " allocations");
+
+        matrix::Matrix moved_from(4, 4, 1.0);
+        before = allocation_count.load();
+        matrix::Matrix moved_to(std::move(moved_from));
+        bool no_allocation = allocation_count.load() == before;
+        check(no_allocation && moved_from.getRows() == 0 && moved_to.get(3, 3) == 1.0,
+              "moving a matrix transfers its buffer");
+    }
+    std::cout << std::endl;
+
+    // Activations applied through strided views
+    std::cout << "Testing activations on matrix views:\n";
+    {
+        matrix::Matrix z(4, 6, -0.5);
+        z.set(1, 2, 0.75);
+        neural::ReLU view_relu;
+        matrix::MatrixView block = matrix::view(z).block(1, 1, 2, 3);
+        view_relu.applyTo(block, block);
+        check(z.get(1, 1) == 0.0 && z.get(1, 2) == 0.75 && z.get(0, 0) == -0.5 && z.get(3, 5) == -0.5,
+              "ReLU on a block only touches the block");
+
+        matrix::Matrix zt(3, 2, 0.0);
+        neural::Sigmoid view_sigmoid;
+        view_sigmoid.applyTo(matrix::view(z).colRange(0, 3).rowRange(0, 2).transposed(),
+                             matrix::view(zt));
+        check(std::abs(zt.get(2, 1) - 1.0 / (1.0 + std::exp(-0.75))) < 1e-15,
+              "Sigmoid from a transposed view");
+    }
+    std::cout << std::endl;
+
+    // A pruned layer computes the same output through sparse weights
+    std::cout << "Testing sparse (pruned) weights:\n";
+    {
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+        matrix::Matrix pruned(200, 150);
+        for (size_t i = 0; i < pruned.getRows(); ++i) {
+            for (double& w : pruned.row(i)) {
+                double value = dist(gen);
+                w = std::abs(value) > 0.9 ? value : 0.0;
+            }
+        }
+        matrix::Matrix sparse_biases(1, 150, 0.1);
+        matrix::Matrix batch(64, 200);
+        for (size_t i = 0; i < batch.getRows(); ++i) {
+            for (double& x : batch.row(i)) {
+                x = dist(gen);
+            }
+        }
+
+        neural::DenseLayer dense_layer(200, 150, pruned, sparse_biases, std::make_unique<neural::Tanh>());
+        neural::DenseLayer sparse_layer(200, 150, matrix::SparseMatrix::fromDense(pruned), sparse_biases,
+                                        std::make_unique<neural::Tanh>());
+        matrix::Matrix expected = dense_layer.forward(batch);
+        matrix::Matrix actual = sparse_layer.forward(batch);
+        double diff = 0.0;
+        for (size_t i = 0; i < expected.getRows(); ++i) {
+            for (size_t j = 0; j < expected.getCols(); ++j) {
+                diff = std::max(diff, std::abs(expected(i, j) - actual(i, j)));
+            }
+        }
+        check(sparse_layer.isSparse() && sparse_layer.getSparseWeights().density() < 0.15,
+              "sparse layer stores ~10% of the weights");
+        check(diff < 1e-12, "sparse forward matches dense forward");
+
+        matrix::SparseMatrix csc = matrix::SparseMatrix::fromDense(pruned, 0.0, matrix::SparseLayout::CSC);
+        matrix::Matrix rhs(150, 3, 0.5);
+        matrix::Matrix via_dense = pruned.multiply(rhs);
+        matrix::Matrix via_csr = matrix::SparseMatrix::fromDense(pruned).multiply(rhs);
+        matrix::Matrix via_csc = csc.multiply(rhs);
+        check(std::abs(via_csr(7, 2) - via_dense(7, 2)) < 1e-12 && std::abs(via_csc(7, 2) - via_dense(7, 2)) < 1e-12
+              && csc.toDense().get(5, 5) == pruned.get(5, 5),
+              "CSR and CSC sparse x dense match the dense product");
+
+        dense_layer.sparsify(0.0);
+        matrix::Matrix after = dense_layer.forward(batch);
+        check(dense_layer.isSparse() && dense_layer.getWeights().getRows() == 0
+              && std::abs(after(3, 4) - expected(3, 4)) < 1e-12,
+              "sparsify() converts a trained dense layer");
+    }
+    std::cout << std::endl;
+
+    // Per-request temporaries from an arena or pool instead of the heap
+    std::cout << "Testing arena and pool memory resources:\n";
+    {
+        neural::DenseLayer layer(64, 32, std::make_unique<neural::Tanh>());
+        neural::Sigmoid sigmoid;
+        matrix::Matrix batch(16, 64, 0.5);
+
+        auto request = [&] {
+            matrix::ArenaScope scope;
+            matrix::Matrix hidden = layer.forward(batch);
+            matrix::Matrix squashed = sigmoid.apply(hidden);
+            return squashed.get(0, 0);
+        };
+        double first = request();
+        size_t before = allocation_count.load();
+        double last = 0.0;
+        for (int step = 0; step < 10; ++step) {
+            last = request();
+        }
+        size_t allocations = allocation_count.load() - before;
+        check(allocations == 0 && last == first,
+              "10 arena-scoped requests made " + std::to_string(allocations) + " heap allocations");
+
+        matrix::PoolResource pool;
+        {
+            matrix::ScopedResource scope(&pool);
+            neural::DenseLayer pooled(64, 32, std::make_unique<neural::ReLU>());
+            for (int step = 0; step < 10; ++step) {
+                matrix::Matrix copy = pooled.forward(batch);
+            }
+        }
+        matrix::AllocatorStats stats = pool.stats();
+        check(stats.bytes_in_use == 0 && stats.peak_bytes > 0 && stats.bytes_reserved < 10 * stats.peak_bytes,
+              "a layer built under a pool recycles its buffers (peak " + std::to_string(stats.peak_bytes)
+              + " bytes, reserved " + std::to_string(stats.bytes_reserved) + ")");
+    }
+    std::cout << std::endl;
+
+    // Built-in activations run fused into the GEMM; custom ones fall back
+    std::cout << "Testing fused dense + bias + activation:\n";
+    {
+        // Same as ReLU but not the built-in class, so it takes the virtual path
+        class CustomReLU : public neural::ReLU {};
+
+        neural::DenseLayer reference(100, 60, std::make_unique<CustomReLU>());
+        neural::DenseLayer fused_layer(100, 60, reference.getWeights(), matrix::Matrix(1, 60, 0.05),
+                                       std::make_unique<neural::ReLU>());
+        neural::DenseLayer unfused_layer(100, 60, reference.getWeights(), matrix::Matrix(1, 60, 0.05),
+                                         std::make_unique<CustomReLU>());
+        matrix::Matrix batch(48, 100);
+        for (size_t i = 0; i < batch.getRows(); ++i) {
+            for (size_t j = 0; j < batch.getCols(); ++j) {
+                batch(i, j) = std::sin(0.1 * static_cast<double>(i * 100 + j));
+            }
+        }
+        matrix::Matrix fused_out = fused_layer.forward(batch);
+        matrix::Matrix unfused_out = unfused_layer.forward(batch);
+        bool same_output = true;
+        bool same_z = true;
+        for (size_t i = 0; i < batch.getRows(); ++i) {
+            for (size_t j = 0; j < 60; ++j) {
+                same_output = same_output && fused_out(i, j) == unfused_out(i, j);
+                same_z = same_z && fused_layer.getLastZ()(i, j) == unfused_layer.getLastZ()(i, j);
+            }
+        }
+        check(same_output && same_z, "fused ReLU layer matches the virtual path bitwise");
+
+        neural::DenseLayer inference_layer(100, 60, reference.getWeights(), matrix::Matrix(1, 60, 0.05),
+                                           std::make_unique<neural::ReLU>());
+        inference_layer.setTraining(false);
+        matrix::Matrix inference_out = inference_layer.forward(batch);
+        check(!inference_layer.isTraining() && inference_layer.getLastZ().getRows() == 0
+              && inference_layer.getLastInput().getRows() == 0 && inference_out(47, 59) == fused_out(47, 59),
+              "inference mode skips storing the input and pre-activation");
+    }
+    std::cout << std::endl;
+
+    // One layer instance serving several threads through const infer()
+    std::cout << "Testing concurrent stateless inference:\n";
+    {
+        class CustomTanh : public neural::Tanh {};
+        neural::DenseLayer fused_layer(80, 40, std::make_unique<neural::Sigmoid>());
+        neural::DenseLayer virtual_layer(80, 40, std::make_unique<CustomTanh>());
+        neural::DenseLayer sparse_layer(80, 40, std::make_unique<neural::ReLU>());
+        sparse_layer.sparsify(0.3);
+
+        std::vector<matrix::Matrix> batches;
+        for (int t = 0; t < 4; ++t) {
+            matrix::Matrix batch(24, 80);
+            for (size_t i = 0; i < batch.getRows(); ++i) {
+                for (size_t j = 0; j < batch.getCols(); ++j) {
+                    batch(i, j) = std::cos(0.01 * static_cast<double>((t + 1) * (i * 80 + j)));
+                }
+            }
+            batches.push_back(batch);
+        }
+
+        // Reference results computed serially through the stateful path
+        std::vector<neural::DenseLayer*> stateful = {&fused_layer, &virtual_layer, &sparse_layer};
+        std::vector<std::vector<matrix::Matrix>> expected(stateful.size());
+        for (size_t l = 0; l < stateful.size(); ++l) {
+            for (const matrix::Matrix& batch : batches) {
+                expected[l].push_back(stateful[l]->forward(batch));
+            }
+        }
+        std::vector<const neural::DenseLayer*> layers(stateful.begin(), stateful.end());
+        size_t cached_rows = fused_layer.getLastOutput().getRows();
+
+        std::atomic<int> mismatches{0};
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < batches.size(); ++t) {
+            threads.emplace_back([&, t] {
+                matrix::Matrix out;
+                for (int repeat = 0; repeat < 20; ++repeat) {
+                    for (size_t l = 0; l < layers.size(); ++l) {
+                        layers[l]->infer(batches[t], out);
+                        for (size_t i = 0; i < out.getRows(); ++i) {
+                            for (size_t j = 0; j < out.getCols(); ++j) {
+                                if (out(i, j) != expected[l][t](i, j)) {
+                                    ++mismatches;
+                                }
+                            }
+                        }
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        check(mismatches == 0, "4 threads sharing fused, virtual and sparse layers match forward()");
+        check(fused_layer.getLastOutput().getRows() == cached_rows
+              && fused_layer.infer(batches[0].multiply(matrix::Matrix(80, 80, 0.0))).get(0, 0) == 0.5,
+              "infer() leaves the cached state alone");
+    }
+    std::cout << std::endl;
+
+    // A Sequential model chains layers through preallocated buffers
+    std::cout << "Testing Sequential model:\n";
+    {
+        class CustomSigmoid : public neural::Sigmoid {};
+        neural::Sequential model(32);
+        model.add(neural::DenseLayer(20, 64, std::make_unique<neural::ReLU>()))
+             .add(neural::DenseLayer(64, 48, std::make_unique<CustomSigmoid>()))
+             .add(neural::DenseLayer(48, 10, std::make_unique<neural::Tanh>()));
+
+        matrix::Matrix batch(32, 20);
+        for (size_t i = 0; i < batch.getRows(); ++i) {
+            for (size_t j = 0; j < batch.getCols(); ++j) {
+                batch(i, j) = std::sin(0.37 * static_cast<double>(i + 3 * j));
+            }
+        }
+        matrix::Matrix by_hand = batch;
+        for (size_t l = 0; l < model.size(); ++l) {
+            by_hand = model.layer(l).forward(by_hand);
+        }
+
+        matrix::Matrix output;
+        model.forward(batch, output);
+        bool same = output.getRows() == 32 && output.getCols() == 10;
+        for (size_t i = 0; same && i < output.getRows(); ++i) {
+            for (size_t j = 0; j < output.getCols(); ++j) {
+                same = same && output(i, j) == by_hand(i, j);
+            }
+        }
+        check(same, "3-layer model matches chaining the layers by hand");
+
+        matrix::Matrix small_batch(5, 20, 0.1);
+        model.forward(small_batch, output);
+        size_t before = allocation_count.load();
+        for (int step = 0; step < 10; ++step) {
+            model.forward(batch, output);
+            model.forward(small_batch, output);
+        }
+        size_t allocations = allocation_count.load() - before;
+        check(allocations == 0, "20 model forward passes made " + std::to_string(allocations) + " allocations");
+
+        bool threw_batch = false;
+        try {
+            model.forward(matrix::Matrix(33, 20));
+        } catch (const std::invalid_argument&) {
+            threw_batch = true;
+        }
+        bool threw_shape = false;
+        try {
+            model.add(neural::DenseLayer(11, 4, std::make_unique<neural::ReLU>()));
+        } catch (const std::invalid_argument&) {
+            threw_shape = true;
+        }
+        check(threw_batch && threw_shape && model.size() == 3, "oversized batches and mismatched layers are rejected");
+    }
+    std::cout << std::endl;
+
+    // Backpropagation against finite differences, then training
+    std::cout << "Testing backpropagation and training:\n";
+    {
+        neural::DenseLayer layer(6, 4, std::make_unique<neural::Tanh>());
+        matrix::Matrix x(5, 6);
+        matrix::Matrix y(5, 4);
+        for (size_t i = 0; i < 5; ++i) {
+            for (size_t j = 0; j < 6; ++j) {
+                x(i, j) = std::sin(1.3 * static_cast<double>(i * 6 + j));
+            }
+            for (size_t j = 0; j < 4; ++j) {
+                y(i, j) = std::cos(0.7 * static_cast<double>(i + j));
+            }
+        }
+        neural::MeanSquaredError mse;
+        matrix::Matrix input_grad = layer.backward(mse.gradient(layer.forward(x), y));
+
+        // Central differences on a few weights and inputs
+        const double h = 1e-6;
+        double worst = 0.0;
+        std::vector<neural::Parameter> params = layer.parameters();
+        for (auto [i, j] : {std::pair<size_t, size_t>{0, 0}, {3, 2}, {5, 3}}) {
+            double saved = (*params[0].value)(i, j);
+            (*params[0].value)(i, j) = saved + h;
+            double up = mse.value(layer.infer(x), y);
+            (*params[0].value)(i, j) = saved - h;
+            double down = mse.value(layer.infer(x), y);
+            (*params[0].value)(i, j) = saved;
+            worst = std::max(worst, std::abs((up - down) / (2 * h) - (*params[0].grad)(i, j)));
+        }
+        for (auto [i, j] : {std::pair<size_t, size_t>{0, 1}, {4, 5}}) {
+            matrix::Matrix shifted = x;
+            shifted(i, j) += h;
+            double up = mse.value(layer.infer(shifted), y);
+            shifted(i, j) -= 2 * h;
+            double down = mse.value(layer.infer(shifted), y);
+            worst = std::max(worst, std::abs((up - down) / (2 * h) - input_grad(i, j)));
+        }
+        double bias_numeric;
+        {
+            double saved = (*params[1].value)(0, 2);
+            (*params[1].value)(0, 2) = saved + h;
+            double up = mse.value(layer.infer(x), y);
+            (*params[1].value)(0, 2) = saved - h;
+            double down = mse.value(layer.infer(x), y);
+            (*params[1].value)(0, 2) = saved;
+            bias_numeric = (up - down) / (2 * h);
+        }
+        worst = std::max(worst, std::abs(bias_numeric - (*params[1].grad)(0, 2)));
+        check(worst < 1e-8, "weight, bias and input gradients match finite differences");
+
+        // A small regression problem: y = sin(x0) * x1 + 0.5
+        matrix::Matrix inputs(256, 2);
+        matrix::Matrix targets(256, 1);
+        std::mt19937 gen(7);
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+        for (size_t i = 0; i < 256; ++i) {
+            inputs(i, 0) = dist(gen);
+            inputs(i, 1) = dist(gen);
+            targets(i, 0) = std::sin(2.0 * inputs(i, 0)) * inputs(i, 1) * 0.4 + 0.5;
+        }
+        // Xavier-uniform weights from a fixed seed, so the convergence
+        // checks below are deterministic
+        auto buildModel = [] {
+            std::mt19937 init(11);
+            auto seededLayer = [&](size_t in, size_t out, neural::ActivationFunction activation) {
+                std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+                double scale = std::sqrt(6.0 / static_cast<double>(in + out));
+                matrix::Matrix weights(in, out);
+                for (size_t i = 0; i < in; ++i) {
+                    for (double& w : weights.row(i)) {
+                        w = uniform(init) * scale;
+                    }
+                }
+                return neural::DenseLayer(in, out, weights, matrix::Matrix(1, out, 0.0), std::move(activation));
+            };
+            neural::Sequential model(256);
+            model.add(seededLayer(2, 32, std::make_unique<neural::Tanh>()))
+                 .add(seededLayer(32, 1, std::make_unique<neural::Sigmoid>()));
+            return model;
+        };
+
+        neural::TrainingOptions options;
+        options.batch_size = 64;
+        options.epochs = 150;
+        for (int which = 0; which < 2; ++which) {
+            neural::Sequential model = buildModel();
+            neural::Adam adam(0.01);
+            neural::SGD sgd(0.5, 0.9);
+            neural::Optimizer& optimizer = which == 0 ? static_cast<neural::Optimizer&>(adam) : sgd;
+            neural::Trainer trainer(model, mse, optimizer, options);
+            std::vector<double> history = trainer.fit(inputs, targets);
+            check(history.back() < 0.1 * history.front(),
+                  std::string(which == 0 ? "Adam" : "SGD with momentum") + " reduces the loss from "
+                  + std::to_string(history.front()) + " to " + std::to_string(history.back()));
+        }
+
+        // Data-parallel steps agree with serial ones up to summation order
+        neural::Sequential serial_model = buildModel();
+        neural::Sequential parallel_model = buildModel();
+        for (size_t l = 0; l < 2; ++l) {
+            std::vector<neural::Parameter> from = serial_model.layer(l).parameters();
+            std::vector<neural::Parameter> to = parallel_model.layer(l).parameters();
+            *to[0].value = *from[0].value;
+        }
+        neural::SGD serial_sgd(0.1);
+        neural::SGD parallel_sgd(0.1);
+        neural::Trainer serial_trainer(serial_model, mse, serial_sgd);
+        neural::Trainer parallel_trainer(parallel_model, mse, parallel_sgd);
+        size_t saved_threads = matrix::getNumThreads();
+        for (int step = 0; step < 5; ++step) {
+            matrix::setNumThreads(1);
+            serial_trainer.step(inputs, targets);
+            matrix::setNumThreads(4);
+            parallel_trainer.step(inputs, targets);
+        }
+        matrix::setNumThreads(saved_threads);
+        double drift = 0.0;
+        const matrix::Matrix& ws = serial_model.layer(0).getWeights();
+        const matrix::Matrix& wp = parallel_model.layer(0).getWeights();
+        for (size_t i = 0; i < ws.getRows(); ++i) {
+            for (size_t j = 0; j < ws.getCols(); ++j) {
+                drift = std::max(drift, std::abs(ws(i, j) - wp(i, j)));
+            }
+        }
+        check(drift < 1e-12, "4-shard training matches serial training (drift " + std::to_string(drift) + ")");
+
+        // Lock-free Hogwild updates from 4 workers still converge
+        neural::TrainingOptions hogwild_options = options;
+        hogwild_options.batch_size = 16;
+        hogwild_options.epochs = 60;
+        hogwild_options.reduction = neural::GradientReduction::Hogwild;
+        neural::Sequential hogwild_model = buildModel();
+        neural::SGD hogwild_sgd(0.5);
+        neural::Trainer hogwild_trainer(hogwild_model, mse, hogwild_sgd, hogwild_options);
+        matrix::setNumThreads(4);
+        std::vector<double> hogwild_history = hogwild_trainer.fit(inputs, targets);
+        matrix::setNumThreads(saved_threads);
+        check(hogwild_history.back() < 0.1 * hogwild_history.front(),
+              "Hogwild training reduces the loss from " + std::to_string(hogwild_history.front()) + " to "
+              + std::to_string(hogwild_history.back()));
+
+        bool threw = false;
+        try {
+            neural::Adam adam;
+            neural::Trainer invalid(hogwild_model, mse, adam, hogwild_options);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "Hogwild rejects stateful optimizers");
+    }
+    std::cout << std::endl;
+
+    // Save a model, then load it mapped and copied
+    std::cout << "Testing model save and load:\n";
+    {
+        std::string path = (std::filesystem::temp_directory_path() / "neural_test_model.bin").string();
+        neural::Sequential model(16);
+        model.add(neural::DenseLayer(30, 70, std::make_unique<neural::ReLU>()))
+             .add(neural::DenseLayer(70, 20, std::make_unique<neural::Tanh>()))
+             .add(neural::DenseLayer(20, 3, std::make_unique<neural::Sigmoid>()));
+        model.layer(1).sparsify(0.2);
+        neural::saveModel(path, model);
+
+        matrix::Matrix batch(16, 30);
+        for (size_t i = 0; i < batch.getRows(); ++i) {
+            for (size_t j = 0; j < batch.getCols(); ++j) {
+                batch(i, j) = std::sin(0.05 * static_cast<double>(i * 30 + j));
+            }
+        }
+        matrix::Matrix expected = model.forward(batch);
+
+        auto sameAs = [&](neural::Sequential& other) {
+            matrix::Matrix actual = other.forward(batch);
+            bool same = actual.getRows() == expected.getRows() && actual.getCols() == expected.getCols();
+            for (size_t i = 0; same && i < actual.getRows(); ++i) {
+                for (size_t j = 0; j < actual.getCols(); ++j) {
+                    same = same && std::abs(actual(i, j) - expected(i, j)) < 1e-14;
+                }
+            }
+            return same;
+        };
+
+        neural::Sequential mapped = neural::loadModel(path);
+        check(mapped.size() == 3 && mapped.layer(0).isMapped() && mapped.layer(0).getWeights().getRows() == 0
+              && sameAs(mapped), "mapped model reproduces the saved one");
+
+        neural::ModelLoadOptions copy_options;
+        copy_options.map_weights = false;
+        neural::Sequential copied = neural::loadModel(path, copy_options);
+        check(!copied.layer(0).isMapped() && sameAs(copied), "copied model reproduces the saved one");
+
+        // Training a mapped model first copies its weights into memory
+        double first_weight = mapped.layer(0).getWeightsView()(0, 0);
+        mapped.layer(0).parameters();
+        check(!mapped.layer(0).isMapped() && mapped.layer(0).getWeights()(0, 0) == first_weight,
+              "training a mapped layer materializes its weights");
+
+        // Flip one weight byte: the checksum catches it
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekg(-9, std::ios::end);
+            char byte = 0;
+            file.read(&byte, 1);
+            file.seekp(-9, std::ios::end);
+            byte ^= 0x10;
+            file.write(&byte, 1);
+        }
+        bool threw = false;
+        try {
+            neural::loadModel(path);
+        } catch (const matrix::MatrixFileError&) {
+            threw = true;
+        }
+        neural::ModelLoadOptions trusting;
+        trusting.verify_checksum = false;
+        check(threw && neural::loadModel(path, trusting).size() == 3,
+              "a corrupted file fails the checksum unless verification is off");
+        std::filesystem::remove(path);
+
+        // Row-wise and parameterized activations round-trip too
+        neural::Sequential heads(16);
+        heads.add(neural::DenseLayer(30, 12, std::make_unique<neural::LeakyReLU>(0.2)))
+             .add(neural::DenseLayer(12, 8, std::make_unique<neural::LogSoftmax>()))
+             .add(neural::DenseLayer(8, 4, std::make_unique<neural::Softmax>()));
+        neural::saveModel(path, heads);
+        neural::Sequential loaded_heads = neural::loadModel(path);
+        const auto* leaky = dynamic_cast<const neural::LeakyReLU*>(&loaded_heads.layer(0).getActivation());
+        check(leaky && leaky->getAlpha() == 0.2
+              && typeid(loaded_heads.layer(1).getActivation()) == typeid(neural::LogSoftmax)
+              && typeid(loaded_heads.layer(2).getActivation()) == typeid(neural::Softmax),
+              "LeakyReLU (with alpha), LogSoftmax and Softmax are saved");
+        check(maxDiff(loaded_heads.forward(batch), heads.forward(batch)) == 0.0,
+              "loaded classifier heads reproduce the saved model");
+        std::filesystem::remove(path);
+
+        class CustomTanh : public neural::Tanh {};
+        neural::Sequential custom(4);
+        custom.add(neural::DenseLayer(2, 2, std::make_unique<CustomTanh>()));
+        bool rejected = false;
+        try {
+            neural::saveModel(path, custom);
+        } catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        check(rejected, "custom activations are refused");
+        std::filesystem::remove(path);
+    }
+    std::cout << std::endl;
+
+    // Row-wise and new element-wise activations
+    std::cout << "Testing Softmax, LogSoftmax, GELU and LeakyReLU:\n";
+    {
+        matrix::Matrix z(5, 11);
+        matrix::Matrix g(5, 11);
+        for (size_t i = 0; i < z.getRows(); ++i) {
+            for (size_t j = 0; j < z.getCols(); ++j) {
+                z(i, j) = 3.0 * std::sin(0.7 * static_cast<double>(i * 11 + j) + 0.2);
+                g(i, j) = std::cos(0.3 * static_cast<double>(i * 11 + j));
+            }
+        }
+
+        neural::Softmax softmax;
+        neural::LogSoftmax log_softmax;
+        neural::GELU gelu;
+        neural::LeakyReLU leaky(0.1);
+        const std::pair<const neural::Activation*, const char*> activations[] = {
+            {&softmax, "Softmax"}, {&log_softmax, "LogSoftmax"}, {&gelu, "GELU"}, {&leaky, "LeakyReLU"}};
+        for (auto [activation, name] : activations) {
+            // L = sum(g * f(z)); backward() must give dL/dz
+            matrix::Matrix grad;
+            activation->backward(z, g, grad);
+            auto loss = [&](const matrix::Matrix& at) {
+                matrix::Matrix y = activation->apply(at);
+                double total = 0.0;
+                for (size_t i = 0; i < y.getRows(); ++i) {
+                    for (size_t j = 0; j < y.getCols(); ++j) {
+                        total += g(i, j) * y(i, j);
+                    }
+                }
+                return total;
+            };
+            double worst = 0.0;
+            const double h = 1e-6;
+            for (size_t i = 0; i < z.getRows(); ++i) {
+                for (size_t j = 0; j < z.getCols(); ++j) {
+                    matrix::Matrix zp = z;
+                    matrix::Matrix zm = z;
+                    zp(i, j) += h;
+                    zm(i, j) -= h;
+                    worst = std::max(worst, std::abs((loss(zp) - loss(zm)) / (2 * h) - grad(i, j)));
+                }
+            }
+            check(worst < 1e-7, std::string(name) + " backward matches finite differences");
+        }
+        check(softmax.kind() == neural::ActivationKind::RowWise && gelu.kind() == neural::ActivationKind::ElementWise,
+              "activations report their kind");
+
+        // Logits far beyond exp's range still give a distribution
+        matrix::Matrix logits(2, 3);
+        logits(0, 0) = 1e4;  logits(0, 1) = 1e4 - 1.0;  logits(0, 2) = -1e4;
+        logits(1, 0) = -1e4; logits(1, 1) = -1e4;       logits(1, 2) = -1e4;
+        matrix::Matrix p = softmax.apply(logits);
+        matrix::Matrix logp = log_softmax.apply(logits);
+        check(std::abs(p(0, 0) + p(0, 1) + p(0, 2) - 1.0) < 1e-15 && std::abs(p(1, 0) - 1.0 / 3) < 1e-15
+              && std::abs(p(0, 1) / p(0, 0) - std::exp(-1.0)) < 1e-14 && p(0, 2) < 1e-300,
+              "softmax is stable for huge logits");
+        check(std::abs(logp(0, 2) + 2e4 + std::log(1.0 + std::exp(-1.0))) < 1e-9 && std::isfinite(logp(0, 2)),
+              "log-softmax stays finite where softmax underflows");
+
+        bool threw = false;
+        try {
+            softmax.derivative(z);
+        } catch (const std::logic_error&) {
+            threw = true;
+        }
+        check(threw, "row-wise activations have no element-wise derivative");
+
+        // GELU runs fused in the GEMM epilogue; Softmax runs after it
+        matrix::Matrix weights(11, 4);
+        matrix::Matrix biases(1, 4);
+        for (size_t j = 0; j < 4; ++j) {
+            biases(0, j) = 0.1 * static_cast<double>(j);
+            for (size_t i = 0; i < 11; ++i) {
+                weights(i, j) = std::sin(static_cast<double>(i + 3 * j));
+            }
+        }
+        matrix::Matrix affine = z.multiply(weights);
+        for (size_t i = 0; i < affine.getRows(); ++i) {
+            for (size_t j = 0; j < 4; ++j) {
+                affine(i, j) += biases(0, j);
+            }
+        }
+        for (auto [activation, name] : {std::pair<const neural::Activation*, const char*>{&gelu, "GELU"},
+                                        {&softmax, "Softmax"}}) {
+            std::unique_ptr<neural::Activation> owned;
+            if (activation == &gelu) {
+                owned = std::make_unique<neural::GELU>();
+            } else {
+                owned = std::make_unique<neural::Softmax>();
+            }
+            neural::DenseLayer layer(11, 4, weights, biases, std::move(owned));
+            matrix::Matrix expected = activation->apply(affine);
+            matrix::Matrix actual = layer.infer(z);
+            double diff = 0.0;
+            for (size_t i = 0; i < actual.getRows(); ++i) {
+                for (size_t j = 0; j < 4; ++j) {
+                    diff = std::max(diff, std::abs(actual(i, j) - expected(i, j)));
+                }
+            }
+            check(diff < 1e-14, std::string(name) + " dense layer matches the activation applied to X * W + b");
+        }
+    }
+    std::cout << std::endl;
+
+    // Built-in activations are held by value and dispatched statically;
+    // anything else goes through the virtual interface
+    std::cout << "Testing activation dispatch:\n";
+    {
+        class DoubledTanh : public neural::Tanh {
+        public:
+            void applyInto(const matrix::Matrix& input, matrix::Matrix& output) const override {
+                neural::Tanh::applyInto(input, output);
+                for (size_t i = 0; i < output.getRows(); ++i) {
+                    for (double& v : output.row(i)) {
+                        v *= 2.0;
+                    }
+                }
+            }
+        };
+
+        matrix::Matrix weights(3, 2);
+        weights(0, 0) = 1.0;  weights(0, 1) = -1.0;
+        weights(1, 0) = 0.5;  weights(1, 1) = 2.0;
+        weights(2, 0) = -2.0; weights(2, 1) = 0.25;
+        matrix::Matrix biases(1, 2, 0.1);
+        matrix::Matrix input(2, 3);
+        input(0, 0) = 1.0; input(0, 1) = 2.0;  input(0, 2) = 3.0;
+        input(1, 0) = 0.5; input(1, 1) = -1.0; input(1, 2) = 0.0;
+        matrix::Matrix z = input.multiply(weights);
+        for (size_t i = 0; i < 2; ++i) {
+            for (size_t j = 0; j < 2; ++j) {
+                z(i, j) += 0.1;
+            }
+        }
+
+        neural::DenseLayer by_value(3, 2, weights, biases, neural::LeakyReLU(0.2));
+        neural::DenseLayer by_pointer(3, 2, weights, biases, std::make_unique<neural::LeakyReLU>(0.2));
+        neural::DenseLayer custom(3, 2, weights, biases, std::make_unique<DoubledTanh>());
+        check(by_value.hasBuiltinActivation() && by_pointer.hasBuiltinActivation() && !custom.hasBuiltinActivation(),
+              "built-ins are unwrapped, subclasses stay polymorphic");
+        check(dynamic_cast<const neural::LeakyReLU&>(by_pointer.getActivation()).getAlpha() == 0.2,
+              "unwrapping keeps the activation's parameters");
+
+        matrix::Matrix leaky = by_value.infer(input);
+        matrix::Matrix doubled = custom.infer(input);
+        bool match = true;
+        for (size_t i = 0; i < 2; ++i) {
+            for (size_t j = 0; j < 2; ++j) {
+                double v = z(i, j);
+                match = match && std::abs(leaky(i, j) - (v > 0 ? v : 0.2 * v)) < 1e-15
+                        && std::abs(doubled(i, j) - 2.0 * std::tanh(v)) < 1e-15;
+            }
+        }
+        check(match, "static and virtual dispatch give the expected outputs");
+    }
+    std::cout << std::endl;
+
+    // Convolution and pooling against direct reference loops
+    std::cout << "Testing convolution and pooling layers:\n";
+    {
+        auto fill = [](size_t rows, size_t cols, double phase) {
+            matrix::Matrix m(rows, cols);
+            for (size_t i = 0; i < rows; ++i) {
+                for (size_t j = 0; j < cols; ++j) {
+                    m(i, j) = std::sin(phase + 0.37 * static_cast<double>(i * cols + j));
+                }
+            }
+            return m;
+        };
+
+        struct Case {
+            neural::ImageShape in;
+            size_t out_channels, kh, kw, stride, pad;
+        };
+        const Case cases[] = {
+            {{9, 7, 5}, 6, 3, 3, 1, 1},
+            {{8, 8, 16}, 12, 3, 3, 1, 0},
+            {{10, 9, 3}, 4, 3, 3, 2, 1},
+            {{6, 11, 2}, 3, 2, 5, 1, 2},
+        };
+        for (const Case& c : cases) {
+            matrix::Matrix input = fill(3, c.in.size(), 0.1);
+            matrix::Matrix weights = fill(c.kh * c.kw * c.in.channels, c.out_channels, 0.7);
+            matrix::Matrix biases = fill(1, c.out_channels, 1.3);
+            matrix::Matrix expected = referenceConv(input, c.in, c.out_channels, c.kh, c.kw, c.stride, c.pad,
+                                                    weights, biases);
+            std::string name = std::to_string(c.in.height) + "x" + std::to_string(c.in.width) + "x"
+                               + std::to_string(c.in.channels) + " " + std::to_string(c.kh) + "x"
+                               + std::to_string(c.kw) + "/" + std::to_string(c.stride);
+
+            std::vector<neural::ConvAlgorithm> algorithms = {neural::ConvAlgorithm::Im2col};
+            if (c.kh == 3 && c.kw == 3 && c.stride == 1) {
+                algorithms.push_back(neural::ConvAlgorithm::Winograd);
+            }
+            for (neural::ConvAlgorithm algorithm : algorithms) {
+                for (neural::TensorLayout layout : {neural::TensorLayout::NHWC, neural::TensorLayout::NCHW}) {
+                    neural::ConvOptions options;
+                    options.stride = c.stride;
+                    options.padding = c.pad;
+                    options.layout = layout;
+                    options.algorithm = algorithm;
+                    neural::Conv2D conv(c.in, c.out_channels, c.kh, c.kw, weights, biases,
+                                        std::make_unique<neural::ReLU>(), options);
+                    bool nchw = layout == neural::TensorLayout::NCHW;
+                    matrix::Matrix want = expected;
+                    for (size_t i = 0; i < want.getRows(); ++i) {
+                        for (double& v : want.row(i)) {
+                            v = std::max(v, 0.0);
+                        }
+                    }
+                    if (nchw) {
+                        want = toNCHW(want, conv.getOutputShape());
+                    }
+                    matrix::Matrix got = conv.infer(nchw ? toNCHW(input, c.in) : input);
+                    check(maxDiff(got, want) < 1e-12,
+                          std::string(algorithm == neural::ConvAlgorithm::Winograd ? "Winograd" : "im2col")
+                          + (nchw ? " NCHW " : " NHWC ") + name + " matches direct convolution");
+                }
+            }
+        }
+
+        neural::ConvOptions auto_options;
+        auto_options.padding = 1;
+        neural::Conv2D wide({8, 8, 16}, 16, 3, 3, std::make_unique<neural::ReLU>(), auto_options);
+        neural::Conv2D narrow({8, 8, 3}, 16, 3, 3, std::make_unique<neural::ReLU>(), auto_options);
+        check(wide.usesWinograd() && !narrow.usesWinograd() && wide.getOutputShape() == neural::ImageShape{8, 8, 16},
+              "Auto picks Winograd for 3x3 layers with enough channels");
+
+        bool threw = false;
+        try {
+            neural::ConvOptions strided;
+            strided.stride = 2;
+            strided.algorithm = neural::ConvAlgorithm::Winograd;
+            neural::Conv2D invalid({8, 8, 4}, 4, 3, 3, std::make_unique<neural::ReLU>(), strided);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "Winograd rejects strided convolutions");
+
+        // Conv1D is a Conv2D over {1, length, channels}
+        {
+            neural::ConvOptions options;
+            options.padding = 1;
+            matrix::Matrix weights = fill(3 * 4, 5, 0.2);
+            matrix::Matrix biases = fill(1, 5, 0.4);
+            matrix::Matrix input = fill(2, 20 * 4, 0.9);
+            neural::Conv1D conv(20, 4, 5, 3, weights, biases, std::make_unique<neural::Tanh>(), options);
+            // Conv1D pads the length only, so the reference is written out here
+            matrix::Matrix length_padded(2, 20 * 5);
+            for (size_t n = 0; n < 2; ++n) {
+                for (size_t x = 0; x < 20; ++x) {
+                    for (size_t k = 0; k < 5; ++k) {
+                        double sum = biases(0, k);
+                        for (size_t t = 0; t < 3; ++t) {
+                            long ix = static_cast<long>(x + t) - 1;
+                            if (ix < 0 || ix >= 20) {
+                                continue;
+                            }
+                            for (size_t ch = 0; ch < 4; ++ch) {
+                                sum += weights(t * 4 + ch, k) * input(n, ix * 4 + ch);
+                            }
+                        }
+                        length_padded(n, x * 5 + k) = std::tanh(sum);
+                    }
+                }
+            }
+            check(conv.getOutputLength() == 20 && maxDiff(conv.infer(input), length_padded) < 1e-12,
+                  "Conv1D matches direct convolution");
+        }
+
+        // Pooling, with and without padding, in both layouts
+        neural::ImageShape shape{7, 6, 3};
+        matrix::Matrix input = fill(2, shape.size(), 0.5);
+        for (neural::TensorLayout layout : {neural::TensorLayout::NHWC, neural::TensorLayout::NCHW}) {
+            neural::PoolOptions options;
+            options.layout = layout;
+            options.stride = 2;
+            options.padding = 1;
+            neural::MaxPool2D max_pool(shape, 3, 3, options);
+            neural::AvgPool2D avg_pool(shape, 3, 3, options);
+            bool nchw = layout == neural::TensorLayout::NCHW;
+            matrix::Matrix in = nchw ? toNCHW(input, shape) : input;
+            matrix::Matrix max_out = max_pool.infer(in);
+            matrix::Matrix avg_out = avg_pool.infer(in);
+            neural::ImageShape out_shape = max_pool.getOutputShape();
+            bool same = out_shape == neural::ImageShape{4, 3, 3};
+            for (size_t n = 0; same && n < 2; ++n) {
+                for (size_t oy = 0; oy < out_shape.height; ++oy) {
+                    for (size_t ox = 0; ox < out_shape.width; ++ox) {
+                        for (size_t c = 0; c < shape.channels; ++c) {
+                            double max = -1e300;
+                            double sum = 0.0;
+                            int count = 0;
+                            for (long y = 2 * long(oy) - 1; y < 2 * long(oy) + 2; ++y) {
+                                for (long x = 2 * long(ox) - 1; x < 2 * long(ox) + 2; ++x) {
+                                    if (y < 0 || x < 0 || y >= 7 || x >= 6) {
+                                        continue;
+                                    }
+                                    double v = input(n, shape.index(neural::TensorLayout::NHWC, y, x, c));
+                                    max = std::max(max, v);
+                                    sum += v;
+                                    ++count;
+                                }
+                            }
+                            size_t at = out_shape.index(layout, oy, ox, c);
+                            same = same && max_out(n, at) == max && std::abs(avg_out(n, at) - sum / count) < 1e-15;
+                        }
+                    }
+                }
+            }
+            check(same, std::string(nchw ? "NCHW" : "NHWC") + " max and average pooling match the reference");
+        }
+
+        // A small CNN: conv -> pool -> dense, chained through flattened rows
+        neural::ConvOptions same_padding;
+        same_padding.padding = 1;
+        neural::Conv2D conv({8, 8, 3}, 8, 3, 3, std::make_unique<neural::ReLU>(), same_padding);
+        neural::MaxPool2D pool(conv.getOutputShape(), 2, 2);
+        neural::DenseLayer head(pool.getOutputSize(), 10, std::make_unique<neural::Softmax>());
+        matrix::Matrix logits = head.infer(pool.infer(conv.infer(fill(4, 8 * 8 * 3, 0.0))));
+        double total = 0.0;
+        for (double v : logits.row(0)) {
+            total += v;
+        }
+        check(logits.getRows() == 4 && logits.getCols() == 10 && std::abs(total - 1.0) < 1e-12,
+              "conv, pool and dense layers chain on flattened rows");
+    }
+    std::cout << std::endl;
+
+    // Compile models into frozen inference plans
+    std::cout << "Testing inference plans:\n";
+    {
+        auto fill = [](size_t rows, size_t cols, double phase) {
+            matrix::Matrix m(rows, cols);
+            for (size_t i = 0; i < rows; ++i) {
+                for (size_t j = 0; j < cols; ++j) {
+                    m(i, j) = std::sin(phase + 0.61 * static_cast<double>(i * cols + j));
+                }
+            }
+            return m;
+        };
+        matrix::Matrix sample = fill(32, 16, 0.3);
+        matrix::Matrix input = fill(7, 16, 1.1);
+
+        auto plan = [&] {
+            // 16 -> 64 -> 8 folds (128 <= 1024 + 512 multiply-adds per row),
+            // as do 32 -> 32 -> 4; the ReLU and Tanh layers stay separate
+            neural::Sequential model(32);
+            model.add(neural::DenseLayer(16, 64, fill(16, 64, 0.1), fill(1, 64, 0.2), neural::Identity()));
+            model.add(neural::DenseLayer(64, 8, fill(64, 8, 0.3), fill(1, 8, 0.4), neural::Tanh()));
+            model.add(neural::DenseLayer(8, 32, fill(8, 32, 0.5), fill(1, 32, 0.6), neural::ReLU()));
+            model.add(neural::DenseLayer(32, 32, fill(32, 32, 0.7), fill(1, 32, 0.8), neural::Identity()));
+            model.add(neural::DenseLayer(32, 4, fill(32, 4, 0.9), fill(1, 4, 1.0), neural::Softmax()));
+            neural::InferencePlan compiled = neural::InferencePlan::compile(model, sample);
+            check(maxDiff(compiled.infer(input), model.forward(input)) < 1e-12,
+                  "compiled plan matches the layer-by-layer forward pass");
+            return compiled;
+        }();
+        // The plan owns its weights and outlives the model
+        check(plan.size() == 3 && plan.step(0).layer_count == 2 && plan.step(1).first_layer == 2
+              && plan.step(2).layer_count == 2 && plan.getInputSize() == 16 && plan.getOutputSize() == 4,
+              "linear layers fold into their successors");
+        check(plan.step(0).fused == matrix::EpilogueActivation::Tanh
+              && plan.step(1).fused == matrix::EpilogueActivation::ReLU
+              && plan.step(2).fused == matrix::EpilogueActivation::None,
+              "built-in element-wise activations run in the epilogue");
+        check(plan.step(0).kernel == neural::PlanKernel::Dense && plan.step(0).seconds[0] > 0.0,
+              "dense steps are benchmarked");
+
+        // A bottleneck would get more expensive folded, so it is kept
+        neural::Sequential bottleneck(8);
+        bottleneck.add(neural::DenseLayer(64, 4, fill(64, 4, 0.1), fill(1, 4, 0.2), neural::Identity()));
+        bottleneck.add(neural::DenseLayer(4, 64, fill(4, 64, 0.3), fill(1, 64, 0.4), neural::GELU()));
+        neural::InferencePlan kept = neural::InferencePlan::compile(bottleneck, matrix::Matrix(0, 64));
+        matrix::Matrix wide = fill(5, 64, 0.7);
+        check(kept.size() == 2 && maxDiff(kept.infer(wide), bottleneck.forward(wide)) < 1e-12,
+              "folding that adds work is skipped");
+
+        // Pruned weights get a sparse candidate; whichever wins is exact
+        neural::Sequential pruned(32);
+        pruned.add(neural::DenseLayer(16, 256, fill(16, 256, 0.2), fill(1, 256, 0.3), neural::ReLU()));
+        pruned.add(neural::DenseLayer(256, 10, fill(256, 10, 0.4), fill(1, 10, 0.5), neural::Sigmoid()));
+        pruned.layer(0).sparsify(0.95);
+        neural::InferencePlan sparse_plan = neural::InferencePlan::compile(pruned, sample);
+        check(sparse_plan.step(0).seconds[static_cast<size_t>(neural::PlanKernel::Sparse)] > 0.0
+              && sparse_plan.step(1).seconds[static_cast<size_t>(neural::PlanKernel::Sparse)] == 0.0,
+              "sparse weights are benchmarked only for sparse enough steps");
+        check(maxDiff(sparse_plan.infer(input), pruned.forward(input)) < 1e-12,
+              "sparse-capable plan matches the model");
+        neural::PlanOptions dense_only;
+        dense_only.allow_sparse = false;
+        check(neural::InferencePlan::compile(pruned, sample, dense_only).step(0).kernel == neural::PlanKernel::Dense,
+              "sparse kernels can be disabled");
+
+        // int8 is opt-in; a quantized model stays int8 and bit-identical
+        neural::PlanOptions int8;
+        int8.allow_quantized = true;
+        neural::InferencePlan int8_plan = neural::InferencePlan::compile(pruned, sample, int8);
+        matrix::Matrix reference = pruned.forward(input);
+        check(int8_plan.step(1).seconds[static_cast<size_t>(neural::PlanKernel::Quantized)] > 0.0
+              && maxDiff(int8_plan.infer(input), reference) < 0.05,
+              "int8 candidates are benchmarked when allowed");
+        neural::Sequential quantized(32);
+        quantized.add(neural::DenseLayer(16, 24, fill(16, 24, 0.6), fill(1, 24, 0.7), neural::ReLU()));
+        quantized.add(neural::DenseLayer(24, 3, fill(24, 3, 0.8), fill(1, 3, 0.9), neural::Identity()));
+        quantized.quantize(sample);
+        neural::InferencePlan quantized_plan = neural::InferencePlan::compile(quantized, sample);
+        check(quantized_plan.step(0).kernel == neural::PlanKernel::Quantized
+              && quantized_plan.step(1).kernel == neural::PlanKernel::Quantized
+              && maxDiff(quantized_plan.infer(input), quantized.forward(input)) == 0.0,
+              "quantized layers keep their int8 weights");
+
+        // Identity layers round-trip through a model file
+        std::string path = (std::filesystem::temp_directory_path() / "dione_identity_model.bin").string();
+        neural::saveModel(path, bottleneck);
+        check(maxDiff(neural::loadModel(path).forward(wide), bottleneck.forward(wide)) == 0.0,
+              "Identity activations are saved and loaded");
+        std::filesystem::remove(path);
+
+        bool threw = false;
+        try {
+            class CustomReLU : public neural::ReLU {};
+            neural::Sequential custom(4);
+            custom.add(neural::DenseLayer(3, 2, std::make_unique<CustomReLU>()));
+            neural::InferencePlan::compile(custom, matrix::Matrix(1, 3));
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "custom activations are rejected");
+    }
+    std::cout << std::endl;
+
+    // Batch single-row requests from many threads
+    std::cout << "Testing the request batcher:\n";
+    {
+        neural::Sequential model(64);
+        model.add(neural::DenseLayer(12, 20, std::make_unique<neural::ReLU>()))
+             .add(neural::DenseLayer(20, 5, std::make_unique<neural::Softmax>()));
+        matrix::Matrix rows(64, 12);
+        for (size_t i = 0; i < rows.getRows(); ++i) {
+            for (size_t j = 0; j < rows.getCols(); ++j) {
+                rows(i, j) = std::cos(0.3 * double(i * 12 + j));
+            }
+        }
+        matrix::Matrix expected = model.forward(rows);
+
+        // Every result lands on the request that asked for it
+        neural::BatcherOptions options;
+        options.max_batch_size = 16;
+        options.max_wait = std::chrono::microseconds(200);
+        std::vector<std::vector<double>> results(rows.getRows());
+        neural::BatcherStats stats;
+        {
+            neural::RequestBatcher batcher(model, options);
+            std::vector<std::thread> clients;
+            for (size_t c = 0; c < 8; ++c) {
+                clients.emplace_back([&, c] {
+                    for (size_t i = c; i < rows.getRows(); i += 8) {
+                        results[i] = batcher.submit(rows.row(i)).get();
+                    }
+                });
+            }
+            for (std::thread& client : clients) {
+                client.join();
+            }
+            stats = batcher.getStats();
+        }
+        bool all_match = true;
+        for (size_t i = 0; i < rows.getRows(); ++i) {
+            for (size_t j = 0; j < expected.getCols(); ++j) {
+                all_match = all_match && results[i].size() == 5 && std::abs(results[i][j] - expected(i, j)) < 1e-12;
+            }
+        }
+        check(all_match, "batched results match a single forward pass");
+        check(stats.requests == 64 && stats.batches >= 4 && stats.batches <= 64,
+              "64 requests ran in " + std::to_string(stats.batches) + " batches");
+
+        // A full batch goes out at once, without waiting for the deadline
+        options.max_batch_size = 8;
+        options.max_wait = std::chrono::seconds(10);
+        auto start = std::chrono::steady_clock::now();
+        {
+            neural::RequestBatcher batcher(model, options);
+            std::vector<std::future<std::vector<double>>> futures;
+            for (size_t i = 0; i < 8; ++i) {
+                futures.push_back(batcher.submit(rows.row(i)));
+            }
+            for (auto& future : futures) {
+                future.get();
+            }
+            stats = batcher.getStats();
+        }
+        check(stats.batches == 1 && stats.full_batches == 1 && std::chrono::steady_clock::now() - start < std::chrono::seconds(5),
+              "a full batch runs immediately as one forward pass");
+
+        // A lone request is flushed by the deadline; an unfinished one by
+        // the destructor
+        options.max_batch_size = 16;
+        options.max_wait = std::chrono::milliseconds(1);
+        std::future<std::vector<double>> pending;
+        {
+            neural::RequestBatcher batcher(model, options);
+            std::vector<double> lone = batcher.submit(rows.row(3)).get();
+            check(std::abs(lone[0] - expected(3, 0)) < 1e-12, "a lone request completes after the wait limit");
+            options.max_wait = std::chrono::seconds(10);
+            pending = batcher.submit(rows.row(4));
+        }
+        check(pending.valid() && pending.get().size() == 5, "queued requests are served before shutdown");
+
+        // Errors reach the caller through the future
+        neural::RequestBatcher failing(3, [](const matrix::Matrix&, matrix::Matrix&) {
+            throw std::runtime_error("model failed");
+        });
+        bool threw = false;
+        try {
+            failing.submit(std::vector<double>{1.0, 2.0, 3.0}).get();
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        check(threw, "forward pass errors propagate through the future");
+        threw = false;
+        try {
+            failing.submit(std::vector<double>{1.0});
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "rows of the wrong size are rejected");
+        threw = false;
+        try {
+            options.max_batch_size = 65;
+            neural::RequestBatcher too_big(model, options);
+        } catch (const std::invalid_argument&) {
+            threw = true;
+        }
+        check(threw, "batches larger than the model's limit are rejected");
+    }
+    std::cout << std::endl;
+
+    // Quantize a trained-size model to int8 and measure what it costs
+    std::cout << "Testing int8 quantization:\n";
+    {
+        neural::Sequential model(64);
+        model.add(neural::DenseLayer(256, 256, std::make_unique<neural::ReLU>()))
+             .add(neural::DenseLayer(256, 128, std::make_unique<neural::Tanh>()))
+             .add(neural::DenseLayer(128, 10, std::make_unique<neural::Sigmoid>()));
+
+        auto makeBatch = [](size_t rows, size_t offset) {
+            matrix::Matrix batch(rows, 256);
+            for (size_t i = 0; i < rows; ++i) {
+                for (size_t j = 0; j < 256; ++j) {
+                    batch(i, j) = std::sin(0.37 * static_cast<double>((i + offset) * 256 + j));
+                }
+            }
+            return batch;
+        };
+        matrix::Matrix calibration = makeBatch(64, 0);
+        matrix::Matrix evaluation = makeBatch(64, 1000);
+
+        neural::QuantizationReport report = neural::quantizeModel(model, calibration, evaluation);
+        std::cout << "weights " << report.weight_bytes_before << " -> " << report.weight_bytes_after
+                  << " bytes (" << report.compression() << "x), max abs error " << report.max_abs_error
+                  << ", mean abs error " << report.mean_abs_error << ", relative error " << report.relative_error
+                  << ", top-1 agreement " << report.top1_agreement << "\n";
+        check(model.layer(0).isQuantized() && model.layer(0).getWeights().getRows() == 0,
+              "quantized layers release their double weights");
+        check(report.compression() > 7.5, "int8 weights cut weight memory ~8x");
+        check(report.relative_error < 0.02 && report.max_abs_error < 0.02,
+              "quantized outputs stay within 2% of the double model");
+        check(report.top1_agreement >= 0.9, "quantized model keeps the arg-max of nearly every row");
+
+        bool threw = false;
+        try {
+            model.layer(0).parameters();
+        } catch (const std::logic_error&) {
+            threw = true;
+        }
+        check(threw, "quantized layers cannot be trained");
+    }
+    std::cout << std::endl;
+
+    // Profiling scopes on the matrix and layer hot paths
+    std::cout << "Testing profiling and trace export:\n";
+    {
+        // Softmax is not fused, so the layer runs the GEMM and the
+        // activation separately
+        neural::DenseLayer layer(8, 4, std::make_unique<neural::Softmax>());
+        matrix::Matrix input(3, 8);
+        for (size_t i = 0; i < input.getRows(); ++i) {
+            for (size_t j = 0; j < input.getCols(); ++j) {
+                input(i, j) = std::sin(0.5 * double(i * 8 + j));
+            }
+        }
+        auto findOp = [](const std::vector<profiler::OpSummary>& ops, const std::string& name) {
+            for (const profiler::OpSummary& op : ops) {
+                if (op.name == name) {
+                    return op;
+                }
+            }
+            return profiler::OpSummary{};
+        };
+
+        profiler::reset();
+        matrix::Matrix z, output;
+        layer.forward(input, z, output);
+        check(!profiler::isEnabled() && profiler::summary().empty(), "nothing is recorded while disabled");
+
+#if DIONE_PROFILING
+        profiler::setEnabled(true);
+        z = matrix::Matrix();
+        layer.forward(input, z, output);
+
+        // Before the worker's un-nested Activation::apply is recorded, the
+        // only one is the call inside DenseLayer::forward
+        std::vector<profiler::OpSummary> nested = profiler::summary();
+        check(findOp(nested, "DenseLayer::forward").total_seconds
+                  >= findOp(nested, "Activation::apply").total_seconds
+              && findOp(nested, "Activation::apply").calls == 1,
+              "scope times include nested scopes");
+
+        std::thread worker([&] {
+            matrix::Matrix out;
+            layer.infer(input, out);
+        });
+        worker.join();
+        profiler::counter("test::counter", 7.0);
+        profiler::setEnabled(false);
+        layer.forward(input, z, output);
+
+        std::vector<profiler::OpSummary> ops = profiler::summary();
+        profiler::OpSummary dense = findOp(ops, "DenseLayer::forward");
+        profiler::OpSummary gemm = findOp(ops, "Matrix::multiply");
+        profiler::OpSummary act = findOp(ops, "Activation::apply");
+        double expected_flops = 2.0 * 3 * 8 * 4;
+        check(dense.calls == 1 && dense.flops == expected_flops, "DenseLayer::forward counts calls and flops");
+        check(gemm.calls == 2 && gemm.flops == 2 * expected_flops, "Matrix::multiply counts calls and flops");
+        check(act.calls == 2, "Activation::apply is recorded");
+        check(findOp(ops, "DenseLayer::infer").calls == 1, "scopes on other threads are recorded");
+        check(gemm.bytes_allocated >= 2 * 3 * 4 * sizeof(double),
+              "allocations are charged to the innermost scope");
+        check(dense.bytes_allocated == 0, "nested allocations are not double counted");
+
+        std::ostringstream trace;
+        profiler::writeChromeTrace(trace);
+        std::string json = trace.str();
+        check(json.find("\"traceEvents\"") != std::string::npos
+              && json.find("\"name\": \"Matrix::multiply\"") != std::string::npos
+              && json.find("\"ph\": \"X\"") != std::string::npos,
+              "scopes export as Chrome complete events");
+        check(json.find("\"name\": \"test::counter\", \"cat\": \"counter\"") != std::string::npos
+              && json.find("\"ph\": \"C\", \"args\": {\"value\": 7.000}") != std::string::npos,
+              "counters export as Chrome counter events");
+        profiler::printSummary(std::cout);
+
+        profiler::reset();
+        check(profiler::summary().empty() && profiler::droppedEvents() == 0, "reset discards recorded events");
+#endif
+    }
+    std::cout << std::endl;
+
+    return failures == 0 ? 0 : 1;
 }
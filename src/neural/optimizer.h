@@ -0,0 +1,125 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "../matrix/matrix.h"
+
+namespace neural {
+
+// A trainable matrix and the gradient of the loss with respect to it
+struct Parameter {
+    matrix::Matrix* value;
+    const matrix::Matrix* grad;
+};
+
+class Optimizer {
+public:
+    virtual ~Optimizer() = default;
+
+    // Update every parameter from its gradient. Optimizer state is matched
+    // to parameters by position, so pass the same list on every step.
+    virtual void step(const std::vector<Parameter>& params) = 0;
+
+protected:
+    // Zero-initialized state matrices shaped like the parameters
+    static void initState(const std::vector<Parameter>& params, std::vector<matrix::Matrix>& state) {
+        if (state.size() == params.size()) {
+            return;
+        }
+        state.clear();
+        for (const Parameter& p : params) {
+            if (p.value->getRows() != p.grad->getRows() || p.value->getCols() != p.grad->getCols()) {
+                throw std::invalid_argument("Parameter and gradient shapes don't match");
+            }
+            state.emplace_back(p.value->getRows(), p.value->getCols(), 0.0);
+        }
+    }
+};
+
+// Stochastic gradient descent with optional (heavy-ball) momentum:
+// v = momentum * v - learning_rate * g; w += v
+class SGD : public Optimizer {
+private:
+    double learning_rate;
+    double momentum;
+    std::vector<matrix::Matrix> velocity;
+
+public:
+    explicit SGD(double learning_rate, double momentum = 0.0)
+        : learning_rate(learning_rate), momentum(momentum) {}
+
+    double getLearningRate() const { return learning_rate; }
+    double getMomentum() const { return momentum; }
+
+    void step(const std::vector<Parameter>& params) override {
+        if (momentum == 0.0) {
+            for (const Parameter& p : params) {
+                for (size_t i = 0; i < p.value->getRows(); ++i) {
+                    auto w = p.value->row(i);
+                    auto g = p.grad->row(i);
+                    for (size_t j = 0; j < w.size(); ++j) {
+                        w[j] -= learning_rate * g[j];
+                    }
+                }
+            }
+            return;
+        }
+        initState(params, velocity);
+        for (size_t k = 0; k < params.size(); ++k) {
+            const Parameter& p = params[k];
+            for (size_t i = 0; i < p.value->getRows(); ++i) {
+                auto w = p.value->row(i);
+                auto g = p.grad->row(i);
+                auto v = velocity[k].row(i);
+                for (size_t j = 0; j < w.size(); ++j) {
+                    v[j] = momentum * v[j] - learning_rate * g[j];
+                    w[j] += v[j];
+                }
+            }
+        }
+    }
+};
+
+// Adam (Kingma & Ba) with bias-corrected first and second moment estimates
+class Adam : public Optimizer {
+private:
+    double learning_rate;
+    double beta1;
+    double beta2;
+    double epsilon;
+    size_t steps = 0;
+    std::vector<matrix::Matrix> first_moment;
+    std::vector<matrix::Matrix> second_moment;
+
+public:
+    explicit Adam(double learning_rate = 1e-3, double beta1 = 0.9, double beta2 = 0.999, double epsilon = 1e-8)
+        : learning_rate(learning_rate), beta1(beta1), beta2(beta2), epsilon(epsilon) {}
+
+    void step(const std::vector<Parameter>& params) override {
+        initState(params, first_moment);
+        initState(params, second_moment);
+        ++steps;
+        double correction1 = 1.0 - std::pow(beta1, static_cast<double>(steps));
+        double correction2 = 1.0 - std::pow(beta2, static_cast<double>(steps));
+        for (size_t k = 0; k < params.size(); ++k) {
+            const Parameter& p = params[k];
+            for (size_t i = 0; i < p.value->getRows(); ++i) {
+                auto w = p.value->row(i);
+                auto g = p.grad->row(i);
+                auto m = first_moment[k].row(i);
+                auto v = second_moment[k].row(i);
+                for (size_t j = 0; j < w.size(); ++j) {
+                    m[j] = beta1 * m[j] + (1.0 - beta1) * g[j];
+                    v[j] = beta2 * v[j] + (1.0 - beta2) * g[j] * g[j];
+                    w[j] -= learning_rate * (m[j] / correction1) / (std::sqrt(v[j] / correction2) + epsilon);
+                }
+            }
+        }
+    }
+};
+
+} // namespace neural
+
+#endif // OPTIMIZER_H
@@ -0,0 +1,153 @@
+#ifndef POOLING_H
+#define POOLING_H
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "../matrix/matrix.h"
+#include "tensor_layout.h"
+
+namespace neural {
+
+// Window reduction applied by a pooling layer
+enum class PoolMode {
+    Max,
+    Average
+};
+
+struct PoolOptions {
+    size_t stride = 0;   // 0: equal to the window (non-overlapping)
+    size_t padding = 0;  // Padding on every side; never selected or counted
+    TensorLayout layout = TensorLayout::NHWC;
+};
+
+// 2-D pooling over a batch of flattened images (see tensor_layout.h), each
+// channel separately. Padded positions are skipped: a max ignores them and
+// an average divides by the number of real inputs in the window. Like
+// DenseLayer, infer() is const and thread-safe. A sequence is pooled with
+// a {1, length, channels} shape and a 1 x k window.
+class Pool2D {
+private:
+    PoolMode mode;
+    ImageShape input_shape;
+    ImageShape output_shape;
+    size_t pool_height;
+    size_t pool_width;
+    size_t stride_y;
+    size_t stride_x;
+    size_t padding;
+    TensorLayout layout;
+
+    matrix::Matrix last_output;
+
+    void checkInput(const matrix::Matrix& input) const {
+        if (input.getCols() != input_shape.size()) {
+            throw std::invalid_argument("Input dimensions don't match pooling input size");
+        }
+    }
+
+public:
+    Pool2D(PoolMode mode, ImageShape input_shape, size_t pool_height, size_t pool_width,
+           const PoolOptions& options = {})
+        : mode(mode),
+          input_shape(input_shape),
+          pool_height(pool_height),
+          pool_width(pool_width),
+          stride_y(options.stride ? options.stride : pool_height),
+          stride_x(options.stride ? options.stride : pool_width),
+          padding(options.padding),
+          layout(options.layout) {
+        if (input_shape.size() == 0 || pool_height == 0 || pool_width == 0) {
+            throw std::invalid_argument("Pooling shape and window must be non-zero");
+        }
+        // Keeps every window overlapping at least one real input
+        if (padding >= pool_height || padding >= pool_width) {
+            throw std::invalid_argument("Pooling padding must be smaller than the window");
+        }
+        output_shape = {slidingOutputSize(input_shape.height, pool_height, stride_y, padding),
+                        slidingOutputSize(input_shape.width, pool_width, stride_x, padding),
+                        input_shape.channels};
+        if (output_shape.height == 0 || output_shape.width == 0) {
+            throw std::invalid_argument("Pooling window is larger than the padded input");
+        }
+    }
+
+    // Stateless inference into a caller-owned output (batch x output size)
+    void infer(const matrix::Matrix& input, matrix::Matrix& output) const {
+        checkInput(input);
+        if (&input == &output) {
+            throw std::invalid_argument("Pooling output must not alias its input");
+        }
+        output.resize(input.getRows(), output_shape.size());
+        for (size_t n = 0; n < input.getRows(); ++n) {
+            const double* in = input.row(n).data();
+            double* out = output.row(n).data();
+            for (size_t oy = 0; oy < output_shape.height; ++oy) {
+                // Clip the window to the real input
+                long y0 = static_cast<long>(oy * stride_y) - static_cast<long>(padding);
+                size_t y_begin = static_cast<size_t>(std::max(y0, 0L));
+                size_t y_end = static_cast<size_t>(std::min(y0 + static_cast<long>(pool_height),
+                                                            static_cast<long>(input_shape.height)));
+                for (size_t ox = 0; ox < output_shape.width; ++ox) {
+                    long x0 = static_cast<long>(ox * stride_x) - static_cast<long>(padding);
+                    size_t x_begin = static_cast<size_t>(std::max(x0, 0L));
+                    size_t x_end = static_cast<size_t>(std::min(x0 + static_cast<long>(pool_width),
+                                                                static_cast<long>(input_shape.width)));
+                    double count = static_cast<double>((y_end - y_begin) * (x_end - x_begin));
+                    for (size_t c = 0; c < input_shape.channels; ++c) {
+                        double acc = mode == PoolMode::Max ? -std::numeric_limits<double>::infinity() : 0.0;
+                        for (size_t y = y_begin; y < y_end; ++y) {
+                            for (size_t x = x_begin; x < x_end; ++x) {
+                                double v = in[input_shape.index(layout, y, x, c)];
+                                acc = mode == PoolMode::Max ? std::max(acc, v) : acc + v;
+                            }
+                        }
+                        out[output_shape.index(layout, oy, ox, c)] = mode == PoolMode::Max ? acc : acc / count;
+                    }
+                }
+            }
+        }
+    }
+
+    matrix::Matrix infer(const matrix::Matrix& input) const {
+        matrix::Matrix output;
+        infer(input, output);
+        return output;
+    }
+
+    // Forward pass, keeping the output like DenseLayer::forward()
+    matrix::Matrix forward(const matrix::Matrix& input) {
+        infer(input, last_output);
+        return last_output;
+    }
+
+    void forward(const matrix::Matrix& input, matrix::Matrix& output) {
+        infer(input, last_output);
+        output = last_output;
+    }
+
+    // Getters
+    PoolMode getMode() const { return mode; }
+    const ImageShape& getInputShape() const { return input_shape; }
+    const ImageShape& getOutputShape() const { return output_shape; }
+    size_t getInputSize() const { return input_shape.size(); }
+    size_t getOutputSize() const { return output_shape.size(); }
+    TensorLayout getLayout() const { return layout; }
+    const matrix::Matrix& getLastOutput() const { return last_output; }
+};
+
+class MaxPool2D : public Pool2D {
+public:
+    MaxPool2D(ImageShape input_shape, size_t pool_height, size_t pool_width, const PoolOptions& options = {})
+        : Pool2D(PoolMode::Max, input_shape, pool_height, pool_width, options) {}
+};
+
+class AvgPool2D : public Pool2D {
+public:
+    AvgPool2D(ImageShape input_shape, size_t pool_height, size_t pool_width, const PoolOptions& options = {})
+        : Pool2D(PoolMode::Average, input_shape, pool_height, pool_width, options) {}
+};
+
+} // namespace neural
+
+#endif // POOLING_H
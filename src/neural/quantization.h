@@ -0,0 +1,76 @@
+#ifndef QUANTIZATION_H
+#define QUANTIZATION_H
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "sequential.h"
+
+namespace neural {
+
+// Accuracy and size of an int8-quantized model against its double original
+struct QuantizationReport {
+    size_t weight_bytes_before = 0;
+    size_t weight_bytes_after = 0;
+    double max_abs_error = 0.0;   // Largest |quantized - reference| output
+    double mean_abs_error = 0.0;  // Mean |quantized - reference| output
+    double relative_error = 0.0;  // ||quantized - reference|| / ||reference|| (Frobenius)
+    double top1_agreement = 0.0;  // Fraction of rows whose arg-max output is unchanged
+
+    // weight_bytes_before / weight_bytes_after
+    double compression() const {
+        return weight_bytes_after ? double(weight_bytes_before) / double(weight_bytes_after) : 0.0;
+    }
+};
+
+// Error statistics of quantized against reference outputs of the same shape
+inline QuantizationReport compareOutputs(const matrix::Matrix& reference, const matrix::Matrix& quantized) {
+    if (reference.getRows() != quantized.getRows() || reference.getCols() != quantized.getCols()) {
+        throw std::invalid_argument("Outputs to compare must have the same dimensions");
+    }
+    QuantizationReport report;
+    double error_sq = 0.0;
+    double reference_sq = 0.0;
+    size_t agree = 0;
+    for (size_t i = 0; i < reference.getRows(); ++i) {
+        auto ref = reference.row(i);
+        auto out = quantized.row(i);
+        for (size_t j = 0; j < ref.size(); ++j) {
+            double diff = std::abs(out[j] - ref[j]);
+            report.max_abs_error = std::max(report.max_abs_error, diff);
+            report.mean_abs_error += diff;
+            error_sq += diff * diff;
+            reference_sq += ref[j] * ref[j];
+        }
+        if (std::max_element(ref.begin(), ref.end()) - ref.begin()
+            == std::max_element(out.begin(), out.end()) - out.begin()) {
+            ++agree;
+        }
+    }
+    size_t count = reference.getRows() * reference.getCols();
+    if (count != 0) {
+        report.mean_abs_error /= double(count);
+        report.top1_agreement = double(agree) / double(reference.getRows());
+    }
+    report.relative_error = reference_sq > 0.0 ? std::sqrt(error_sq / reference_sq) : std::sqrt(error_sq);
+    return report;
+}
+
+// Quantize model (see Sequential::quantize()) with the given calibration
+// batch and report how its outputs on the evaluation batch moved relative
+// to the double model. The evaluation batch should be held out from the
+// calibration batch for an honest estimate.
+inline QuantizationReport quantizeModel(Sequential& model, const matrix::Matrix& calibration,
+                                        const matrix::Matrix& evaluation) {
+    size_t bytes_before = model.weightBytes();
+    matrix::Matrix reference = model.forward(evaluation);
+    model.quantize(calibration);
+    QuantizationReport report = compareOutputs(reference, model.forward(evaluation));
+    report.weight_bytes_before = bytes_before;
+    report.weight_bytes_after = model.weightBytes();
+    return report;
+}
+
+} // namespace neural
+
+#endif // QUANTIZATION_H
@@ -0,0 +1,150 @@
+#ifndef SEQUENTIAL_H
+#define SEQUENTIAL_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "dense.h"
+
+namespace neural {
+
+// A stack of dense layers evaluated in order.
+//
+// Activations between layers live in two ping-pong buffers sized once for
+// the maximum batch: layer i reads the buffer layer i-1 wrote and writes the
+// other one, and the last layer writes straight into the caller's output.
+// Memory use is therefore bounded by 3 * max_batch_size * (widest hidden
+// layer), the third buffer being scratch for layers whose activation cannot
+// be fused, and a forward pass makes no heap allocations once the output
+// matrix has reached the batch size.
+class Sequential {
+private:
+    std::vector<DenseLayer> layers;
+    size_t max_batch_size;
+    matrix::Matrix buffers[2];
+    matrix::Matrix scratch;
+
+    // Size the buffers for the current layers and batch limit. resize()
+    // keeps the capacity, so smaller batches later reuse the same storage.
+    void planBuffers() {
+        size_t widest = 0;
+        for (const DenseLayer& layer : layers) {
+            widest = std::max(widest, layer.getOutputSize());
+        }
+        for (matrix::Matrix& buffer : buffers) {
+            buffer.resize(max_batch_size, widest);
+        }
+        scratch.resize(max_batch_size, widest);
+    }
+
+public:
+    explicit Sequential(size_t max_batch_size) : max_batch_size(max_batch_size) {}
+
+    // Append a layer; its input size must match the previous layer's output
+    Sequential& add(DenseLayer layer) {
+        if (!layers.empty() && layer.getInputSize() != layers.back().getOutputSize()) {
+            throw std::invalid_argument("Layer input size " + std::to_string(layer.getInputSize())
+                                        + " doesn't match previous output size "
+                                        + std::to_string(layers.back().getOutputSize()));
+        }
+        layers.push_back(std::move(layer));
+        planBuffers();
+        return *this;
+    }
+
+    // Change the largest batch forward() accepts (re-plans the buffers)
+    void setMaxBatchSize(size_t size) {
+        max_batch_size = size;
+        planBuffers();
+    }
+
+    // Forward pass into a caller-owned output. Uses the layers' stateless
+    // infer() path, so the layers' cached state is left alone.
+    void forward(const matrix::Matrix& input, matrix::Matrix& output) {
+        if (layers.empty()) {
+            throw std::logic_error("Sequential model has no layers");
+        }
+        if (input.getRows() > max_batch_size) {
+            throw std::invalid_argument("Batch of " + std::to_string(input.getRows())
+                                        + " rows exceeds the maximum batch size "
+                                        + std::to_string(max_batch_size));
+        }
+        const matrix::Matrix* current = &input;
+        for (size_t i = 0; i + 1 < layers.size(); ++i) {
+            matrix::Matrix& next = buffers[i % 2];
+            layers[i].infer(*current, next, scratch);
+            current = &next;
+        }
+        layers.back().infer(*current, output, scratch);
+    }
+
+    // Forward pass
+    matrix::Matrix forward(const matrix::Matrix& input) {
+        matrix::Matrix output;
+        forward(input, output);
+        return output;
+    }
+
+    // Quantize every layer to int8 weights (see DenseLayer::quantize()).
+    // The calibration batch is run through the model as it is quantized, so
+    // each layer's input scale is calibrated on the activations it will
+    // actually see, including the error of the quantized layers before it.
+    void quantize(const matrix::Matrix& calibration) {
+        matrix::Matrix current = calibration;
+        matrix::Matrix next;
+        for (DenseLayer& layer : layers) {
+            layer.quantize(current);
+            layer.infer(current, next);
+            std::swap(current, next);
+        }
+    }
+
+    // Bytes of weight storage across all layers, in whatever form each
+    // layer holds them (dense, sparse, mapped or quantized)
+    size_t weightBytes() const {
+        size_t bytes = 0;
+        for (const DenseLayer& layer : layers) {
+            if (layer.isQuantized()) {
+                bytes += layer.getQuantizedWeights().byteSize();
+            } else if (layer.isSparse()) {
+                const matrix::SparseMatrix& w = layer.getSparseWeights();
+                bytes += w.getNonZeros() * (sizeof(double) + sizeof(uint32_t))
+                         + w.getOffsets().size() * sizeof(size_t);
+            } else {
+                bytes += layer.getInputSize() * layer.getOutputSize() * sizeof(double);
+            }
+        }
+        return bytes;
+    }
+
+    // Trainable parameters of every layer, in layer order
+    std::vector<Parameter> parameters() {
+        std::vector<Parameter> params;
+        for (DenseLayer& layer : layers) {
+            for (const Parameter& p : layer.parameters()) {
+                params.push_back(p);
+            }
+        }
+        return params;
+    }
+
+    // Reset every layer's accumulated gradients
+    void zeroGrad() {
+        for (DenseLayer& layer : layers) {
+            layer.zeroGrad();
+        }
+    }
+
+    // Getters
+    size_t size() const { return layers.size(); }
+    DenseLayer& layer(size_t i) { return layers.at(i); }
+    const DenseLayer& layer(size_t i) const { return layers.at(i); }
+    size_t getMaxBatchSize() const { return max_batch_size; }
+    size_t getInputSize() const { return layers.empty() ? 0 : layers.front().getInputSize(); }
+    size_t getOutputSize() const { return layers.empty() ? 0 : layers.back().getOutputSize(); }
+};
+
+} // namespace neural
+
+#endif // SEQUENTIAL_H
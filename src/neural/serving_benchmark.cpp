@@ -0,0 +1,125 @@
+#include "batcher.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Latency and throughput of single-row requests served directly and through
+// the RequestBatcher, under closed-loop synthetic load: every client thread
+// sends a request, waits for its result and sends the next.
+//
+// Usage: serving_benchmark [clients] [requests_per_client] [max_batch] [max_wait_us]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadResult {
+    std::vector<double> latencies;  // Seconds, one per request
+    double seconds = 0.0;           // Wall time of the whole run
+};
+
+// Run clients threads of requests requests each, timing every call of
+// serve(client, row)
+template <typename Serve>
+LoadResult runLoad(size_t clients, size_t requests, const matrix::Matrix& rows, Serve serve) {
+    std::vector<std::vector<double>> latencies(clients);
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            latencies[c].reserve(requests);
+            for (size_t r = 0; r < requests; ++r) {
+                size_t i = (c * requests + r) % rows.getRows();
+                auto sent = Clock::now();
+                serve(c, i);
+                latencies[c].push_back(std::chrono::duration<double>(Clock::now() - sent).count());
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    LoadResult result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (const std::vector<double>& client : latencies) {
+        result.latencies.insert(result.latencies.end(), client.begin(), client.end());
+    }
+    std::sort(result.latencies.begin(), result.latencies.end());
+    return result;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * double(sorted.size())));
+    return sorted[index];
+}
+
+void report(const std::string& name, const LoadResult& result) {
+    std::cout << std::setw(22) << std::left << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << percentile(result.latencies, 0.50) * 1e6
+              << std::setw(12) << percentile(result.latencies, 0.99) * 1e6
+              << std::setprecision(0) << std::setw(16) << double(result.latencies.size()) / result.seconds;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t clients = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+    size_t requests = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 500;
+    neural::BatcherOptions options;
+    options.max_batch_size = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 32;
+    options.max_wait = std::chrono::microseconds(argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 500);
+
+    neural::Sequential model(std::max<size_t>(options.max_batch_size, 1));
+    model.add(neural::DenseLayer(256, 512, std::make_unique<neural::ReLU>()))
+         .add(neural::DenseLayer(512, 512, std::make_unique<neural::ReLU>()))
+         .add(neural::DenseLayer(512, 10, std::make_unique<neural::Softmax>()));
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    matrix::Matrix rows(1024, 256);
+    for (size_t i = 0; i < rows.getRows(); ++i) {
+        for (double& x : rows.row(i)) {
+            x = dist(gen);
+        }
+    }
+    matrix::Matrix sample = matrix::view(rows).rowRange(0, 64).toMatrix();
+    neural::InferencePlan plan = neural::InferencePlan::compile(model, sample);
+
+    std::cout << "Serving a 256-512-512-10 MLP, " << clients << " clients x " << requests << " requests, max batch "
+              << options.max_batch_size << ", max wait " << options.max_wait.count() << " us\n";
+    std::cout << std::setw(22) << std::left << "mode" << std::right << std::setw(12) << "p50 (us)"
+              << std::setw(12) << "p99 (us)" << std::setw(16) << "throughput (/s)" << "\n";
+
+    // Each client runs its own 1-row inference
+    std::vector<matrix::Matrix> inputs(clients, matrix::Matrix(1, 256));
+    std::vector<matrix::Matrix> outputs(clients);
+    report("unbatched", runLoad(clients, requests, rows, [&](size_t c, size_t i) {
+        std::copy(rows.row(i).begin(), rows.row(i).end(), inputs[c].row(0).begin());
+        plan.infer(inputs[c], outputs[c]);
+    }));
+    std::cout << "\n";
+
+    // All clients share one batcher
+    neural::BatcherStats stats;
+    LoadResult batched;
+    {
+        neural::RequestBatcher batcher(plan, options);
+        batched = runLoad(clients, requests, rows, [&](size_t, size_t i) {
+            batcher.submit(rows.row(i)).get();
+        });
+        stats = batcher.getStats();
+    }
+    report("batched", batched);
+    std::cout << std::setprecision(1) << "   (mean batch " << stats.meanBatchSize() << ", "
+              << stats.full_batches << "/" << stats.batches << " full)\n";
+    return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef TENSOR_LAYOUT_H
+#define TENSOR_LAYOUT_H
+
+#include <cstddef>
+
+namespace neural {
+
+// Order of the features of one sample in a matrix row. Convolution and
+// pooling layers take a batch as a matrix with one flattened sample per
+// row, like DenseLayer, so they chain with dense layers without copies.
+enum class TensorLayout {
+    NHWC,  // Channels last: feature (y * width + x) * channels + c
+    NCHW   // Channels first: feature (c * height + y) * width + x
+};
+
+// Height, width and channel count of one sample. A sequence of length L is
+// the shape {1, L, channels}.
+struct ImageShape {
+    size_t height = 0;
+    size_t width = 0;
+    size_t channels = 0;
+
+    // Number of features per sample
+    size_t size() const { return height * width * channels; }
+
+    // Feature index of (y, x, c) in the given layout
+    size_t index(TensorLayout layout, size_t y, size_t x, size_t c) const {
+        return layout == TensorLayout::NHWC ? (y * width + x) * channels + c : (c * height + y) * width + x;
+    }
+
+    bool operator==(const ImageShape& other) const = default;
+};
+
+// Output extent of a sliding window: floor((in + 2 * padding - window) / stride) + 1,
+// or 0 if the window does not fit
+inline size_t slidingOutputSize(size_t in, size_t window, size_t stride, size_t padding) {
+    size_t padded = in + 2 * padding;
+    return padded < window ? 0 : (padded - window) / stride + 1;
+}
+
+} // namespace neural
+
+#endif // TENSOR_LAYOUT_H
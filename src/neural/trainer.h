@@ -0,0 +1,270 @@
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "../matrix/thread_pool.h"
+#include "loss.h"
+#include "optimizer.h"
+#include "sequential.h"
+
+namespace neural {
+
+// How the gradients of concurrent workers are combined
+enum class GradientReduction {
+    // Shards of each mini-batch are reduced pairwise in parallel, then the
+    // optimizer takes one step: the same result as serial training up to
+    // summation order
+    Tree,
+
+    // Hogwild: in fit(), every worker trains on its own mini-batches and
+    // applies plain SGD updates straight to the shared weights without
+    // locks. Workers may read weights mid-update and updates may be lost;
+    // with sparse-ish gradients this converges like serial SGD while never
+    // synchronizing. Requires an SGD optimizer without momentum.
+    Hogwild
+};
+
+struct TrainingOptions {
+    size_t batch_size = 32;
+    size_t epochs = 1;
+    bool shuffle = true;
+    unsigned seed = 42;
+
+    // Shards of a mini-batch get at least this many rows; smaller shards
+    // cost more in synchronization than they gain in parallelism
+    size_t min_shard_rows = 8;
+
+    GradientReduction reduction = GradientReduction::Tree;
+};
+
+// Mini-batch training of a Sequential model.
+//
+// Workers share the model's weights read-only and run forward and backward
+// concurrently on the shared ThreadPool, each with its own activations and
+// gradient accumulators, through the layers' const stateless paths. With
+// GradientReduction::Tree each mini-batch is split into row shards whose
+// gradients are summed by a parallel pairwise reduction before one
+// optimizer step; the loss gradient is scaled by 1 / batch rows in every
+// shard, so the sum is exactly the gradient of the batch's mean loss. See
+// GradientReduction::Hogwild for the lock-free alternative.
+class Trainer {
+private:
+    // Per-shard working set, reused across steps
+    struct Shard {
+        matrix::Matrix input;
+        matrix::Matrix target;
+        std::vector<matrix::Matrix> z;
+        std::vector<matrix::Matrix> outputs;
+        std::vector<DenseGradients> grads;
+        matrix::Matrix grad_in;
+        matrix::Matrix grad_out;
+        double loss_sum = 0.0;
+    };
+
+    Sequential& model;
+    const Loss& loss;
+    Optimizer& optimizer;
+    TrainingOptions options;
+    std::vector<Shard> shards;
+    std::mt19937 rng;
+
+    // Copy the listed rows of source into dest
+    static void gatherRows(const matrix::Matrix& source, const size_t* rows, size_t count, matrix::Matrix& dest) {
+        dest.resize(count, source.getCols());
+        for (size_t i = 0; i < count; ++i) {
+            auto from = source.row(rows[i]);
+            std::copy(from.begin(), from.end(), dest.row(i).begin());
+        }
+    }
+
+    // Forward and backward for one shard, accumulating into its gradients
+    void runShard(Shard& shard, double scale) {
+        size_t depth = model.size();
+        shard.z.resize(depth);
+        shard.outputs.resize(depth);
+        shard.grads.resize(depth);
+
+        const matrix::Matrix* current = &shard.input;
+        for (size_t l = 0; l < depth; ++l) {
+            model.layer(l).forward(*current, shard.z[l], shard.outputs[l]);
+            current = &shard.outputs[l];
+        }
+        shard.loss_sum = loss.sum(*current, shard.target);
+        loss.scaledGradient(*current, shard.target, scale, shard.grad_out);
+
+        for (size_t l = depth; l-- > 0;) {
+            const DenseLayer& layer = model.layer(l);
+            shard.grads[l].zero(layer.getInputSize(), layer.getOutputSize());
+            const matrix::Matrix& layer_input = l == 0 ? shard.input : shard.outputs[l - 1];
+            layer.backward(layer_input, shard.z[l], shard.grad_out, shard.grads[l],
+                           l == 0 ? nullptr : &shard.grad_in);
+            std::swap(shard.grad_in, shard.grad_out);
+        }
+    }
+
+    double stepRows(const matrix::Matrix& inputs, const matrix::Matrix& targets, const size_t* rows, size_t count) {
+        size_t threads = matrix::getNumThreads();
+        size_t shard_count = std::clamp<size_t>(count / std::max<size_t>(options.min_shard_rows, 1), 1, threads);
+        if (shards.size() < shard_count) {
+            shards.resize(shard_count);
+        }
+        for (size_t s = 0; s < shard_count; ++s) {
+            size_t begin = count * s / shard_count;
+            size_t end = count * (s + 1) / shard_count;
+            gatherRows(inputs, rows + begin, end - begin, shards[s].input);
+            gatherRows(targets, rows + begin, end - begin, shards[s].target);
+        }
+
+        double scale = 1.0 / static_cast<double>(count);
+        matrix::globalThreadPool().parallelFor(shard_count, [&](size_t s) { runShard(shards[s], scale); });
+
+        // Pairwise tree reduction into shard 0: log2(shards) rounds, each
+        // merging disjoint pairs in parallel. The pairing is fixed, so the
+        // result only depends on the shard count.
+        for (size_t width = 1; width < shard_count; width *= 2) {
+            size_t pairs = (shard_count + width - 1) / (2 * width);
+            matrix::globalThreadPool().parallelFor(pairs, [&](size_t p) {
+                Shard& to = shards[p * 2 * width];
+                const Shard& from = shards[p * 2 * width + width];
+                for (size_t l = 0; l < model.size(); ++l) {
+                    to.grads[l].add(from.grads[l]);
+                }
+                to.loss_sum += from.loss_sum;
+            });
+        }
+        for (size_t l = 0; l < model.size(); ++l) {
+            model.layer(l).accumulateGradients(shards[0].grads[l]);
+        }
+        double loss_sum = shards[0].loss_sum;
+        optimizer.step(model.parameters());
+        model.zeroGrad();
+        return loss_sum / static_cast<double>(count);
+    }
+
+    // One Hogwild epoch: worker w takes mini-batches w, w + W, ... of order
+    // and applies each gradient to the shared weights as soon as it has it
+    double hogwildEpoch(const matrix::Matrix& inputs, const matrix::Matrix& targets,
+                        const std::vector<size_t>& order, double learning_rate) {
+        size_t batches = (order.size() + options.batch_size - 1) / options.batch_size;
+        size_t workers = std::min(matrix::getNumThreads(), batches);
+        if (shards.size() < workers) {
+            shards.resize(workers);
+        }
+
+        // Taken before the workers start: parameters() may size the
+        // layers' gradient buffers, which must not happen concurrently
+        std::vector<Parameter> params = model.parameters();
+
+        matrix::globalThreadPool().parallelFor(workers, [&](size_t w) {
+            Shard& shard = shards[w];
+            double worker_loss = 0.0;
+            for (size_t b = w; b < batches; b += workers) {
+                size_t begin = b * options.batch_size;
+                size_t count = std::min(options.batch_size, order.size() - begin);
+                gatherRows(inputs, order.data() + begin, count, shard.input);
+                gatherRows(targets, order.data() + begin, count, shard.target);
+                runShard(shard, 1.0 / static_cast<double>(count));
+                worker_loss += shard.loss_sum;
+
+                // Unsynchronized update: the deliberate Hogwild data race.
+                // hogwildUpdate() writes each element through a relaxed
+                // atomic_ref, but runShard()'s GEMMs read the shared weights
+                // with plain loads while other workers write them, so a
+                // forward pass may mix old and new values (and TSan reports
+                // the race). Concurrent updates to one weight may also
+                // overwrite each other.
+                for (size_t l = 0; l < model.size(); ++l) {
+                    const DenseGradients& g = shard.grads[l];
+                    hogwildUpdate(*params[2 * l].value, g.weights, learning_rate);
+                    hogwildUpdate(*params[2 * l + 1].value, g.biases, learning_rate);
+                }
+            }
+            shard.loss_sum = worker_loss;
+        });
+
+        double total = 0.0;
+        for (size_t w = 0; w < workers; ++w) {
+            total += shards[w].loss_sum;
+        }
+        return total / static_cast<double>(order.size());
+    }
+
+    static void hogwildUpdate(matrix::Matrix& value, const matrix::Matrix& grad, double learning_rate) {
+        for (size_t i = 0; i < value.getRows(); ++i) {
+            auto w = value.row(i);
+            auto g = grad.row(i);
+            for (size_t j = 0; j < w.size(); ++j) {
+                std::atomic_ref<double> element(w[j]);
+                element.store(element.load(std::memory_order_relaxed) - learning_rate * g[j],
+                              std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void checkData(const matrix::Matrix& inputs, const matrix::Matrix& targets) const {
+        if (inputs.getRows() != targets.getRows()) {
+            throw std::invalid_argument("Inputs and targets have different numbers of rows");
+        }
+        if (inputs.getCols() != model.getInputSize() || targets.getCols() != model.getOutputSize()) {
+            throw std::invalid_argument("Training data dimensions don't match the model");
+        }
+    }
+
+public:
+    Trainer(Sequential& model, const Loss& loss, Optimizer& optimizer, TrainingOptions options = {})
+        : model(model), loss(loss), optimizer(optimizer), options(options), rng(options.seed) {
+        if (options.batch_size == 0) {
+            throw std::invalid_argument("Batch size must be positive");
+        }
+        if (options.reduction == GradientReduction::Hogwild) {
+            auto* sgd = dynamic_cast<SGD*>(&optimizer);
+            if (!sgd || sgd->getMomentum() != 0.0) {
+                throw std::invalid_argument("Hogwild training requires an SGD optimizer without momentum");
+            }
+        }
+    }
+
+    // One optimizer step on a whole mini-batch (always tree-reduced);
+    // returns its mean loss
+    double step(const matrix::Matrix& inputs, const matrix::Matrix& targets) {
+        checkData(inputs, targets);
+        std::vector<size_t> rows(inputs.getRows());
+        std::iota(rows.begin(), rows.end(), size_t(0));
+        return rows.empty() ? 0.0 : stepRows(inputs, targets, rows.data(), rows.size());
+    }
+
+    // Train for options.epochs passes over the data in mini-batches of
+    // options.batch_size rows; returns the mean training loss of each epoch
+    std::vector<double> fit(const matrix::Matrix& inputs, const matrix::Matrix& targets) {
+        checkData(inputs, targets);
+        std::vector<size_t> order(inputs.getRows());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::vector<double> history;
+        for (size_t epoch = 0; epoch < options.epochs; ++epoch) {
+            if (options.shuffle) {
+                std::shuffle(order.begin(), order.end(), rng);
+            }
+            if (options.reduction == GradientReduction::Hogwild) {
+                double learning_rate = static_cast<SGD&>(optimizer).getLearningRate();
+                history.push_back(order.empty() ? 0.0 : hogwildEpoch(inputs, targets, order, learning_rate));
+                continue;
+            }
+            double total = 0.0;
+            for (size_t begin = 0; begin < order.size(); begin += options.batch_size) {
+                size_t count = std::min(options.batch_size, order.size() - begin);
+                total += stepRows(inputs, targets, order.data() + begin, count) * static_cast<double>(count);
+            }
+            history.push_back(order.empty() ? 0.0 : total / static_cast<double>(order.size()));
+        }
+        return history;
+    }
+};
+
+} // namespace neural
+
+#endif // TRAINER_H
@@ -0,0 +1,89 @@
+#include "trainer.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Training throughput of a small MLP from 1 to N threads, for both gradient
+// reduction modes.
+//
+// Usage: training_benchmark [max_threads] [samples]
+
+namespace {
+
+neural::Sequential buildModel(size_t batch_size) {
+    neural::Sequential model(batch_size);
+    model.add(neural::DenseLayer(256, 512, std::make_unique<neural::ReLU>()))
+         .add(neural::DenseLayer(512, 512, std::make_unique<neural::ReLU>()))
+         .add(neural::DenseLayer(512, 10, std::make_unique<neural::Sigmoid>()));
+    return model;
+}
+
+// Samples per second over one epoch (after a warm-up epoch)
+double measure(neural::GradientReduction reduction, size_t threads,
+               const matrix::Matrix& inputs, const matrix::Matrix& targets) {
+    matrix::setNumThreads(threads);
+    neural::TrainingOptions options;
+    options.batch_size = 256;
+    options.min_shard_rows = 32;
+    options.reduction = reduction;
+    neural::Sequential model = buildModel(options.batch_size);
+    neural::SGD sgd(0.01);
+    neural::MeanSquaredError mse;
+    neural::Trainer trainer(model, mse, sgd, options);
+
+    trainer.fit(inputs, targets);
+    auto start = std::chrono::steady_clock::now();
+    trainer.fit(inputs, targets);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(inputs.getRows()) / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t max_threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                  : std::max(1u, std::thread::hardware_concurrency());
+    size_t samples = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8192;
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    matrix::Matrix inputs(samples, 256);
+    matrix::Matrix targets(samples, 10);
+    for (size_t i = 0; i < samples; ++i) {
+        for (double& x : inputs.row(i)) {
+            x = dist(gen);
+        }
+        for (size_t j = 0; j < 10; ++j) {
+            targets(i, j) = 0.5 + 0.4 * std::sin(inputs(i, j) * 3.0);
+        }
+    }
+
+    std::cout << "Training throughput, 256-512-512-10 MLP, batch 256, " << samples << " samples\n";
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "tree (smp/s)" << std::setw(10) << "speedup"
+              << std::setw(18) << "hogwild (smp/s)" << std::setw(10) << "speedup" << "\n";
+    double tree_base = 0.0;
+    double hogwild_base = 0.0;
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    for (size_t threads : thread_counts) {
+        double tree = measure(neural::GradientReduction::Tree, threads, inputs, targets);
+        double hogwild = measure(neural::GradientReduction::Hogwild, threads, inputs, targets);
+        if (threads == 1) {
+            tree_base = tree;
+            hogwild_base = hogwild;
+        }
+        std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0)
+                  << std::setw(16) << tree << std::setprecision(2) << std::setw(10) << tree / tree_base
+                  << std::setprecision(0) << std::setw(18) << hogwild << std::setprecision(2)
+                  << std::setw(10) << hogwild / hogwild_base << "\n";
+    }
+    return 0;
+}
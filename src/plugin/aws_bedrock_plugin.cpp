@@ -1,4 +1,5 @@
 #include "aws_bedrock_plugin.h"
+#include "../profiler/profiler.h"
 #include <iostream>
 #include <sstream>
 #include <thread>
@@ -145,6 +146,7 @@ int BedrockPlugin::processData(int input) const {
 }
 
 std::string BedrockPlugin::converse(const std::string& prompt) {
+    PROFILE_SCOPE("BedrockPlugin::converse", "plugin");
     std::cout << "BedrockPlugin: Processing prompt: " << prompt << std::endl;
 
 #if AWS_BEDROCK_AVAILABLE
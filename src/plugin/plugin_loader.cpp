@@ -1,4 +1,5 @@
 #include "plugin_loader.h"
+#include "../profiler/profiler.h"
 #include <iostream>
 
 // Global function that will be used for deleting plugins
@@ -6,6 +7,7 @@ static DestroyPluginFunc globalDestroyFunc = nullptr;
 
 PluginLoader::PluginLoader(const std::string& pluginPath) 
     : libraryHandle(nullptr), createFunc(nullptr), destroyFunc(nullptr) {
+    PROFILE_SCOPE("PluginLoader::load", "plugin");
     
     std::cout << "Loading plugin from: " << pluginPath << std::endl;
     
@@ -51,6 +53,7 @@ static void pluginDeleterFunction(PluginInterface* plugin) {
 }
 
 std::unique_ptr<PluginInterface, void(*)(PluginInterface*)> PluginLoader::createInstance() {
+    PROFILE_SCOPE("PluginLoader::createInstance", "plugin");
     if (!createFunc || !destroyFunc) {
         throw PluginLoadError("Plugin not properly initialized");
     }
@@ -0,0 +1,336 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Hot-path instrumentation: scoped timers and counters recorded into
+// per-thread buffers, summarized per operation or exported as a Chrome
+// trace (chrome://tracing, Perfetto).
+//
+//   PROFILE_SCOPE("DenseLayer::forward", "layer");
+//   PROFILE_SCOPE_FLOPS("Matrix::multiply", "gemm", 2.0 * m * n * k);
+//   PROFILE_COUNTER("RequestBatcher::batch_size", rows);
+//
+// Recording is off until profiler::setEnabled(true); while off, a scope
+// costs one relaxed atomic load. Building with DIONE_PROFILING=0 (CMake
+// option DIONE_PROFILING=OFF) removes the macros entirely and turns the
+// functions below into no-ops, so callers compile either way.
+//
+// Each thread appends to its own buffer, guarded by a lock that is only
+// contended while a report is being produced. Buffers outlive their
+// threads until reset(). Allocations through matrix::MemoryResource are
+// charged to the innermost open scope of the allocating thread.
+
+#ifndef DIONE_PROFILING
+#define DIONE_PROFILING 1
+#endif
+
+namespace profiler {
+
+// Totals of one operation (scope name) across all threads
+struct OpSummary {
+    std::string name;
+    std::string category;
+    size_t calls = 0;
+    double total_seconds = 0.0;  // Inclusive of nested scopes
+    double max_seconds = 0.0;
+    double flops = 0.0;
+    size_t bytes_allocated = 0;  // Allocated while this was the innermost scope
+
+    double gflops() const { return total_seconds > 0.0 ? flops / total_seconds * 1e-9 : 0.0; }
+};
+
+#if DIONE_PROFILING
+
+namespace detail {
+
+using Clock = std::chrono::steady_clock;
+
+// One finished scope, or one counter sample (duration_ns < 0)
+struct Event {
+    const char* name;
+    const char* category;
+    int64_t start_ns;
+    int64_t duration_ns;
+    double value;  // Flops of a scope, value of a counter
+    size_t bytes_allocated;
+};
+
+// Events of one thread
+struct ThreadBuffer {
+    std::mutex lock;
+    uint32_t tid = 0;
+    std::vector<Event> events;
+    size_t dropped = 0;
+};
+
+// Events kept per thread before new ones are dropped (and counted)
+constexpr size_t kMaxEventsPerThread = size_t(1) << 18;
+
+struct Registry {
+    std::atomic<bool> enabled{false};
+    std::mutex lock;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    uint32_t next_tid = 1;
+    Clock::time_point epoch = Clock::now();
+};
+
+inline Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// This thread's buffer, registered on first use
+inline ThreadBuffer& threadBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+        auto created = std::make_shared<ThreadBuffer>();
+        Registry& r = registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+        created->tid = r.next_tid++;
+        r.buffers.push_back(created);
+        return created;
+    }();
+    return *buffer;
+}
+
+inline int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - registry().epoch).count();
+}
+
+inline void record(const Event& event) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> guard(buffer.lock);
+    if (buffer.events.size() >= kMaxEventsPerThread) {
+        ++buffer.dropped;
+        return;
+    }
+    buffer.events.push_back(event);
+}
+
+inline std::string jsonString(const char* s) {
+    std::string out = "\"";
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') {
+            out += '\\';
+        }
+        out += *s;
+    }
+    return out + "\"";
+}
+
+} // namespace detail
+
+inline void setEnabled(bool enabled) { detail::registry().enabled.store(enabled, std::memory_order_relaxed); }
+inline bool isEnabled() { return detail::registry().enabled.load(std::memory_order_relaxed); }
+
+// Times the enclosing scope; use through PROFILE_SCOPE. name and category
+// must be string literals (or otherwise outlive the profiler data).
+class ScopedTimer {
+private:
+    const char* name;
+    const char* category;
+    double flops;
+    size_t bytes_allocated = 0;
+    int64_t start = 0;
+    ScopedTimer* parent = nullptr;
+    bool active;
+
+    static ScopedTimer*& innermost() {
+        thread_local ScopedTimer* scope = nullptr;
+        return scope;
+    }
+
+    friend void countAllocation(size_t bytes);
+
+public:
+    ScopedTimer(const char* name, const char* category, double flops = 0.0)
+        : name(name), category(category), flops(flops), active(isEnabled()) {
+        if (active) {
+            parent = innermost();
+            innermost() = this;
+            start = detail::now();
+        }
+    }
+
+    ~ScopedTimer() {
+        if (active) {
+            int64_t end = detail::now();
+            innermost() = parent;
+            detail::record({name, category, start, end - start, flops, bytes_allocated});
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    void addFlops(double count) { flops += count; }
+};
+
+// Charge an allocation to this thread's innermost open scope, if any
+inline void countAllocation(size_t bytes) {
+    if (ScopedTimer* scope = ScopedTimer::innermost()) {
+        scope->bytes_allocated += bytes;
+    }
+}
+
+// Record a sample of a named counter (a "C" event in the trace)
+inline void counter(const char* name, double value) {
+    if (isEnabled()) {
+        detail::record({name, "counter", detail::now(), -1, value, 0});
+    }
+}
+
+// Discard every recorded event
+inline void reset() {
+    detail::Registry& r = detail::registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for (const auto& buffer : r.buffers) {
+        std::lock_guard<std::mutex> buffer_guard(buffer->lock);
+        buffer->events.clear();
+        buffer->dropped = 0;
+    }
+}
+
+// Events dropped because a thread's buffer was full
+inline size_t droppedEvents() {
+    detail::Registry& r = detail::registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    size_t dropped = 0;
+    for (const auto& buffer : r.buffers) {
+        std::lock_guard<std::mutex> buffer_guard(buffer->lock);
+        dropped += buffer->dropped;
+    }
+    return dropped;
+}
+
+// Per-operation totals, most total time first
+inline std::vector<OpSummary> summary() {
+    std::map<std::string, OpSummary> ops;
+    detail::Registry& r = detail::registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for (const auto& buffer : r.buffers) {
+        std::lock_guard<std::mutex> buffer_guard(buffer->lock);
+        for (const detail::Event& event : buffer->events) {
+            if (event.duration_ns < 0) {
+                continue;
+            }
+            OpSummary& op = ops[event.name];
+            op.name = event.name;
+            op.category = event.category;
+            double seconds = double(event.duration_ns) * 1e-9;
+            ++op.calls;
+            op.total_seconds += seconds;
+            op.max_seconds = std::max(op.max_seconds, seconds);
+            op.flops += event.value;
+            op.bytes_allocated += event.bytes_allocated;
+        }
+    }
+    std::vector<OpSummary> result;
+    for (auto& [name, op] : ops) {
+        result.push_back(std::move(op));
+    }
+    std::sort(result.begin(), result.end(), [](const OpSummary& a, const OpSummary& b) {
+        return a.total_seconds > b.total_seconds;
+    });
+    return result;
+}
+
+// Table of summary()
+inline void printSummary(std::ostream& out) {
+    out << std::left << std::setw(32) << "operation" << std::right << std::setw(10) << "calls"
+        << std::setw(14) << "total (ms)" << std::setw(12) << "max (ms)" << std::setw(10) << "GFLOP/s"
+        << std::setw(16) << "allocated (B)" << "\n";
+    for (const OpSummary& op : summary()) {
+        out << std::left << std::setw(32) << op.name << std::right << std::setw(10) << op.calls << std::fixed
+            << std::setprecision(3) << std::setw(14) << op.total_seconds * 1e3 << std::setw(12)
+            << op.max_seconds * 1e3 << std::setprecision(2) << std::setw(10) << op.gflops() << std::setw(16)
+            << op.bytes_allocated << "\n";
+    }
+}
+
+// Chrome trace-event JSON of every recorded event: complete ("X") events
+// for scopes, with their flops and allocated bytes as args, and counter
+// ("C") events
+inline void writeChromeTrace(std::ostream& out) {
+    detail::Registry& r = detail::registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    out << std::fixed << std::setprecision(3);
+    bool first = true;
+    for (const auto& buffer : r.buffers) {
+        std::lock_guard<std::mutex> buffer_guard(buffer->lock);
+        for (const detail::Event& event : buffer->events) {
+            out << (first ? "\n  " : ",\n  ");
+            first = false;
+            out << "{\"name\": " << detail::jsonString(event.name) << ", \"cat\": "
+                << detail::jsonString(event.category) << ", \"pid\": 1, \"tid\": " << buffer->tid
+                << ", \"ts\": " << double(event.start_ns) * 1e-3;
+            if (event.duration_ns < 0) {
+                out << ", \"ph\": \"C\", \"args\": {\"value\": " << event.value << "}}";
+            } else {
+                out << ", \"ph\": \"X\", \"dur\": " << double(event.duration_ns) * 1e-3
+                    << ", \"args\": {\"flops\": " << event.value << ", \"bytes_allocated\": "
+                    << event.bytes_allocated << "}}";
+            }
+        }
+    }
+    out << "\n]}\n";
+}
+
+inline void writeChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Cannot open trace file for writing: " + path);
+    }
+    writeChromeTrace(out);
+}
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+#define PROFILE_SCOPE(name, category) \
+    ::profiler::ScopedTimer PROFILER_CONCAT(profile_scope_, __LINE__)(name, category)
+#define PROFILE_SCOPE_FLOPS(name, category, flops) \
+    ::profiler::ScopedTimer PROFILER_CONCAT(profile_scope_, __LINE__)(name, category, flops)
+#define PROFILE_COUNTER(name, value) ::profiler::counter(name, value)
+
+#else // DIONE_PROFILING
+
+inline void setEnabled(bool) {}
+inline bool isEnabled() { return false; }
+inline void countAllocation(size_t) {}
+inline void counter(const char*, double) {}
+inline void reset() {}
+inline size_t droppedEvents() { return 0; }
+inline std::vector<OpSummary> summary() { return {}; }
+inline void printSummary(std::ostream&) {}
+inline void writeChromeTrace(std::ostream& out) { out << "{\"traceEvents\": []}\n"; }
+inline void writeChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Cannot open trace file for writing: " + path);
+    }
+    writeChromeTrace(out);
+}
+
+#define PROFILE_SCOPE(name, category) ((void)0)
+#define PROFILE_SCOPE_FLOPS(name, category, flops) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+
+#endif // DIONE_PROFILING
+
+} // namespace profiler
+
+#endif // PROFILER_H